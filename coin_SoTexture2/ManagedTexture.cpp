@@ -0,0 +1,77 @@
+#include "ManagedTexture.h"
+#include "TextureManager.h"
+
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SbXfBox3f.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoTextureQualityElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/misc/SoState.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+SO_NODE_SOURCE(ManagedTexture);
+
+//____________________________________________________________________
+void ManagedTexture::initClass()
+{
+  if (getClassTypeId() == SoType::badType()) {
+    SO_NODE_INIT_CLASS(ManagedTexture, SoTexture2, "Texture2");
+  }
+}
+
+//____________________________________________________________________
+ManagedTexture::ManagedTexture()
+: m_manager(0),
+  m_boxNode(0),
+  m_boxId(0)
+{
+  SO_NODE_CONSTRUCTOR(ManagedTexture);
+}
+
+//____________________________________________________________________
+ManagedTexture::~ManagedTexture()
+{
+}
+
+//____________________________________________________________________
+void ManagedTexture::GLRender(SoGLRenderAction * action)
+{
+  if (m_manager)
+    m_manager->rendered(this, projectedSize(action), SoTextureQualityElement::get(action->getState()));
+  SoTexture2::GLRender(action);
+}
+
+//____________________________________________________________________
+float ManagedTexture::projectedSize(SoGLRenderAction * action)
+{
+  // 0 means unknown, and the texture is then shown at full resolution
+  const SoPath * path = action->getCurPath();
+  if (path->getLength() < 2)
+    return 0.0f;
+  SoState * state = action->getState();
+  SoNode * parent = path->getNodeFromTail(1);
+  if (parent != m_boxNode || parent->getNodeId() != m_boxId) {
+    SoGetBoundingBoxAction bbox(SoViewportRegionElement::get(state));
+    bbox.apply(parent);
+    m_box = bbox.getBoundingBox();
+    m_boxNode = parent;
+    m_boxId = parent->getNodeId();
+  }
+  if (m_box.isEmpty())
+    return 0.0f;
+
+  SbXfBox3f box(m_box);
+  box.transform(SoModelMatrixElement::get(state));
+  const SbVec2f size = SoViewVolumeElement::get(state).projectBox(box.project());
+  const SbVec2s viewport = SoViewportRegionElement::get(state).getViewportSizePixels();
+  const float pixels = std::max(size[0] * viewport[0], size[1] * viewport[1]);
+  // A box crossing the near plane projects to nonsense
+  return std::isfinite(pixels) && pixels > 0.0f ? pixels : 0.0f;
+}
@@ -0,0 +1,42 @@
+#ifndef MANAGEDTEXTURE_H
+#define MANAGEDTEXTURE_H
+
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/SbBox3f.h>
+
+class TextureManager;
+
+// An SoTexture2 which tells its TextureManager, each time it is rendered,
+// how large it appears on screen and which texture quality is asked for.
+//
+// The size on screen is the projection of the bounding box of the group
+// holding the node, taken in the coordinate system of the node itself:
+// the transformations placed before the texture in that group are
+// counted twice, so the texture should come first in its group.
+//
+// The node needs initClass() after SoDB::init().
+class ManagedTexture : public SoTexture2 {
+  SO_NODE_HEADER(ManagedTexture);
+
+public:
+  static void initClass();
+  ManagedTexture();
+
+  virtual void GLRender(SoGLRenderAction * action);
+
+protected:
+  virtual ~ManagedTexture();
+
+private:
+  friend class TextureManager;
+  TextureManager * m_manager;
+
+  // Bounding box of the parent group, recomputed when the group changes
+  SoNode * m_boxNode;
+  SbUniqueId m_boxId;
+  SbBox3f m_box;
+
+  float projectedSize(SoGLRenderAction * action);
+};
+
+#endif
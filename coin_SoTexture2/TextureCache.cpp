@@ -0,0 +1,100 @@
+#include "TextureCache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <cstdint>
+#include <cstring>
+
+
+namespace {
+
+// Version 1: 8-bit RGB or RGBA levels, down to 1x1
+const char magic[4] = { 'C', 'T', 'X', '1' };
+
+struct Header {
+  char magic[4];
+  uint32_t width, height, components, levels;
+  uint32_t reserved;
+};
+
+bool isPowerOfTwo(uint32_t n)
+{
+  return n && !(n & (n - 1));
+}
+
+}
+
+
+//____________________________________________________________________
+TextureCache::TextureCache(const QString & directory)
+: m_directory(directory)
+{
+  QDir().mkpath(m_directory);
+}
+
+//____________________________________________________________________
+QByteArray TextureCache::hash(const QByteArray & content)
+{
+  return QCryptographicHash::hash(content, QCryptographicHash::Sha1).toHex();
+}
+
+//____________________________________________________________________
+QString TextureCache::path(const QByteArray & hash) const
+{
+  return QDir(m_directory).filePath(QString::fromLatin1(hash) + ".mip");
+}
+
+//____________________________________________________________________
+std::shared_ptr<TextureLoader::Image> TextureCache::map(const QByteArray & hash, const std::string & filename) const
+{
+  std::shared_ptr<QFile> file(new QFile(path(hash)));
+  if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(Header)))
+    return std::shared_ptr<TextureLoader::Image>();
+  unsigned char * mapped = file->map(0, file->size());
+  if (!mapped)
+    return std::shared_ptr<TextureLoader::Image>();
+
+  Header header;
+  memcpy(&header, mapped, sizeof(header));
+  if (memcmp(header.magic, magic, sizeof(magic)) || (header.components != 3 && header.components != 4)
+      || !isPowerOfTwo(header.width) || !isPowerOfTwo(header.height) || header.width > 32768 || header.height > 32768)
+    return std::shared_ptr<TextureLoader::Image>();
+
+  std::shared_ptr<TextureLoader::Image> image(new TextureLoader::Image);
+  image->filename = filename;
+  image->width = header.width;
+  image->height = header.height;
+  image->components = header.components;
+  image->numLevels = TextureLoader::Image::countLevels(image->width, image->height);
+  if (header.levels != image->numLevels || quint64(file->size()) != sizeof(Header) + image->bytes())
+    return std::shared_ptr<TextureLoader::Image>(); // truncated, or from another version
+  image->data = mapped + sizeof(Header);
+  image->mapping = file; // unmapped with the image
+  image->decodeTime = image->mipmapTime = image->cacheTime = 0.0;
+  image->cached = true;
+  return image;
+}
+
+//____________________________________________________________________
+bool TextureCache::store(const QByteArray & hash, const TextureLoader::Image & image) const
+{
+  if (!image.numLevels)
+    return false;
+  Header header;
+  memcpy(header.magic, magic, sizeof(magic));
+  header.width = image.width;
+  header.height = image.height;
+  header.components = image.components;
+  header.levels = image.numLevels;
+  header.reserved = 0;
+
+  QSaveFile file(path(hash));
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(image.data), image.bytes());
+  return file.commit();
+}
@@ -0,0 +1,42 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "TextureLoader.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+#include <string>
+
+// A directory of preprocessed textures, as read by the TextureLoader.
+//
+// Each entry is the full mipmap chain of one image, exactly as the loader
+// hands it to the nodes (power-of-two, packed, bottom row first), behind
+// a small header. Entries are named after the SHA-1 of the content of the
+// source file, so renamed or copied files share their entry and a
+// modified file gets a new one. Entries are memory-mapped, and the nodes
+// are given the mapped pixels directly: nothing is decoded or copied.
+//
+// Stale entries are never removed: the directory can simply be deleted.
+class TextureCache {
+public:
+  // The directory is created if needed
+  TextureCache(const QString & directory);
+
+  const QString & directory() const { return m_directory; }
+
+  // Hex SHA-1 of a file content
+  static QByteArray hash(const QByteArray & content);
+  QString path(const QByteArray & hash) const;
+
+  // The chain of the image with this hash, mapped, or null if not cached
+  std::shared_ptr<TextureLoader::Image> map(const QByteArray & hash, const std::string & filename) const;
+  // Writes the chain of 'image' (atomically, other processes may be reading)
+  bool store(const QByteArray & hash, const TextureLoader::Image & image) const;
+
+private:
+  QString m_directory;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "TextureLoader.h"
+#include "TextureCache.h"
+
+#include <Inventor/nodes/SoTexture2.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QtDebug>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(const Clock::time_point & start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Nearest power of two, so that Coin never has to rescale the image itself
+int nearestPowerOfTwo(int n)
+{
+  if (n <= 1)
+    return 1;
+  return 1 << int(std::floor(std::log2(double(n)) + 0.5));
+}
+
+// 2x2 box filter of a packed image into one half its size
+void halve(const unsigned char * src, int w, int h, int nc, unsigned char * dst)
+{
+  const int dw = w > 1 ? w / 2 : 1, dh = h > 1 ? h / 2 : 1;
+  const int sx = w > 1 ? 1 : 0, sy = h > 1 ? 1 : 0; // offset of the second sample
+  for (int y = 0; y < dh; ++y) {
+    const unsigned char * row0 = src + size_t(2 * y * sy) * w * nc;
+    const unsigned char * row1 = row0 + size_t(sy) * w * nc;
+    unsigned char * out = dst + size_t(y) * dw * nc;
+    for (int x = 0; x < dw; ++x) {
+      const int x0 = 2 * x * sx * nc, x1 = x0 + sx * nc;
+      for (int c = 0; c < nc; ++c)
+        out[x * nc + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+    }
+  }
+}
+
+const unsigned char placeholder[2 * 2 * 3] = {
+  96, 96, 96,  160, 160, 160,
+  160, 160, 160,  96, 96, 96
+};
+
+}
+
+
+// Decodes one file and builds its mipmap chain, on a worker thread
+class DecodeTask : public QRunnable {
+public:
+  DecodeTask(TextureLoader * loader, const std::string & filename)
+  : m_loader(loader), m_filename(filename) {}
+
+  void run()
+  {
+    m_loader->finished(m_filename, TextureLoader::read(m_filename, m_loader->m_cache));
+  }
+
+private:
+  TextureLoader * m_loader;
+  std::string m_filename;
+};
+
+
+//____________________________________________________________________
+size_t TextureLoader::Image::levelOffset(unsigned level) const
+{
+  size_t offset = 0;
+  for (unsigned i = 0; i < level; ++i)
+    offset += size_t(levelWidth(i)) * levelHeight(i) * components;
+  return offset;
+}
+
+//____________________________________________________________________
+unsigned TextureLoader::Image::countLevels(int width, int height)
+{
+  unsigned n = 1;
+  while (width > 1 || height > 1) {
+    width /= 2;
+    height /= 2;
+    ++n;
+  }
+  return n;
+}
+
+//____________________________________________________________________
+TextureLoader::ImagePtr TextureLoader::read(const std::string & filename, const TextureCache * cache)
+{
+  std::shared_ptr<Image> image(new Image);
+  image->filename = filename;
+  image->width = image->height = image->components = 0;
+  image->numLevels = 0;
+  image->data = 0;
+  image->decodeTime = image->mipmapTime = image->cacheTime = 0.0;
+  image->cached = false;
+
+  Clock::time_point start = Clock::now();
+  QFile file(QString::fromStdString(filename));
+  if (!file.open(QIODevice::ReadOnly))
+    return image;
+  const QByteArray content = file.readAll();
+  image->decodeTime = msSince(start);
+
+  QByteArray hash;
+  if (cache) {
+    start = Clock::now();
+    hash = TextureCache::hash(content);
+    std::shared_ptr<Image> cached = cache->map(hash, filename);
+    if (cached) {
+      cached->decodeTime = image->decodeTime; // the reading of the file
+      cached->cacheTime = msSince(start);
+      return cached;
+    }
+    image->cacheTime = msSince(start);
+  }
+
+  start = Clock::now();
+  QImage decoded = QImage::fromData(content);
+  image->decodeTime += msSince(start);
+  if (decoded.isNull())
+    return image;
+
+  start = Clock::now();
+  const int w = nearestPowerOfTwo(decoded.width()), h = nearestPowerOfTwo(decoded.height());
+  if (w != decoded.width() || h != decoded.height())
+    decoded = decoded.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  const bool alpha = decoded.hasAlphaChannel();
+  decoded = decoded.convertToFormat(alpha ? QImage::Format_RGBA8888 : QImage::Format_RGB888);
+  const int nc = alpha ? 4 : 3;
+
+  image->width = w;
+  image->height = h;
+  image->components = nc;
+  image->numLevels = Image::countLevels(w, h);
+  image->pixels.resize(image->bytes());
+  image->data = &image->pixels[0];
+
+  // Level 0, packed and bottom row first, then each level from the previous one
+  unsigned char * pixels = &image->pixels[0];
+  for (int y = 0; y < h; ++y)
+    memcpy(pixels + size_t(y) * w * nc, decoded.constScanLine(h - 1 - y), size_t(w) * nc);
+  for (unsigned level = 1; level < image->numLevels; ++level)
+    halve(pixels + image->levelOffset(level - 1), image->levelWidth(level - 1), image->levelHeight(level - 1), nc,
+          pixels + image->levelOffset(level));
+  image->mipmapTime = msSince(start);
+
+  if (cache) {
+    start = Clock::now();
+    if (!cache->store(hash, *image))
+      qWarning() << "TextureLoader: could not store" << QString::fromStdString(filename) << "in" << cache->directory();
+    image->cacheTime += msSince(start);
+  }
+  return image;
+}
+
+
+//____________________________________________________________________
+TextureLoader::TextureLoader(int numThreads, QObject * parent)
+: QObject(parent),
+  m_cache(0)
+{
+  m_pool.setMaxThreadCount(numThreads > 0 ? numThreads : QThread::idealThreadCount());
+  // Emitted by the workers, handled on the thread of the loader
+  connect(this, &TextureLoader::decoded, this, &TextureLoader::deliver, Qt::QueuedConnection);
+}
+
+//____________________________________________________________________
+TextureLoader::~TextureLoader()
+{
+  m_pool.waitForDone();
+  for (std::map<std::string, std::vector<SoTexture2 *> >::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+    for (size_t i = 0; i < it->second.size(); ++i)
+      it->second[i]->unref();
+}
+
+//____________________________________________________________________
+std::string TextureLoader::key(const std::string & filename)
+{
+  return QFileInfo(QString::fromStdString(filename)).absoluteFilePath().toStdString();
+}
+
+//____________________________________________________________________
+void TextureLoader::load(SoTexture2 * texture, const std::string & filename)
+{
+  const std::string file = key(filename);
+  m_users[file]++;
+
+  ImagePtr ready = image(file);
+  if (ready) {
+    setImage(texture, ready);
+    return;
+  }
+
+  setPlaceholder(texture);
+  texture->ref(); // until the image is delivered
+  std::vector<SoTexture2 *> & waiting = m_pending[file];
+  waiting.push_back(texture);
+  if (waiting.size() == 1)
+    m_pool.start(new DecodeTask(this, file));
+}
+
+//____________________________________________________________________
+TextureLoader::ImagePtr TextureLoader::image(const std::string & filename) const
+{
+  QMutexLocker lock(&m_mutex);
+  std::map<std::string, ImagePtr>::const_iterator it = m_images.find(key(filename));
+  if (it == m_images.end() || !it->second->numLevels)
+    return ImagePtr();
+  return it->second;
+}
+
+//____________________________________________________________________
+void TextureLoader::finished(const std::string & filename, const ImagePtr & image)
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    m_images[filename] = image;
+  }
+  emit decoded(QString::fromStdString(filename));
+}
+
+//____________________________________________________________________
+void TextureLoader::deliver(const QString & filename)
+{
+  const std::string file = filename.toStdString();
+  std::map<std::string, std::vector<SoTexture2 *> >::iterator it = m_pending.find(file);
+  if (it == m_pending.end())
+    return;
+
+  // (the times and sizes of each file are in printReport(), not printed
+  // here: load() is also used in timed loops)
+  ImagePtr decoded = image(file);
+  if (!decoded)
+    qWarning() << "TextureLoader: could not decode" << filename << ", leaving it to Coin";
+  for (size_t i = 0; i < it->second.size(); ++i) {
+    SoTexture2 * texture = it->second[i];
+    if (decoded)
+      setImage(texture, decoded);
+    else
+      texture->filename.setValue(file.c_str());
+    texture->unref();
+  }
+  m_pending.erase(it);
+  emit delivered(filename);
+}
+
+//____________________________________________________________________
+void TextureLoader::release(const std::string & filename)
+{
+  QMutexLocker lock(&m_mutex);
+  m_images.erase(key(filename));
+}
+
+//____________________________________________________________________
+void TextureLoader::waitForAll()
+{
+  while (!m_pending.empty()) {
+    m_pool.waitForDone();
+    QCoreApplication::processEvents(); // the queued deliveries
+  }
+}
+
+//____________________________________________________________________
+void TextureLoader::setImage(SoTexture2 * texture, const ImagePtr & image, unsigned level)
+{
+  if (level >= image->numLevels)
+    level = image->numLevels - 1;
+  // NO_COPY: every node shows the same pixels (possibly the mapped cache
+  // file itself), kept alive by the loader
+  texture->image.setValue(SbVec2s(image->levelWidth(level), image->levelHeight(level)), image->components,
+                          image->level(level), SoSFImage::NO_COPY);
+}
+
+//____________________________________________________________________
+void TextureLoader::setPlaceholder(SoTexture2 * texture)
+{
+  texture->image.setValue(SbVec2s(2, 2), 3, placeholder);
+}
+
+//____________________________________________________________________
+void TextureLoader::printReport() const
+{
+  QMutexLocker lock(&m_mutex);
+  printf("# %-40s %11s %6s %10s %10s %10s %10s %6s\n", "file", "size", "levels", "decode[ms]", "mipmap[ms]", "cache[ms]",
+         "memory[kB]", "nodes");
+  size_t total = 0;
+  for (std::map<std::string, ImagePtr>::const_iterator it = m_images.begin(); it != m_images.end(); ++it) {
+    const Image & image = *it->second;
+    const std::map<std::string, unsigned>::const_iterator users = m_users.find(it->first);
+    char size[32], cache[32];
+    snprintf(size, sizeof(size), "%dx%dx%d", image.width, image.height, image.components);
+    snprintf(cache, sizeof(cache), "%.2f%s", image.cacheTime, image.cached ? " hit" : "");
+    printf("  %-40s %11s %6u %10.2f %10.2f %10s %10zu %6u\n", QFileInfo(QString::fromStdString(it->first)).fileName().toLatin1().constData(),
+           size, image.numLevels, image.decodeTime, image.mipmapTime, cache, image.bytes() / 1024,
+           users != m_users.end() ? users->second : 0);
+    total += image.bytes();
+  }
+  printf("# %u files, %zu kB of decoded images\n", unsigned(m_images.size()), total / 1024);
+  fflush(stdout);
+}
@@ -0,0 +1,119 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class QFile;
+class SoTexture2;
+class TextureCache;
+
+// Decodes texture images on worker threads, instead of letting Coin read
+// them on the GUI thread at the first render.
+//
+// load() puts a small placeholder in the texture node and queues the
+// file; the decoding, the rescaling to power-of-two dimensions and the
+// mipmap chain are done by a thread pool, and the image is handed to the
+// node on the GUI thread once ready. Each file is decoded once: all the
+// nodes referencing it get the same pixels, without a copy (the loader
+// keeps them alive, so it must outlive the scene graph).
+//
+// With a TextureCache, the chains are kept on disk: a file already seen
+// is only hashed, and its chain memory-mapped instead of decoded.
+//
+// Coin still builds the GL mipmaps itself when it uploads the texture;
+// the chain built here is what lets a texture be shown at a reduced
+// resolution (see setImage()) without decoding it again.
+class TextureLoader : public QObject {
+  Q_OBJECT
+
+public:
+  struct Image {
+    std::string filename;
+    int width, height, components; // of level 0
+    unsigned numLevels;            // 0 if the file could not be decoded
+    // All the levels one after the other, packed, bottom row first (as
+    // SoSFImage wants them). Level i is max(width >> i, 1) by
+    // max(height >> i, 1).
+    const unsigned char * data;
+    std::vector<unsigned char> pixels; // holds 'data' when decoded here
+    std::shared_ptr<QFile> mapping;    // holds 'data' when read from a TextureCache
+    double decodeTime;  // ms, reading and decoding the file
+    double mipmapTime;  // ms, rescaling and building the chain
+    double cacheTime;   // ms, hashing the file and mapping or storing the chain
+    bool cached;        // mapped from the cache, instead of decoded
+
+    unsigned levelWidth(unsigned level) const { return width >> level ? width >> level : 1; }
+    unsigned levelHeight(unsigned level) const { return height >> level ? height >> level : 1; }
+    size_t levelOffset(unsigned level) const;
+    const unsigned char * level(unsigned level) const { return data + levelOffset(level); }
+    size_t bytes() const { return levelOffset(numLevels); }
+    // Number of levels down to 1x1
+    static unsigned countLevels(int width, int height);
+  };
+  typedef std::shared_ptr<const Image> ImagePtr;
+
+  TextureLoader(int numThreads = 0, QObject * parent = 0);
+  virtual ~TextureLoader(); // waits for the decodings in progress
+
+  // Optional, and to be set before the first load(); not owned
+  void setCache(const TextureCache * cache) { m_cache = cache; }
+
+  // Shows a placeholder in 'texture' until 'filename' is decoded
+  void load(SoTexture2 * texture, const std::string & filename);
+
+  // The decoded image, or null if not ready (or not loadable)
+  ImagePtr image(const std::string & filename) const;
+  unsigned numPending() const { return m_pending.size(); }
+  // Blocks until all the queued files are decoded and handed to their nodes
+  void waitForAll();
+
+  // Forgets a decoded image, so that the next load() decodes it again.
+  // No node may be showing it any more (see setPlaceholder()).
+  void release(const std::string & filename);
+
+  // Shows 'level' of the mipmap chain in the node, sharing the pixels
+  static void setImage(SoTexture2 * texture, const ImagePtr & image, unsigned level = 0);
+  // Shows the 2x2 placeholder in the node
+  static void setPlaceholder(SoTexture2 * texture);
+
+  // The absolute path the files are identified by
+  static std::string key(const std::string & filename);
+
+  // Reads one file, from 'cache' if it is there, and stores it there
+  // otherwise; what the worker threads do. Never null.
+  static ImagePtr read(const std::string & filename, const TextureCache * cache = 0);
+
+  // Per file: size, decode and mipmap times, memory, number of nodes
+  void printReport() const;
+
+signals:
+  void decoded(const QString & filename);
+  // Once the image (or the fallback to Coin, if it could not be decoded)
+  // has been handed to the waiting nodes; 'filename' is the key()
+  void delivered(const QString & filename);
+
+private slots:
+  void deliver(const QString & filename);
+
+private:
+  friend class DecodeTask;
+
+  QThreadPool m_pool;
+  const TextureCache * m_cache;
+  mutable QMutex m_mutex;
+  std::map<std::string, ImagePtr> m_images; // written by the workers, under m_mutex
+  std::map<std::string, std::vector<SoTexture2 *> > m_pending; // GUI thread only
+  std::map<std::string, unsigned> m_users;
+
+  void finished(const std::string & filename, const ImagePtr & image);
+};
+
+#endif
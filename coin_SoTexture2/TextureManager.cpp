@@ -0,0 +1,271 @@
+#include "TextureManager.h"
+#include "ManagedTexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+const unsigned maxPressure = 12;
+
+// Estimate of the GL texture for a level: RGBA texels plus the mipmaps
+size_t glBytes(const TextureLoader::Image & image, unsigned level)
+{
+  return size_t(image.levelWidth(level)) * image.levelHeight(level) * 4 * 4 / 3;
+}
+
+}
+
+
+//____________________________________________________________________
+TextureManager::TextureManager(TextureLoader & loader, size_t budget, QObject * parent)
+: QObject(parent),
+  m_loader(loader),
+  m_budget(budget),
+  m_frame(1),
+  m_rendered(false),
+  m_pressure(0),
+  m_sensor(updateCB, this)
+{
+  m_stats = Stats();
+  m_stats.budget = budget;
+  connect(&m_loader, &TextureLoader::delivered, this, &TextureManager::delivered);
+}
+
+//____________________________________________________________________
+TextureManager::~TextureManager()
+{
+  m_sensor.unschedule();
+  for (std::map<ManagedTexture *, Entry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+    it->first->m_manager = 0;
+    it->first->unref();
+  }
+}
+
+//____________________________________________________________________
+void TextureManager::setBudget(size_t bytes)
+{
+  m_budget = bytes;
+  m_stats.budget = bytes;
+  m_sensor.schedule();
+}
+
+//____________________________________________________________________
+void TextureManager::manage(ManagedTexture * texture, const std::string & filename)
+{
+  if (m_textures.count(texture))
+    return;
+  texture->ref();
+  texture->m_manager = this;
+  Entry entry = { TextureLoader::key(filename), PENDING, -1, 0, 0.0f, 0.5f };
+  load(texture, m_textures.insert(std::make_pair(texture, entry)).first->second);
+  m_sensor.schedule();
+}
+
+//____________________________________________________________________
+void TextureManager::rendered(ManagedTexture * texture, float projected, float quality)
+{
+  std::map<ManagedTexture *, Entry>::iterator it = m_textures.find(texture);
+  if (it == m_textures.end())
+    return;
+  it->second.lastUse = m_frame;
+  it->second.projected = projected;
+  it->second.quality = quality;
+  m_rendered = true;
+  // Fields are not touched during the traversal: the update comes after
+  m_sensor.schedule();
+}
+
+//____________________________________________________________________
+void TextureManager::updateCB(void * data, SoSensor *)
+{
+  static_cast<TextureManager*>(data)->update();
+}
+
+//____________________________________________________________________
+void TextureManager::delivered(const QString & filename)
+{
+  const std::string file = filename.toStdString();
+  for (std::map<ManagedTexture *, Entry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+    Entry & entry = it->second;
+    if (entry.file != file || entry.state != PENDING)
+      continue;
+    // The loader has just put level 0 in the node, or left it to Coin
+    if (m_loader.image(file)) {
+      entry.state = RESIDENT;
+      entry.level = 0;
+    } else {
+      entry.state = FAILED;
+    }
+  }
+  update();
+}
+
+//____________________________________________________________________
+void TextureManager::update()
+{
+  // Textures rendered since the last update are the ones in view
+  for (std::map<ManagedTexture *, Entry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+    if (it->second.state == EVICTED && it->second.lastUse == m_frame) {
+      load(it->first, it->second);
+      ++m_stats.reloads;
+    }
+
+  applyLevels();
+  account();
+
+  if (m_stats.usage() > m_budget) {
+    std::vector<std::pair<unsigned long, ManagedTexture *> > lru;
+    for (std::map<ManagedTexture *, Entry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+      if (it->second.state == RESIDENT && it->second.lastUse < m_frame)
+        lru.push_back(std::make_pair(it->second.lastUse, it->first));
+    std::sort(lru.begin(), lru.end());
+    for (size_t i = 0; i < lru.size() && m_stats.usage() > m_budget; ++i) {
+      evict(lru[i].second, m_textures[lru[i].second]);
+      account();
+    }
+    while (m_stats.usage() > m_budget && m_pressure < maxPressure) {
+      ++m_pressure;
+      applyLevels();
+      account();
+    }
+  } else if (m_pressure > 0 && m_stats.hostMemory + 4 * m_stats.glMemory <= m_budget / 4 * 3) {
+    // One level less would still leave some room: no ping-pong
+    --m_pressure;
+    applyLevels();
+    account();
+  }
+
+  if (m_rendered) {
+    ++m_frame;
+    m_rendered = false;
+  }
+  emit updated();
+}
+
+//____________________________________________________________________
+void TextureManager::load(ManagedTexture * texture, Entry & entry)
+{
+  m_loader.load(texture, entry.file);
+  if (m_loader.image(entry.file)) {
+    // Still decoded for other nodes: level 0 is already in the node
+    entry.state = RESIDENT;
+    entry.level = 0;
+  } else {
+    entry.state = PENDING;
+    entry.level = -1;
+  }
+}
+
+//____________________________________________________________________
+void TextureManager::evict(ManagedTexture * texture, Entry & entry)
+{
+  TextureLoader::setPlaceholder(texture);
+  entry.state = EVICTED;
+  entry.level = -1;
+  ++m_stats.evictions;
+
+  for (std::map<ManagedTexture *, Entry>::const_iterator it = m_textures.begin(); it != m_textures.end(); ++it)
+    if (it->second.file == entry.file && (it->second.state == RESIDENT || it->second.state == PENDING))
+      return;
+  m_loader.release(entry.file);
+}
+
+//____________________________________________________________________
+unsigned TextureManager::wantedLevel(const Entry & entry, const TextureLoader::Image & image) const
+{
+  const unsigned last = image.numLevels - 1;
+  unsigned level = 0;
+  // The smallest level still at least as large as the texture on screen
+  if (entry.projected > 0.0f) {
+    const unsigned size = std::max(image.width, image.height);
+    while (level < last && float(size >> (level + 1)) >= entry.projected)
+      ++level;
+  }
+  if (entry.quality > 0.0f && entry.quality < 0.5f)
+    level += unsigned(std::ceil(std::log2(0.5f / entry.quality)));
+  level += m_pressure;
+  return std::min(level, last);
+}
+
+//____________________________________________________________________
+void TextureManager::applyLevels()
+{
+  std::map<std::string, TextureLoader::ImagePtr> images;
+  for (std::map<ManagedTexture *, Entry>::iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+    Entry & entry = it->second;
+    if (entry.state != RESIDENT)
+      continue;
+    TextureLoader::ImagePtr & image = images[entry.file];
+    if (!image)
+      image = m_loader.image(entry.file);
+    if (!image)
+      continue;
+    const int level = wantedLevel(entry, *image);
+    if (level != entry.level) {
+      TextureLoader::setImage(it->first, image, level);
+      entry.level = level;
+    }
+  }
+}
+
+//____________________________________________________________________
+void TextureManager::account()
+{
+  Stats & s = m_stats;
+  s.hostMemory = s.glMemory = 0;
+  s.textures = m_textures.size();
+  s.resident = s.pending = s.evicted = s.downscaled = 0;
+  s.pressure = m_pressure;
+  std::map<std::string, TextureLoader::ImagePtr> images;
+  for (std::map<ManagedTexture *, Entry>::const_iterator it = m_textures.begin(); it != m_textures.end(); ++it) {
+    const Entry & entry = it->second;
+    if (entry.state == PENDING)
+      ++s.pending;
+    else if (entry.state == EVICTED)
+      ++s.evicted;
+    if (entry.state != RESIDENT)
+      continue;
+    ++s.resident;
+    if (entry.level > 0)
+      ++s.downscaled;
+    std::map<std::string, TextureLoader::ImagePtr>::iterator image = images.find(entry.file);
+    if (image == images.end()) {
+      image = images.insert(std::make_pair(entry.file, m_loader.image(entry.file))).first;
+      if (image->second)
+        s.hostMemory += image->second->bytes();
+    }
+    if (image->second && entry.level >= 0)
+      s.glMemory += glBytes(*image->second, entry.level);
+  }
+}
+
+//____________________________________________________________________
+std::map<std::string, double> TextureManager::counters() const
+{
+  std::map<std::string, double> c;
+  c["texture memory [MB]"] = m_stats.usage() / 1048576.0;
+  c["texture budget [MB]"] = m_stats.budget / 1048576.0;
+  c["texture host memory [MB]"] = m_stats.hostMemory / 1048576.0;
+  c["texture GL memory [MB]"] = m_stats.glMemory / 1048576.0;
+  c["resident textures"] = m_stats.resident;
+  c["evicted textures"] = m_stats.evicted;
+  c["downscaled textures"] = m_stats.downscaled;
+  c["texture evictions"] = m_stats.evictions;
+  c["texture reloads"] = m_stats.reloads;
+  c["texture pressure"] = m_stats.pressure;
+  return c;
+}
+
+//____________________________________________________________________
+void TextureManager::printStats() const
+{
+  const std::map<std::string, double> c = counters();
+  for (std::map<std::string, double>::const_iterator it = c.begin(); it != c.end(); ++it)
+    printf("%-28s %10.2f\n", it->first.c_str(), it->second);
+  fflush(stdout);
+}
@@ -0,0 +1,102 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include "TextureLoader.h"
+
+#include <Inventor/sensors/SoOneShotSensor.h>
+
+#include <QObject>
+
+#include <map>
+#include <string>
+
+class ManagedTexture;
+
+// Keeps the memory used by the textures of a scene under a budget.
+//
+// The textures are ManagedTexture nodes, loaded through a TextureLoader.
+// After each frame the manager:
+//  - reloads the evicted textures which were rendered again (they show
+//    the placeholder in the meantime),
+//  - picks for each texture the mipmap level matching its size on screen
+//    and SoComplexity::textureQuality (below the default 0.5, each halving
+//    of the quality drops one more level),
+//  - if over budget, evicts the least recently rendered textures, and then,
+//    if the textures in view still do not fit, downscales all of them by
+//    one more level at a time ("pressure"), which is relaxed again once
+//    there is room.
+//
+// The memory counted is the decoded images held by the loader for the
+// resident textures, plus an estimate of the GL textures: 4 bytes per
+// texel of the level shown, and a third more for the mipmaps Coin builds.
+// A decoded image is released once no node of its file is resident.
+//
+// The manager and the loader must outlive the scene graph.
+class TextureManager : public QObject {
+  Q_OBJECT
+
+public:
+  struct Stats {
+    size_t budget;
+    size_t hostMemory;  // decoded images of the resident textures
+    size_t glMemory;    // estimate of the GL textures
+    unsigned textures, resident, pending, evicted, downscaled;
+    unsigned pressure;
+    unsigned long evictions, reloads;
+    size_t usage() const { return hostMemory + glMemory; }
+  };
+
+  TextureManager(TextureLoader & loader, size_t budget, QObject * parent = 0);
+  virtual ~TextureManager();
+
+  void setBudget(size_t bytes);
+  size_t budget() const { return m_budget; }
+
+  // Loads 'filename' into 'texture' and manages it from now on
+  void manage(ManagedTexture * texture, const std::string & filename);
+
+  const Stats & stats() const { return m_stats; }
+  // The stats, named as the counters of the viewer statistics
+  std::map<std::string, double> counters() const;
+  void printStats() const;
+
+signals:
+  // After each update, e.g. to show the stats
+  void updated();
+
+private slots:
+  void delivered(const QString & filename);
+
+private:
+  friend class ManagedTexture;
+
+  enum State { PENDING, RESIDENT, EVICTED, FAILED };
+  struct Entry {
+    std::string file;  // TextureLoader::key()
+    State state;
+    int level;         // shown, -1 for the placeholder
+    unsigned long lastUse;
+    float projected;   // pixels, 0 if unknown
+    float quality;
+  };
+
+  TextureLoader & m_loader;
+  size_t m_budget;
+  std::map<ManagedTexture *, Entry> m_textures;
+  unsigned long m_frame;
+  bool m_rendered; // since the last update
+  unsigned m_pressure;
+  Stats m_stats;
+  SoOneShotSensor m_sensor;
+
+  void rendered(ManagedTexture * texture, float projected, float quality);
+  static void updateCB(void * data, SoSensor * sensor);
+  void update();
+  void load(ManagedTexture * texture, Entry & entry);
+  void evict(ManagedTexture * texture, Entry & entry);
+  void applyLevels();
+  unsigned wantedLevel(const Entry & entry, const TextureLoader::Image & image) const;
+  void account();
+};
+
+#endif
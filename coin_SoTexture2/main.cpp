@@ -1,29 +1,58 @@
-#include <Inventor/Qt/SoQt.h>
-#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoCube.h>
 #include <Inventor/nodes/SoTexture2.h>
 #include <Inventor/nodes/SoTexture2Transform.h>
-#include <QApplication>
+#include <Inventor/nodes/SoTranslation.h>
+#include "ExampleHarness.h"
+#include "ManagedTexture.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "TextureManager.h"
 #include <QWidget>
+#include <algorithm>
+#include <memory>
 #include <random>
 #include <stdexcept>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <cmath>
+#include <cstring>
+
+// Usage: coin_ex_sotexture2 [--sync] [--cubes N] [--budget MB] [--cache DIR]
+//                           [--headless] [--frames N] [--orbit]
+//
+// By default the texture is decoded on a worker thread by a TextureLoader,
+// and a placeholder is shown meanwhile; --sync lets Coin read the file
+// itself, on the GUI thread, at the first render.
+// --cubes lays out N textured cubes on a grid, each with its own texture
+// node; their memory is kept under --budget (64 MB by default) by a
+// TextureManager, whose numbers are shown in the window title, and
+// reported with the frame times.
+// --cache reads (and fills) a cache of preprocessed textures, see
+// coin_ex_texturecache.
+// The last options come from the ExampleHarness; offscreen, the textures
+// still load in the background, between the frames.
 int main(int argc, char **argv)
 {
+  bool sync = false;
+  int numCubes = 1;
+  double budget = 64.0;
+  const char * cacheDirectory = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--sync"))
+      sync = true;
+    else if (!strcmp(argv[i], "--cubes") && i + 1 < argc)
+      numCubes = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      budget = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+      cacheDirectory = argv[++i];
+  }
 
-  // Initialize the Qt system:
-  QApplication app(argc, argv);
-
-  // Make a main window:
-  QWidget mainwin;
-  mainwin.resize(400,400);
-
-  // Initialize SoQt
-  SoQt::init(&mainwin);
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
+  ManagedTexture::initClass();
 
   // The root of a scene graph
   SoSeparator *root = new SoSeparator;
@@ -33,42 +62,76 @@ int main(int argc, char **argv)
   // Here the other 3D objects can go...
   */
   // Choose a texture
-  SoTexture2 *texture = new SoTexture2;
-  root->addChild(texture);
-  texture->filename.setValue("grass.jpg");
-  texture->wrapS = SoTexture2::Wrap::REPEAT;
+  TextureLoader loader;
+  std::unique_ptr<TextureCache> cache;
+  if (cacheDirectory) {
+    cache.reset(new TextureCache(cacheDirectory));
+    loader.setCache(cache.get());
+  }
+  TextureManager manager(loader, size_t(budget * 1048576.0));
 
   SoTexture2Transform* tr = new SoTexture2Transform;
   // tr->scaleFactor.setValue(0.01, 0.01); // it "enlarges" the texture
   // tr->scaleFactor.setValue(100., 100.); // it "reduces" the texture: more texture's tiles in the same area
   root->addChild(tr);
 
-  // Make a cube
-  SoCube* cube = new SoCube;
-  cube->width = 400.0;
-  cube->height = 400.0;
-  cube->depth = 100.0;
-  root->addChild(cube);
+  // Make the cubes, on a grid; the texture comes first in each separator
+  // (see ManagedTexture), and the cubes out of view are not rendered, so
+  // that their textures can be evicted
+  const int columns = int(std::ceil(std::sqrt(double(numCubes))));
+  for (int i = 0; i < numCubes; ++i) {
+    SoSeparator *sep = new SoSeparator;
+    sep->renderCulling = SoSeparator::ON;
+    root->addChild(sep);
+
+    ManagedTexture *texture = new ManagedTexture;
+    sep->addChild(texture);
+    if (sync)
+      texture->filename.setValue("grass.jpg");
+    else
+      manager.manage(texture, "grass.jpg");
+    texture->wrapS = SoTexture2::Wrap::REPEAT;
+
+    SoTranslation *position = new SoTranslation;
+    position->translation.setValue(600.0f * (i % columns), 600.0f * (i / columns), 0.0f);
+    sep->addChild(position);
+
+    // Make a cube
+    SoCube* cube = new SoCube;
+    cube->width = 400.0;
+    cube->height = 400.0;
+    cube->depth = 100.0;
+    sep->addChild(cube);
+  }
 
   /*
   // end of the 3D objects definition
   */
 
 
-  // Initialize an examiner viewer:
-  SoQtExaminerViewer * eviewer = new SoQtExaminerViewer(&mainwin);
-  eviewer->setSceneGraph(root);
-  eviewer->show();
-
-  // Pop up the main window.
-  SoQt::show(&mainwin);
+  // With the frame times of --frames
+  if (!sync)
+    harness.addCounters([&manager]() { return manager.counters(); });
+  if (!sync && harness.window()) {
+    QWidget *mainwin = harness.window();
+    QObject::connect(&manager, &TextureManager::updated, [&manager, mainwin]() {
+      const TextureManager::Stats & stats = manager.stats();
+      mainwin->setWindowTitle(QString("textures: %1 / %2 MB, %3 resident, %4 evictions, %5 downscaled")
+                              .arg(stats.usage() / 1048576.0, 0, 'f', 1).arg(stats.budget / 1048576.0, 0, 'f', 1)
+                              .arg(stats.resident).arg(stats.evictions).arg(stats.downscaled));
+    });
+  }
 
-  // Loop until exit.
-  SoQt::mainLoop();
+  // Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
 
   // Clean up resources.
-  delete eviewer;
   root->unref();
+  if (!sync) {
+    loader.printReport();
+    manager.printStats();
+  }
 
-  return app.exec();
+  return result;
 }
@@ -0,0 +1,162 @@
+#include <Inventor/SoDB.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include <QBrush>
+#include <QCoreApplication>
+#include <QColor>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Preprocessing of the textures of coin_ex_sotexture2 into a TextureCache.
+//
+// Usage:
+//   coin_ex_texturecache --cache DIR file...
+//       decodes the files and stores their mipmap chains in DIR
+//   coin_ex_texturecache --generate N SIZE DIR
+//       writes N synthetic SIZExSIZE JPEG textures in DIR
+//   coin_ex_texturecache --benchmark --cache DIR file...
+//       times the loading of the files into texture nodes without the
+//       cache, then with a cold cache (decoded and stored), then with a
+//       warm one (mapped)
+//
+// The viewer reads the same cache with: coin_ex_sotexture2 --cache DIR
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(const Clock::time_point & start)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Noise under a few gradients and discs, so that the JPEG decoder has work
+bool generate(int count, int size, const QString & directory)
+{
+  QDir().mkpath(directory);
+  std::mt19937 random(12345);
+  std::uniform_int_distribution<int> byte(0, 255), position(0, size);
+  for (int i = 0; i < count; ++i) {
+    QImage image(size, size, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size, size);
+    gradient.setColorAt(0.0, QColor(byte(random), byte(random), byte(random)));
+    gradient.setColorAt(1.0, QColor(byte(random), byte(random), byte(random)));
+    painter.fillRect(image.rect(), gradient);
+    for (int j = 0; j < 64; ++j) {
+      painter.setBrush(QColor(byte(random), byte(random), byte(random), 128));
+      const int r = position(random) / 8 + 1;
+      painter.drawEllipse(QPoint(position(random), position(random)), r, r);
+    }
+    painter.end();
+    for (int y = 0; y < size; ++y) {
+      QRgb * line = reinterpret_cast<QRgb*>(image.scanLine(y));
+      for (int x = 0; x < size; ++x) {
+        const int n = byte(random) / 8 - 16;
+        line[x] = qRgb(qBound(0, qRed(line[x]) + n, 255), qBound(0, qGreen(line[x]) + n, 255), qBound(0, qBlue(line[x]) + n, 255));
+      }
+    }
+    const QString filename = QDir(directory).filePath(QString("synthetic_%1.jpg").arg(i, 3, 10, QChar('0')));
+    if (!image.save(filename, "JPG", 90)) {
+      fprintf(stderr, "could not write %s\n", filename.toLocal8Bit().constData());
+      return false;
+    }
+    printf("%s\n", filename.toLocal8Bit().constData());
+  }
+  return true;
+}
+
+// Loads all the files into texture nodes, as the viewer does at startup
+double loadAll(const std::vector<std::string> & files, const TextureCache * cache)
+{
+  const Clock::time_point start = Clock::now();
+  {
+    TextureLoader loader;
+    loader.setCache(cache);
+    std::vector<SoTexture2 *> textures;
+    for (size_t i = 0; i < files.size(); ++i) {
+      textures.push_back(new SoTexture2);
+      textures.back()->ref();
+      loader.load(textures.back(), files[i]);
+    }
+    loader.waitForAll();
+    for (size_t i = 0; i < textures.size(); ++i)
+      textures[i]->unref();
+  }
+  return msSince(start);
+}
+
+}
+
+
+int main(int argc, char **argv)
+{
+  QCoreApplication app(argc, argv);
+  SoDB::init();
+
+  QString cacheDirectory;
+  bool benchmark = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--cache") && i + 1 < argc)
+      cacheDirectory = argv[++i];
+    else if (!strcmp(argv[i], "--benchmark"))
+      benchmark = true;
+    else if (!strcmp(argv[i], "--generate") && i + 3 < argc)
+      return generate(atoi(argv[i + 1]), atoi(argv[i + 2]), argv[i + 3]) ? 0 : 1;
+    else
+      files.push_back(argv[i]);
+  }
+  if (cacheDirectory.isEmpty() || files.empty()) {
+    fprintf(stderr, "usage: %s [--benchmark] --cache DIR file...\n"
+                    "       %s --generate N SIZE DIR\n", argv[0], argv[0]);
+    return 1;
+  }
+
+  if (benchmark) {
+    // A fresh directory, so that the first cached run is a cold one
+    const QString cold = QDir(cacheDirectory).filePath("benchmark");
+    QDir(cold).removeRecursively();
+    TextureCache cache(cold);
+    // Read once, so that every run finds the sources in the OS file cache
+    for (size_t i = 0; i < files.size(); ++i) {
+      QFile file(QString::fromStdString(files[i]));
+      if (file.open(QIODevice::ReadOnly))
+        file.readAll();
+    }
+    const double none = loadAll(files, 0);
+    const double stored = loadAll(files, &cache);
+    const double mapped = loadAll(files, &cache);
+    printf("# %u files\n", unsigned(files.size()));
+    printf("%-28s %10.1f ms\n", "no cache", none);
+    printf("%-28s %10.1f ms\n", "cold cache (decode + store)", stored);
+    printf("%-28s %10.1f ms\n", "warm cache (map)", mapped);
+    QDir(cold).removeRecursively();
+    return 0;
+  }
+
+  TextureCache cache(cacheDirectory);
+  int failed = 0;
+  for (size_t i = 0; i < files.size(); ++i) {
+    TextureLoader::ImagePtr image = TextureLoader::read(files[i], &cache);
+    if (!image->numLevels) {
+      fprintf(stderr, "could not decode %s\n", files[i].c_str());
+      ++failed;
+      continue;
+    }
+    printf("%-40s %5dx%-5d %s %8.2f ms\n", files[i].c_str(), image->width, image->height,
+           image->cached ? "already cached" : "stored        ",
+           image->decodeTime + image->mipmapTime + image->cacheTime);
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+#include "FieldBinding.h"
+
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+#include <QFile>
+
+#include <cstdio>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+// Sensors watching for the deletion of the nodes which read a mapping.
+// Coin still uses a sensor after its delete callback has returned, so
+// they are not deleted there but kept, detached, for the next mappings.
+std::vector<SoNodeSensor *> freeSensors;
+
+// A mapped file, kept until the node which reads it is deleted
+struct Mapping {
+  QFile file;
+  uchar * data;
+  SoNodeSensor * sensor;
+
+  Mapping(const QString & filename) : file(filename), data(0), sensor(0) {}
+
+  static void ownerDeleted(void * data, SoSensor *)
+  {
+    // Unmapped and deleted right away: no event loop needed
+    Mapping * mapping = static_cast<Mapping*>(data);
+    mapping->sensor->detach();
+    freeSensors.push_back(mapping->sensor);
+    delete mapping;
+  }
+};
+
+// Maps a file of whole 'valueSize' values for 'owner', 0 on failure
+uchar * map(const QString & filename, SoNode * owner, qint64 valueSize, int & num)
+{
+  Mapping * mapping = new Mapping(filename);
+  const qint64 size = mapping->file.size();
+  if (size <= 0 || size % valueSize || size / valueSize > 0x7fffffff || !mapping->file.open(QIODevice::ReadOnly)
+      || !(mapping->data = mapping->file.map(0, size, QFileDevice::MapPrivateOption))) {
+    fprintf(stderr, "Could not map %s\n", qPrintable(filename));
+    delete mapping;
+    return 0;
+  }
+  if (freeSensors.empty()) {
+    mapping->sensor = new SoNodeSensor;
+    mapping->sensor->setPriority(0); // only there for its delete callback
+  } else {
+    mapping->sensor = freeSensors.back();
+    freeSensors.pop_back();
+  }
+  mapping->sensor->setDeleteCallback(Mapping::ownerDeleted, mapping);
+  mapping->sensor->attach(owner);
+  num = int(size / valueSize);
+  return mapping->data;
+}
+
+// A field of /proc/self/statm, in bytes
+std::size_t memoryPages(int field)
+{
+#ifdef __linux__
+  FILE * file = fopen("/proc/self/statm", "r");
+  if (!file)
+    return 0;
+  unsigned long values[3] = { 0, 0, 0 };
+  const bool ok = fscanf(file, "%lu %lu %lu", &values[0], &values[1], &values[2]) == 3;
+  fclose(file);
+  return ok ? std::size_t(values[field]) * sysconf(_SC_PAGESIZE) : 0;
+#else
+  (void)field;
+  return 0;
+#endif
+}
+
+}
+
+
+//____________________________________________________________________
+void FieldBinding::bind(SoMFVec3f & field, std::vector<SbVec3f> & values)
+{
+  field.setValuesPointer(values.size(), values.data());
+}
+
+//____________________________________________________________________
+void FieldBinding::bind(SoMFInt32 & field, std::vector<int32_t> & values)
+{
+  field.setValuesPointer(values.size(), values.data());
+}
+
+//____________________________________________________________________
+bool FieldBinding::bindMapped(SoMFVec3f & field, SoNode * owner, const QString & filename)
+{
+  int num = 0;
+  uchar * data = map(filename, owner, 3 * sizeof(float), num);
+  if (data)
+    field.setValuesPointer(num, reinterpret_cast<float*>(data));
+  return data != 0;
+}
+
+//____________________________________________________________________
+bool FieldBinding::bindMapped(SoMFInt32 & field, SoNode * owner, const QString & filename)
+{
+  int num = 0;
+  uchar * data = map(filename, owner, sizeof(int32_t), num);
+  if (data)
+    field.setValuesPointer(num, reinterpret_cast<int32_t*>(data));
+  return data != 0;
+}
+
+//____________________________________________________________________
+std::size_t FieldBinding::residentMemory()
+{
+  return memoryPages(1);
+}
+
+//____________________________________________________________________
+std::size_t FieldBinding::anonymousMemory()
+{
+  const std::size_t resident = memoryPages(1), fileBacked = memoryPages(2);
+  return resident > fileBacked ? resident - fileBacked : 0;
+}
@@ -0,0 +1,61 @@
+#ifndef FIELDBINDING_H
+#define FIELDBINDING_H
+
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+#include <QString>
+
+#include <cstddef>
+#include <vector>
+
+class SoNode;
+
+// Binds arrays to multiple-value fields without copying them, with
+// setValuesPointer: the field reads the array in place instead of
+// allocating and filling its own.
+//
+// Lifetime rules:
+// - The array must outlive every use of the field: the node, its copies
+//   made by reference, and the render caches built from it. Static tables
+//   always do; a std::vector must neither be destroyed nor reallocated.
+// - The field does not own the array and never frees it.
+// - Edits which change the number of values (setNum, set1Value or
+//   setValues past the end) make the field copy the array into memory of
+//   its own first; from then on, the array is no longer used.
+// - Edits in place (set1Value within range, startEditing) write into the
+//   array. So only writable arrays can be bound: a const table, which may
+//   be in read-only memory, must be copied with setValues instead. Mapped
+//   files are mapped copy-on-write, so edits never reach the file.
+namespace FieldBinding {
+
+template<int N>
+void bind(SoMFVec3f & field, float (&values)[N][3])
+{
+  field.setValuesPointer(N, &values[0][0]);
+}
+
+template<int N>
+void bind(SoMFInt32 & field, int32_t (&values)[N])
+{
+  field.setValuesPointer(N, values);
+}
+
+void bind(SoMFVec3f & field, std::vector<SbVec3f> & values);
+void bind(SoMFInt32 & field, std::vector<int32_t> & values);
+
+// Maps 'filename' (native float triples, or int32 values) and binds it to
+// the field of 'owner'. The mapping is released when the owner is
+// deleted, so it lives as long as the field may read it. Returns false if
+// the file cannot be mapped.
+bool bindMapped(SoMFVec3f & field, SoNode * owner, const QString & filename);
+bool bindMapped(SoMFInt32 & field, SoNode * owner, const QString & filename);
+
+// Resident memory of the process in bytes, 0 if not known; the anonymous
+// part leaves out the pages of mapped files, which the system can drop
+std::size_t residentMemory();
+std::size_t anonymousMemory();
+
+}
+
+#endif
@@ -0,0 +1,467 @@
+#include "NormalGenerator.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoTriangleStripSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <set>
+
+
+namespace {
+
+// Below this, threads cost more than they save
+const int parallelThreshold = 20000;
+
+class RangeTask : public QRunnable {
+public:
+  RangeTask(const std::function<void(int, int)> & function, int begin, int end, QSemaphore * done)
+  : m_function(function), m_begin(begin), m_end(end), m_done(done) {}
+  void run() { m_function(m_begin, m_end); m_done->release(); }
+private:
+  std::function<void(int, int)> m_function;
+  int m_begin, m_end;
+  QSemaphore * m_done;
+};
+
+// Calls function(begin, end) over [0, n), in parallel if worth it
+void parallelFor(int n, int numThreads, const std::function<void(int, int)> & function)
+{
+  if (n < parallelThreshold || numThreads < 2) {
+    function(0, n);
+    return;
+  }
+  // The application's pool, whose threads are started once, not per call;
+  // only our tasks are waited for, not whatever else it runs
+  QThreadPool * pool = QThreadPool::globalInstance();
+  QSemaphore done;
+  const int chunk = (n + numThreads - 1) / numThreads;
+  int numTasks = 0;
+  for (int begin = 0; begin < n; begin += chunk, ++numTasks)
+    pool->start(new RangeTask(function, begin, std::min(begin + chunk, n), &done));
+  done.acquire(numTasks);
+}
+
+struct Candidate {
+  SoVertexShape * shape;
+  std::vector<SbVec3f> points;
+  bool clockwise;
+  bool splittable;
+};
+
+struct Collector {
+  std::vector<Candidate> shapes;
+  std::set<SoNode *> seen;
+  bool overwrite;
+  unsigned skipped;
+};
+
+SoCallbackAction::Response collectCB(void * data, SoCallbackAction * action, const SoNode * node)
+{
+  Collector * collector = static_cast<Collector*>(data);
+  SoVertexShape * shape = const_cast<SoVertexShape*>(static_cast<const SoVertexShape*>(node));
+  if (!collector->seen.insert(shape).second)
+    return SoCallbackAction::CONTINUE;
+  const SoVertexProperty * property = static_cast<const SoVertexProperty*>(shape->vertexProperty.getValue());
+  const bool hasNormals = property && property->normal.getNum() ? true : action->getNumNormals() > 0;
+  if (hasNormals && !collector->overwrite) {
+    ++collector->skipped;
+    return SoCallbackAction::CONTINUE;
+  }
+
+  Candidate candidate;
+  candidate.shape = shape;
+  if (property && property->vertex.getNum()) {
+    candidate.points.assign(property->vertex.getValues(0), property->vertex.getValues(0) + property->vertex.getNum());
+  } else {
+    candidate.points.resize(action->getNumCoordinates());
+    for (size_t i = 0; i < candidate.points.size(); ++i)
+      candidate.points[i] = action->getCoordinate3(i);
+  }
+  candidate.clockwise = action->getVertexOrdering() == SoShapeHints::CLOCKWISE;
+  // Strips split at a crease get more vertices and strips: only if no
+  // materials or texture coordinates are bound to them
+  const bool vertexMaterials = property && property->orderedRGBA.getNum();
+  const int materialBinding = vertexMaterials ? property->materialBinding.getValue() : action->getMaterialBinding();
+  candidate.splittable = materialBinding == SoMaterialBinding::OVERALL && !(property && property->texCoord.getNum())
+                         && action->getNumTextureCoordinates() == 0;
+  collector->shapes.push_back(candidate);
+  return SoCallbackAction::CONTINUE;
+}
+
+}
+
+
+//____________________________________________________________________
+NormalGenerator::NormalGenerator(float creaseAngle, Mode mode, int numThreads)
+: m_creaseAngle(creaseAngle),
+  m_mode(mode),
+  m_numThreads(numThreads > 0 ? numThreads : QThread::idealThreadCount())
+{
+  m_stats = Stats();
+}
+
+//____________________________________________________________________
+void NormalGenerator::apply(SoNode * root, bool overwrite)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+
+  // Collect first: the shapes are not changed during the traversal
+  Collector collector;
+  collector.overwrite = overwrite;
+  collector.skipped = 0;
+  SoCallbackAction collect;
+  collect.addPreCallback(SoFaceSet::getClassTypeId(), collectCB, &collector);
+  collect.addPreCallback(SoTriangleStripSet::getClassTypeId(), collectCB, &collector);
+  collect.addPreCallback(SoIndexedFaceSet::getClassTypeId(), collectCB, &collector);
+  collect.addPreCallback(SoIndexedTriangleStripSet::getClassTypeId(), collectCB, &collector);
+  collect.apply(root);
+
+  m_stats.shapes = collector.seen.size();
+  m_stats.skipped = collector.skipped;
+  for (size_t i = 0; i < collector.shapes.size(); ++i) {
+    const Candidate & candidate = collector.shapes[i];
+    candidate.shape->ref();
+    generate(candidate.shape, candidate.points, candidate.clockwise, candidate.splittable);
+    candidate.shape->unrefNoDelete();
+  }
+  m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void NormalGenerator::generate(SoVertexShape * shape, const std::vector<SbVec3f> & points, bool clockwise, bool splittable)
+{
+  const bool indexed = shape->isOfType(SoIndexedShape::getClassTypeId());
+  const bool strips = shape->isOfType(SoTriangleStripSet::getClassTypeId())
+                      || shape->isOfType(SoIndexedTriangleStripSet::getClassTypeId());
+  const int numPoints = points.size();
+
+  // The corners (positions used, in order) and where each primitive starts
+  std::vector<int> corner, primitiveStart;
+  if (indexed) {
+    const SoMFInt32 & coordIndex = static_cast<SoIndexedShape*>(shape)->coordIndex;
+    bool open = false;
+    for (int i = 0; i < coordIndex.getNum(); ++i) {
+      if (coordIndex[i] < 0) {
+        open = false;
+        continue;
+      }
+      if (coordIndex[i] >= numPoints) {
+        ++m_stats.skipped;
+        return;
+      }
+      if (!open)
+        primitiveStart.push_back(corner.size());
+      open = true;
+      corner.push_back(coordIndex[i]);
+    }
+  } else {
+    const SoNonIndexedShape * nonIndexed = static_cast<SoNonIndexedShape*>(shape);
+    const SoMFInt32 & numVertices = strips ? static_cast<SoTriangleStripSet*>(shape)->numVertices
+                                           : static_cast<SoFaceSet*>(shape)->numVertices;
+    if (nonIndexed->startIndex.getValue() != 0) {
+      ++m_stats.skipped; // normals and coordinates would not be consumed from the same place
+      return;
+    }
+    int next = 0;
+    for (int i = 0; i < numVertices.getNum() && next < numPoints; ++i) {
+      const int n = numVertices[i] < 0 ? numPoints - next : std::min(int(numVertices[i]), numPoints - next);
+      primitiveStart.push_back(corner.size());
+      for (int j = 0; j < n; ++j)
+        corner.push_back(next++);
+    }
+  }
+  const int numCorners = corner.size();
+  const int numPrimitives = primitiveStart.size();
+  primitiveStart.push_back(numCorners);
+
+  // Faces: whole polygons, or the triangles of the strips (every other one
+  // turned around); 'faceStart' of each primitive
+  std::vector<int> faceStart(numPrimitives + 1, 0);
+  for (int p = 0; p < numPrimitives; ++p) {
+    const int n = primitiveStart[p + 1] - primitiveStart[p];
+    faceStart[p + 1] = faceStart[p] + (strips ? std::max(n - 2, 0) : 1);
+  }
+  const int numFaces = faceStart[numPrimitives];
+  std::vector<int> faceCorner(numFaces), facePrimitive(numFaces);
+  for (int p = 0; p < numPrimitives; ++p)
+    for (int f = faceStart[p]; f < faceStart[p + 1]; ++f) {
+      facePrimitive[f] = p;
+      faceCorner[f] = primitiveStart[p] + (f - faceStart[p]);
+    }
+
+  // Area-weighted face normals (Newell's method for the polygons), and unit ones
+  std::vector<SbVec3f> weighted(numFaces), unit(numFaces);
+  parallelFor(numFaces, m_numThreads, [&](int begin, int end) {
+    for (int f = begin; f < end; ++f) {
+      SbVec3f n(0.0f, 0.0f, 0.0f);
+      const int c = faceCorner[f];
+      if (strips) {
+        const bool odd = (f - faceStart[facePrimitive[f]]) % 2 == 1;
+        const SbVec3f & a = points[corner[odd ? c + 1 : c]];
+        const SbVec3f & b = points[corner[odd ? c : c + 1]];
+        const SbVec3f & d = points[corner[c + 2]];
+        n = (b - a).cross(d - a);
+      } else {
+        const int last = primitiveStart[facePrimitive[f] + 1];
+        for (int i = c; i < last; ++i) {
+          const SbVec3f & p = points[corner[i]];
+          const SbVec3f & q = points[corner[i + 1 < last ? i + 1 : c]];
+          n += SbVec3f((p[1] - q[1]) * (p[2] + q[2]), (p[2] - q[2]) * (p[0] + q[0]), (p[0] - q[0]) * (p[1] + q[1]));
+        }
+      }
+      if (clockwise)
+        n.negate();
+      weighted[f] = n;
+      const float length = n.length();
+      unit[f] = length > 0.0f ? n / length : SbVec3f(0.0f, 0.0f, 0.0f);
+    }
+  });
+
+  // The faces touching each corner: its polygon, or up to three triangles
+  auto ownerFaces = [&](int c, int owners[3]) {
+    int p = std::upper_bound(primitiveStart.begin(), primitiveStart.end(), c) - primitiveStart.begin() - 1;
+    if (!strips) {
+      owners[0] = faceStart[p];
+      return 1;
+    }
+    const int k = c - primitiveStart[p], numTriangles = faceStart[p + 1] - faceStart[p];
+    int n = 0;
+    for (int t = std::max(k - 2, 0); t <= k && t < numTriangles; ++t)
+      owners[n++] = faceStart[p] + t;
+    return n;
+  };
+
+  // Per position (coincident points welded), the faces around it
+  std::vector<int> byPosition(numPoints), position(numPoints);
+  for (int i = 0; i < numPoints; ++i)
+    byPosition[i] = i;
+  std::sort(byPosition.begin(), byPosition.end(), [&](int a, int b) {
+    return std::lexicographical_compare(points[a].getValue(), points[a].getValue() + 3, points[b].getValue(), points[b].getValue() + 3);
+  });
+  int numPositions = 0;
+  for (int i = 0; i < numPoints; ++i) {
+    if (i && !(points[byPosition[i]] == points[byPosition[i - 1]]))
+      ++numPositions;
+    position[byPosition[i]] = numPositions;
+  }
+  ++numPositions;
+  std::vector<int> aroundStart(numPositions + 1, 0);
+  for (int f = 0; f < numFaces; ++f) {
+    const int p = facePrimitive[f], c = faceCorner[f];
+    const int end = strips ? c + 3 : primitiveStart[p + 1];
+    for (int i = c; i < end; ++i)
+      ++aroundStart[position[corner[i]] + 1];
+  }
+  for (int i = 0; i < numPositions; ++i)
+    aroundStart[i + 1] += aroundStart[i];
+  std::vector<int> around(aroundStart[numPositions]), fill(aroundStart.begin(), aroundStart.end() - 1);
+  for (int f = 0; f < numFaces; ++f) {
+    const int p = facePrimitive[f], c = faceCorner[f];
+    const int end = strips ? c + 3 : primitiveStart[p + 1];
+    for (int i = c; i < end; ++i)
+      around[fill[position[corner[i]]]++] = f;
+  }
+
+  // The normal of corner c, from the faces around its position within the
+  // crease angle of one of 'owners' (the faces it stands for)
+  const float cosCrease = std::cos(m_creaseAngle);
+  auto smooth = [&](int f, int g) {
+    return unit[f].length() <= 0.0f || unit[g].length() <= 0.0f || unit[f].dot(unit[g]) >= cosCrease;
+  };
+  auto cornerNormal = [&](int c, const int * owners, int numOwners) {
+    SbVec3f sum(0.0f, 0.0f, 0.0f);
+    const int pos = position[corner[c]];
+    for (int i = aroundStart[pos]; i < aroundStart[pos + 1]; ++i) {
+      const int f = around[i];
+      if (i > aroundStart[pos] && around[i - 1] == f)
+        continue; // a polygon passing twice through the point
+      for (int o = 0; o < numOwners; ++o) {
+        if (f == owners[o] || unit[f].dot(unit[owners[o]]) >= cosCrease) {
+          sum += weighted[f];
+          break;
+        }
+      }
+    }
+    if (sum.length() <= 0.0f && numOwners)
+      sum = unit[owners[0]];
+    const float length = sum.length();
+    return length > 0.0f ? sum / length : SbVec3f(0.0f, 0.0f, 1.0f);
+  };
+
+  // Corner normals. A strip vertex has one normal for up to three
+  // triangles: where these are across a crease, the strip is split, so
+  // that the vertex is repeated in the next strip with a normal of its
+  // own; only if it cannot be, the shape gets per-face normals.
+  bool perFace = m_mode == PER_FACE;
+  std::vector<SbVec3f> normals;
+  bool split = false;
+  std::vector<int> splitCorners;        // the corners of the split strips, in order
+  std::vector<int32_t> splitLengths;    // and their number in each strip
+  if (!perFace) {
+    normals.resize(numCorners);
+    std::vector<char> creased(numCorners, 0);
+    parallelFor(numCorners, m_numThreads, [&](int begin, int end) {
+      for (int c = begin; c < end; ++c) {
+        int owners[3];
+        const int numOwners = ownerFaces(c, owners);
+        for (int i = 0; i < numOwners; ++i)
+          for (int j = i + 1; j < numOwners; ++j)
+            if (!smooth(owners[i], owners[j]))
+              creased[c] = 1;
+        normals[c] = cornerNormal(c, owners, numOwners);
+      }
+    });
+    split = std::find(creased.begin(), creased.end(), 1) != creased.end();
+    perFace = split && !splittable;
+    split = split && splittable;
+  }
+  if (split) {
+    std::vector<SbVec3f> splitNormals;
+    // A strip of the local vertices [first, last] of primitive p, whose
+    // normals only come from the triangles [runStart, runEnd]
+    auto addStrip = [&](int p, int first, int last, int runStart, int runEnd, bool turned) {
+      for (int v = first; v <= last; ++v) {
+        const int k = turned && v < first + 2 ? first + 1 - (v - first) : v; // (turned: first two swapped)
+        int owners[3], numOwners = 0;
+        for (int t = std::max(k - 2, runStart); t <= std::min(k, runEnd); ++t)
+          owners[numOwners++] = faceStart[p] + t;
+        const int c = primitiveStart[p] + k;
+        splitCorners.push_back(c);
+        splitNormals.push_back(numOwners ? cornerNormal(c, owners, numOwners) : normals[c]);
+      }
+      splitLengths.push_back(last - first + 1);
+    };
+    for (int p = 0; p < numPrimitives; ++p) {
+      const int numTriangles = faceStart[p + 1] - faceStart[p];
+      if (!numTriangles) {
+        addStrip(p, 0, primitiveStart[p + 1] - primitiveStart[p] - 1, 0, -1, false);
+        continue;
+      }
+      // Runs of triangles with no crease between two of them sharing a vertex
+      const int f0 = faceStart[p];
+      for (int runStart = 0, runEnd = 0; runStart < numTriangles; runStart = runEnd + 1) {
+        runEnd = runStart;
+        while (runEnd + 1 < numTriangles && smooth(f0 + runEnd + 1, f0 + runEnd)
+               && (runEnd == runStart || smooth(f0 + runEnd + 1, f0 + runEnd - 1)))
+          ++runEnd;
+        // A strip starts with an even triangle: an odd first one is a
+        // strip of its own, with its first two vertices swapped
+        int first = runStart;
+        if (first % 2) {
+          addStrip(p, first, first + 2, runStart, runEnd, true);
+          ++first;
+        }
+        if (first <= runEnd)
+          addStrip(p, first, runEnd + 2, runStart, runEnd, false);
+      }
+    }
+    normals.swap(splitNormals);
+  }
+
+  // Stored in the vertex property of the shape. Only the normals: with
+  // its vertex field empty, it leaves the coordinates of the state alone
+  // (their later edits are seen, bound tables stay bound)
+  SoVertexProperty * property = static_cast<SoVertexProperty*>(shape->vertexProperty.getValue());
+  if (!property) {
+    property = new SoVertexProperty;
+    shape->vertexProperty = property;
+  }
+  if (split && !indexed) {
+    // The vertices are used in order: repeated ones are copied, in a
+    // vertex property of the shape's own
+    property = static_cast<SoVertexProperty*>(property->copy());
+    shape->vertexProperty = property;
+    property->vertex.setNum(splitCorners.size());
+    SbVec3f * out = property->vertex.startEditing();
+    for (size_t i = 0; i < splitCorners.size(); ++i)
+      out[i] = points[corner[splitCorners[i]]];
+    property->vertex.finishEditing();
+    SoMFInt32 & numVertices = static_cast<SoTriangleStripSet*>(shape)->numVertices;
+    numVertices.setValues(0, splitLengths.size(), splitLengths.data());
+    numVertices.setNum(splitLengths.size());
+  }
+  if (perFace) {
+    property->normal.setNum(numFaces);
+    SbVec3f * out = property->normal.startEditing();
+    for (int f = 0; f < numFaces; ++f)
+      out[f] = unit[f].length() > 0.0f ? unit[f] : SbVec3f(0.0f, 0.0f, 1.0f);
+    property->normal.finishEditing();
+    property->normalBinding = SoVertexProperty::PER_FACE;
+    if (indexed)
+      static_cast<SoIndexedShape*>(shape)->normalIndex.setNum(0);
+    ++m_stats.perFace;
+  } else if (indexed) {
+    // Shared normals, indexed like the coordinates
+    std::map<std::vector<float>, int> unique;
+    std::vector<SbVec3f> values;
+    SoMFInt32 & normalIndex = static_cast<SoIndexedShape*>(shape)->normalIndex;
+    SoMFInt32 & coordIndex = static_cast<SoIndexedShape*>(shape)->coordIndex;
+    if (split) {
+      std::vector<int32_t> splitIndex;
+      for (size_t s = 0, i = 0; s < splitLengths.size(); ++s) {
+        for (int v = 0; v < splitLengths[s]; ++v)
+          splitIndex.push_back(corner[splitCorners[i++]]);
+        splitIndex.push_back(-1);
+      }
+      coordIndex.setValues(0, splitIndex.size(), splitIndex.data());
+      coordIndex.setNum(splitIndex.size());
+    }
+    std::vector<int32_t> indices;
+    int c = 0;
+    for (int i = 0; i < coordIndex.getNum(); ++i) {
+      if (coordIndex[i] < 0) {
+        indices.push_back(-1);
+        continue;
+      }
+      const SbVec3f & n = normals[c++];
+      const std::vector<float> key(n.getValue(), n.getValue() + 3);
+      std::map<std::vector<float>, int>::const_iterator it = unique.find(key);
+      if (it == unique.end()) {
+        it = unique.insert(std::make_pair(key, int(values.size()))).first;
+        values.push_back(n);
+      }
+      indices.push_back(it->second);
+    }
+    property->normal.setValues(0, values.size(), values.data());
+    property->normal.setNum(values.size());
+    property->normalBinding = SoVertexProperty::PER_VERTEX_INDEXED;
+    normalIndex.setValues(0, indices.size(), indices.data());
+    normalIndex.setNum(indices.size());
+  } else {
+    property->normal.setValues(0, normals.size(), normals.data());
+    property->normal.setNum(normals.size());
+    property->normalBinding = SoVertexProperty::PER_VERTEX;
+  }
+  if (split)
+    ++m_stats.split;
+  ++m_stats.generated;
+  m_stats.faces += numFaces;
+  m_stats.corners += numCorners;
+}
+
+//____________________________________________________________________
+void NormalGenerator::printStats() const
+{
+  printf("normal generator: %u shapes, %u with new normals (%u per face, %u with strips split at creases), "
+         "%u skipped, %u faces, %u corners, %.2f ms (%d threads)\n",
+         m_stats.shapes, m_stats.generated, m_stats.perFace, m_stats.split, m_stats.skipped, m_stats.faces,
+         m_stats.corners, m_stats.time, m_numThreads);
+  fflush(stdout);
+}
@@ -0,0 +1,65 @@
+#ifndef NORMALGENERATOR_H
+#define NORMALGENERATOR_H
+
+#include <Inventor/SbVec3f.h>
+
+#include <vector>
+
+class SoNode;
+class SoVertexShape;
+
+// Computes the normals of strip and face sets once, and stores them in
+// the SoVertexProperty of each shape, so that Coin does not regenerate
+// them each time a render cache is rebuilt.
+//
+// Handled: SoFaceSet, SoTriangleStripSet, SoIndexedFaceSet and
+// SoIndexedTriangleStripSet, with their coordinates taken from their own
+// vertex property or from the traversal state (then only the normals go
+// into the vertex property, the coordinates stay where they are). Normals follow the vertex ordering of the shape hints,
+// as Coin's own generator does.
+//
+// Per-vertex normals are crease-angle aware: the normal at a corner is
+// the area-weighted average of the faces around the same position whose
+// normal is within the crease angle of the corner's face, so hard edges
+// stay hard across separate polygons. A vertex inside a strip belongs to
+// up to three triangles and can only have one normal: if these triangles
+// are across a crease, the strip is split there, and the vertices at the
+// crease are repeated in the next strip with normals of their own (for
+// SoTriangleStripSet, in a copy of the vertex property). Strips with
+// materials or texture coordinates bound to them cannot be split: such a
+// shape gets per-face (per-triangle) normals instead.
+//
+// Face and corner normals are computed in parallel on large meshes.
+class NormalGenerator {
+public:
+  enum Mode { PER_VERTEX, PER_FACE };
+
+  struct Stats {
+    unsigned shapes;    // strip and face sets found
+    unsigned generated;
+    unsigned perFace;   // of which got per-face normals
+    unsigned split;     // of which had strips split at creases
+    unsigned skipped;   // already with normals, or with a startIndex
+    unsigned faces, corners;
+    double time;        // ms
+  };
+
+  // creaseAngle in radians; numThreads 0 means one per core
+  NormalGenerator(float creaseAngle = 0.5f, Mode mode = PER_VERTEX, int numThreads = 0);
+
+  // Shapes which have normals already are skipped, unless 'overwrite'
+  void apply(SoNode * root, bool overwrite = false);
+
+  const Stats & stats() const { return m_stats; }
+  void printStats() const;
+
+private:
+  float m_creaseAngle;
+  Mode m_mode;
+  int m_numThreads;
+  Stats m_stats;
+
+  void generate(SoVertexShape * shape, const std::vector<SbVec3f> & points, bool clockwise, bool splittable);
+};
+
+#endif
@@ -0,0 +1,422 @@
+#include "Stripifier.h"
+
+#include <Inventor/SbMatrix.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoTriangleStripSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+
+namespace {
+
+// A welded vertex: position, normal (zero when normals are per face) and
+// texture coordinates, compared bitwise
+struct VertexKey {
+  float v[10];
+  bool operator<(const VertexKey & other) const { return memcmp(v, other.v, sizeof(v)) < 0; }
+};
+
+uint64_t edgeKey(int a, int b)
+{
+  if (a > b)
+    std::swap(a, b);
+  return (uint64_t(uint32_t(a)) << 32) | uint32_t(b);
+}
+
+// Whether (a, b, c) is a rotation of the triangle t
+bool sameWinding(const int * t, int a, int b, int c)
+{
+  for (int r = 0; r < 3; ++r)
+    if (t[r] == a && t[(r + 1) % 3] == b && t[(r + 2) % 3] == c)
+      return true;
+  return false;
+}
+
+}
+
+
+//____________________________________________________________________
+Stripifier::Stripifier()
+: m_shininess(0.2f),
+  m_vertexOrdering(SoShapeHints::UNKNOWN_ORDERING),
+  m_shapeType(SoShapeHints::UNKNOWN_SHAPE_TYPE),
+  m_hasMaterial(false)
+{
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response Stripifier::preShapeCB(void * data, SoCallbackAction * action, const SoNode * node)
+{
+  Stripifier * self = static_cast<Stripifier*>(data);
+  if (!self->m_stats.shapes) {
+    self->m_vertexOrdering = action->getVertexOrdering();
+    self->m_shapeType = action->getShapeType();
+  }
+  ++self->m_stats.shapes;
+  if (node->isOfType(SoIndexedFaceSet::getClassTypeId())) {
+    const SoMFInt32 & index = static_cast<const SoIndexedFaceSet*>(node)->coordIndex;
+    for (int i = 0; i < index.getNum(); ++i)
+      if (index[i] >= 0)
+        ++self->m_stats.inputVertices;
+  } else {
+    // A negative count ("all the remaining coordinates") is not counted
+    const SoMFInt32 & counts = static_cast<const SoFaceSet*>(node)->numVertices;
+    for (int i = 0; i < counts.getNum(); ++i)
+      if (counts[i] > 0)
+        self->m_stats.inputVertices += counts[i];
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void Stripifier::triangleCB(void * data, SoCallbackAction * action, const SoPrimitiveVertex * v1,
+                            const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3)
+{
+  Stripifier * self = static_cast<Stripifier*>(data);
+  const SbMatrix & model = action->getModelMatrix();
+  const SbMatrix normalMatrix = model.inverse().transpose();
+  const SoPrimitiveVertex * vertices[3] = { v1, v2, v3 };
+  Triangle triangle;
+  for (int i = 0; i < 3; ++i) {
+    Corner & corner = triangle.corners[i];
+    model.multVecMatrix(vertices[i]->getPoint(), corner.point);
+    normalMatrix.multDirMatrix(vertices[i]->getNormal(), corner.normal);
+    corner.normal.normalize();
+    corner.texCoord = vertices[i]->getTextureCoords();
+  }
+
+  // The material of the face, from its first vertex
+  SbColor ambient, diffuse, specular, emissive;
+  float shininess, transparency;
+  action->getMaterial(ambient, diffuse, specular, emissive, shininess, transparency, v1->getMaterialIndex());
+  if (!self->m_hasMaterial) {
+    self->m_ambient = ambient;
+    self->m_specular = specular;
+    self->m_emissive = emissive;
+    self->m_shininess = shininess;
+    self->m_hasMaterial = true;
+  }
+  triangle.material = -1;
+  for (size_t i = 0; i < self->m_colors.size() && triangle.material < 0; ++i)
+    if (self->m_colors[i] == diffuse && self->m_transparencies[i] == transparency)
+      triangle.material = i;
+  if (triangle.material < 0) {
+    triangle.material = self->m_colors.size();
+    self->m_colors.push_back(diffuse);
+    self->m_transparencies.push_back(transparency);
+  }
+  self->m_triangles.push_back(triangle);
+}
+
+//____________________________________________________________________
+SoSeparator * Stripifier::stripify(SoNode * root, Output output)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_triangles.clear();
+  m_colors.clear();
+  m_transparencies.clear();
+  m_hasMaterial = false;
+  memset(&m_stats, 0, sizeof(m_stats));
+
+  SoCallbackAction collect;
+  collect.addPreCallback(SoFaceSet::getClassTypeId(), preShapeCB, this);
+  collect.addPreCallback(SoIndexedFaceSet::getClassTypeId(), preShapeCB, this);
+  collect.addTriangleCallback(SoFaceSet::getClassTypeId(), triangleCB, this);
+  collect.addTriangleCallback(SoIndexedFaceSet::getClassTypeId(), triangleCB, this);
+  collect.apply(root);
+  m_stats.triangles = m_triangles.size();
+
+  // Flat normals go per face, and then do not split the vertices
+  bool flat = true, textured = false;
+  for (size_t t = 0; t < m_triangles.size(); ++t) {
+    const Corner * c = m_triangles[t].corners;
+    if (!(c[0].normal == c[1].normal) || !(c[0].normal == c[2].normal))
+      flat = false;
+    for (int i = 0; i < 3; ++i)
+      if (!(c[i].texCoord == SbVec4f(0, 0, 0, 1)))
+        textured = true;
+  }
+
+  // Welding
+  std::map<VertexKey, int> welded;
+  std::vector<const Corner *> vertices;
+  std::vector<int> indices(3 * m_triangles.size());
+  for (size_t t = 0; t < m_triangles.size(); ++t) {
+    for (int i = 0; i < 3; ++i) {
+      const Corner & corner = m_triangles[t].corners[i];
+      VertexKey key;
+      memset(&key, 0, sizeof(key));
+      memcpy(key.v, corner.point.getValue(), 3 * sizeof(float));
+      if (!flat)
+        memcpy(key.v + 3, corner.normal.getValue(), 3 * sizeof(float));
+      if (textured)
+        memcpy(key.v + 6, corner.texCoord.getValue(), 4 * sizeof(float));
+      std::map<VertexKey, int>::const_iterator it = welded.find(key);
+      if (it == welded.end()) {
+        it = welded.insert(std::make_pair(key, int(vertices.size()))).first;
+        vertices.push_back(&corner);
+      }
+      indices[3 * t + i] = it->second;
+    }
+  }
+  m_stats.uniqueVertices = vertices.size();
+
+  std::vector<std::vector<int> > strips, stripTriangles;
+  buildStrips(indices, strips, stripTriangles);
+  m_stats.strips = strips.size();
+
+  // The scene
+  SoSeparator * result = new SoSeparator;
+  result->ref();
+  SoShapeHints * hints = new SoShapeHints;
+  hints->vertexOrdering = m_vertexOrdering;
+  hints->shapeType = m_shapeType;
+  result->addChild(hints);
+  const bool perFaceMaterial = m_colors.size() > 1;
+  if (m_hasMaterial) {
+    SoMaterial * material = new SoMaterial;
+    material->ambientColor = m_ambient;
+    material->diffuseColor = m_colors[0];
+    material->specularColor = m_specular;
+    material->emissiveColor = m_emissive;
+    material->shininess = m_shininess;
+    material->transparency = m_transparencies[0];
+    result->addChild(material);
+  }
+
+  SoVertexProperty * property = new SoVertexProperty;
+  // Per face data, in the order of the triangles along the strips
+  if (flat || perFaceMaterial) {
+    unsigned face = 0;
+    if (flat)
+      property->normal.setNum(m_triangles.size());
+    if (perFaceMaterial)
+      property->orderedRGBA.setNum(m_triangles.size());
+    SbVec3f * normals = flat ? property->normal.startEditing() : 0;
+    uint32_t * colors = perFaceMaterial ? property->orderedRGBA.startEditing() : 0;
+    for (size_t s = 0; s < stripTriangles.size(); ++s) {
+      for (size_t i = 0; i < stripTriangles[s].size(); ++i, ++face) {
+        const Triangle & triangle = m_triangles[stripTriangles[s][i]];
+        if (normals)
+          normals[face] = triangle.corners[0].normal;
+        if (colors)
+          colors[face] = m_colors[triangle.material].getPackedValue(m_transparencies[triangle.material]);
+      }
+    }
+    if (normals)
+      property->normal.finishEditing();
+    if (colors)
+      property->orderedRGBA.finishEditing();
+    if (flat)
+      property->normalBinding = SoVertexProperty::PER_FACE;
+    if (perFaceMaterial)
+      property->materialBinding = SoVertexProperty::PER_FACE;
+  }
+
+  if (output == INDEXED) {
+    property->vertex.setNum(vertices.size());
+    SbVec3f * points = property->vertex.startEditing();
+    for (size_t i = 0; i < vertices.size(); ++i)
+      points[i] = vertices[i]->point;
+    property->vertex.finishEditing();
+    if (!flat) {
+      property->normal.setNum(vertices.size());
+      SbVec3f * normals = property->normal.startEditing();
+      for (size_t i = 0; i < vertices.size(); ++i)
+        normals[i] = vertices[i]->normal;
+      property->normal.finishEditing();
+      property->normalBinding = SoVertexProperty::PER_VERTEX_INDEXED; // through coordIndex
+    }
+    if (textured) {
+      property->texCoord.setNum(vertices.size());
+      SbVec2f * texCoords = property->texCoord.startEditing();
+      for (size_t i = 0; i < vertices.size(); ++i)
+        texCoords[i].setValue(vertices[i]->texCoord[0], vertices[i]->texCoord[1]);
+      property->texCoord.finishEditing();
+    }
+
+    std::vector<int32_t> coordIndex;
+    for (size_t s = 0; s < strips.size(); ++s) {
+      if (s)
+        coordIndex.push_back(-1);
+      coordIndex.insert(coordIndex.end(), strips[s].begin(), strips[s].end());
+      m_stats.outputVertices += strips[s].size();
+    }
+    SoIndexedTriangleStripSet * shape = new SoIndexedTriangleStripSet;
+    shape->vertexProperty = property;
+    shape->coordIndex.setValues(0, coordIndex.size(), coordIndex.data());
+    result->addChild(shape);
+  } else {
+    std::vector<int32_t> numVertices;
+    std::vector<int> order; // the welded vertices, strip after strip
+    for (size_t s = 0; s < strips.size(); ++s) {
+      numVertices.push_back(strips[s].size());
+      order.insert(order.end(), strips[s].begin(), strips[s].end());
+    }
+    m_stats.outputVertices = order.size();
+    property->vertex.setNum(order.size());
+    SbVec3f * points = property->vertex.startEditing();
+    for (size_t i = 0; i < order.size(); ++i)
+      points[i] = vertices[order[i]]->point;
+    property->vertex.finishEditing();
+    if (!flat) {
+      property->normal.setNum(order.size());
+      SbVec3f * normals = property->normal.startEditing();
+      for (size_t i = 0; i < order.size(); ++i)
+        normals[i] = vertices[order[i]]->normal;
+      property->normal.finishEditing();
+      property->normalBinding = SoVertexProperty::PER_VERTEX;
+    }
+    if (textured) {
+      property->texCoord.setNum(order.size());
+      SbVec2f * texCoords = property->texCoord.startEditing();
+      for (size_t i = 0; i < order.size(); ++i)
+        texCoords[i].setValue(vertices[order[i]]->texCoord[0], vertices[order[i]]->texCoord[1]);
+      property->texCoord.finishEditing();
+    }
+    SoTriangleStripSet * shape = new SoTriangleStripSet;
+    shape->vertexProperty = property;
+    shape->numVertices.setValues(0, numVertices.size(), numVertices.data());
+    result->addChild(shape);
+  }
+
+  m_triangles.clear();
+  m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  result->unrefNoDelete();
+  return result;
+}
+
+//____________________________________________________________________
+void Stripifier::buildStrips(const std::vector<int> & indices, std::vector<std::vector<int> > & strips,
+                             std::vector<std::vector<int> > & stripTriangles)
+{
+  const int numTriangles = indices.size() / 3;
+
+  // Triangles around each edge
+  std::unordered_map<uint64_t, std::vector<int> > edges;
+  for (int t = 0; t < numTriangles; ++t)
+    for (int i = 0; i < 3; ++i)
+      edges[edgeKey(indices[3 * t + i], indices[3 * t + (i + 1) % 3])].push_back(t);
+
+  // Free neighbours of each triangle, and the triangles by that number
+  // (lazily updated: an entry is valid if the count still matches)
+  std::vector<int> degree(numTriangles, 0);
+  for (int t = 0; t < numTriangles; ++t)
+    for (int i = 0; i < 3; ++i)
+      degree[t] += edges[edgeKey(indices[3 * t + i], indices[3 * t + (i + 1) % 3])].size() - 1;
+  std::vector<std::vector<int> > buckets(4);
+  for (int t = numTriangles - 1; t >= 0; --t)
+    buckets[std::min(degree[t], 3)].push_back(t);
+
+  std::vector<bool> used(numTriangles, false);
+  std::vector<unsigned> trial(numTriangles, 0); // stamp of the trial strip using the triangle
+  unsigned stamp = 0;
+
+  // Grows a strip from triangle 'first' started at corner 'rotation'
+  std::vector<int> vertices, triangles;
+  auto grow = [&](int first, int rotation) {
+    ++stamp;
+    vertices.clear();
+    triangles.clear();
+    for (int i = 0; i < 3; ++i)
+      vertices.push_back(indices[3 * first + (rotation + i) % 3]);
+    triangles.push_back(first);
+    trial[first] = stamp;
+    for (;;) {
+      const size_t n = vertices.size();
+      const int a = vertices[n - 2], b = vertices[n - 1];
+      const bool odd = (n - 2) % 2 == 1; // of the triangle to come
+      const std::vector<int> & around = edges[edgeKey(a, b)];
+      int best = -1, bestThird = -1;
+      for (size_t i = 0; i < around.size(); ++i) {
+        const int t = around[i];
+        if (used[t] || trial[t] == stamp)
+          continue;
+        const int * v = &indices[3 * t];
+        int third = -1;
+        for (int j = 0; j < 3; ++j)
+          if (v[j] != a && v[j] != b)
+            third = v[j];
+        if (third < 0)
+          continue; // degenerate
+        if (!(odd ? sameWinding(v, b, a, third) : sameWinding(v, a, b, third)))
+          continue;
+        if (best < 0 || degree[t] < degree[best]) {
+          best = t;
+          bestThird = third;
+        }
+      }
+      if (best < 0)
+        break;
+      vertices.push_back(bestThird);
+      triangles.push_back(best);
+      trial[best] = stamp;
+    }
+  };
+
+  for (size_t bucket = 0; bucket < buckets.size();) {
+    if (buckets[bucket].empty()) {
+      ++bucket;
+      continue;
+    }
+    const int first = buckets[bucket].back();
+    buckets[bucket].pop_back();
+    if (used[first] || std::min(degree[first], 3) != int(bucket))
+      continue;
+
+    // The longest of the three orientations
+    int bestRotation = 0;
+    size_t bestLength = 0;
+    for (int rotation = 0; rotation < 3; ++rotation) {
+      grow(first, rotation);
+      if (triangles.size() > bestLength) {
+        bestLength = triangles.size();
+        bestRotation = rotation;
+      }
+    }
+    grow(first, bestRotation);
+
+    for (size_t i = 0; i < triangles.size(); ++i) {
+      const int t = triangles[i];
+      used[t] = true;
+      for (int j = 0; j < 3; ++j) {
+        const std::vector<int> & around = edges[edgeKey(indices[3 * t + j], indices[3 * t + (j + 1) % 3])];
+        for (size_t k = 0; k < around.size(); ++k) {
+          const int neighbour = around[k];
+          if (neighbour == t || used[neighbour])
+            continue;
+          --degree[neighbour];
+          const int b = std::min(std::max(degree[neighbour], 0), 3);
+          buckets[b].push_back(neighbour);
+          bucket = std::min(bucket, size_t(b));
+        }
+      }
+    }
+    strips.push_back(vertices);
+    stripTriangles.push_back(triangles);
+  }
+}
+
+//____________________________________________________________________
+void Stripifier::printStats() const
+{
+  printf("stripifier: %u shapes, %u triangles, %u strips (%.1f triangles per strip), "
+         "%u -> %u vertices sent (%u unique), %.2f ms\n",
+         m_stats.shapes, m_stats.triangles, m_stats.strips, m_stats.averageStripLength(),
+         m_stats.inputVertices, m_stats.outputVertices, m_stats.uniqueVertices, m_stats.time);
+  fflush(stdout);
+}
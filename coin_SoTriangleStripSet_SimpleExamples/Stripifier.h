@@ -0,0 +1,87 @@
+#ifndef STRIPIFIER_H
+#define STRIPIFIER_H
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/SbColor.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbVec4f.h>
+
+#include <vector>
+
+class SoNode;
+class SoPrimitiveVertex;
+class SoSeparator;
+
+// Converts the SoFaceSet and SoIndexedFaceSet shapes of a subgraph into
+// long triangle strips.
+//
+// The faces (triangles, quads, or any polygon Coin can tessellate) are
+// collected with an SoCallbackAction, so coordinates, normals, materials
+// and transformations come from the traversal state, whatever the
+// bindings used. Identical vertices are welded, and strips are grown
+// greedily from the triangles with the fewest free neighbours, trying the
+// three orientations of the first triangle and keeping the longest strip.
+// The winding of every triangle is kept.
+//
+// Flat normals (the three normals of each triangle equal, e.g. PER_FACE
+// bindings) become PER_FACE normals on the strips, so faces with
+// different normals can still share a strip; otherwise normals are per
+// vertex and are part of the welding. Materials are kept the same way:
+// a single SoMaterial if all faces share one, otherwise PER_FACE diffuse
+// colours and transparency (the other material components come from the
+// first face).
+//
+// The result is an SoIndexedTriangleStripSet with -1 between the strips,
+// or an SoTriangleStripSet with the vertices of each strip laid out in
+// order; both take their data from an SoVertexProperty.
+class Stripifier {
+public:
+  enum Output { INDEXED, NON_INDEXED };
+
+  struct Stats {
+    unsigned shapes;
+    unsigned inputVertices;  // as sent by the face sets (one per polygon corner)
+    unsigned triangles;
+    unsigned uniqueVertices; // after welding
+    unsigned strips;
+    unsigned outputVertices; // as sent by the strips
+    double time;             // ms
+    double averageStripLength() const { return strips ? double(triangles) / strips : 0.0; }
+  };
+
+  Stripifier();
+
+  // A separator with the shape hints, material and strip set replacing
+  // the face sets below 'root', in the coordinate system of 'root'
+  SoSeparator * stripify(SoNode * root, Output output = INDEXED);
+
+  const Stats & stats() const { return m_stats; }
+  void printStats() const;
+
+private:
+  struct Corner {
+    SbVec3f point, normal;
+    SbVec4f texCoord;
+  };
+  struct Triangle {
+    Corner corners[3];
+    int material;  // index in m_colors
+  };
+  std::vector<Triangle> m_triangles;
+  std::vector<SbColor> m_colors;
+  std::vector<float> m_transparencies;
+  SbColor m_ambient, m_specular, m_emissive;
+  float m_shininess;
+  int m_vertexOrdering, m_shapeType;
+  bool m_hasMaterial;
+  Stats m_stats;
+
+  static SoCallbackAction::Response preShapeCB(void * data, SoCallbackAction * action, const SoNode * node);
+  static void triangleCB(void * data, SoCallbackAction * action, const SoPrimitiveVertex * v1,
+                         const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3);
+
+  static void buildStrips(const std::vector<int> & indices, std::vector<std::vector<int> > & strips,
+                          std::vector<std::vector<int> > & stripTriangles);
+};
+
+#endif
@@ -0,0 +1,610 @@
+#include "Triangulator.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/elements/SoCoordinateElement.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCoordinate4.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/sensors/SoOneShotSensor.h>
+#include <Inventor/SoPath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <set>
+
+
+namespace {
+
+struct Point2 {
+  double x, y;
+  bool operator==(const Point2 & other) const { return x == other.x && y == other.y; }
+};
+
+// Twice the signed area of (a, b, c), positive if counterclockwise
+double cross(const Point2 & a, const Point2 & b, const Point2 & c)
+{
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// Whether p is in the triangle (a, b, c), edges included, whichever its orientation
+bool inTriangle(const Point2 & a, const Point2 & b, const Point2 & c, const Point2 & p)
+{
+  const double ab = cross(a, b, p), bc = cross(b, c, p), ca = cross(c, a, p);
+  return (ab >= 0.0 && bc >= 0.0 && ca >= 0.0) || (ab <= 0.0 && bc <= 0.0 && ca <= 0.0);
+}
+
+double ringArea(const std::vector<int> & ring, const std::vector<Point2> & xy)
+{
+  double area = 0.0;
+  for (size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++)
+    area += (xy[ring[j]].x - xy[ring[i]].x) * (xy[ring[j]].y + xy[ring[i]].y);
+  return area / 2.0;
+}
+
+// Whether the point p is inside the corner (a, b, c) of a counterclockwise polygon
+bool opensTowards(const Point2 & a, const Point2 & b, const Point2 & c, const Point2 & p)
+{
+  if (cross(a, b, c) >= 0.0)
+    return cross(b, c, p) >= 0.0 && cross(a, b, p) >= 0.0;
+  return cross(b, c, p) >= 0.0 || cross(a, b, p) >= 0.0;
+}
+
+// Joins a hole to the (counterclockwise) outline with a bridge from the
+// rightmost vertex of the hole to a vertex of the outline it can see
+void bridge(std::vector<int> & outline, const std::vector<int> & hole, const std::vector<Point2> & xy)
+{
+  size_t m = 0;
+  for (size_t i = 1; i < hole.size(); ++i)
+    if (xy[hole[i]].x > xy[hole[m]].x)
+      m = i;
+  const Point2 & hm = xy[hole[m]];
+
+  // The nearest edge of the outline hit by a ray from there towards +x
+  const size_t n = outline.size();
+  double hitX = std::numeric_limits<double>::max();
+  size_t edge = n;
+  for (size_t i = 0; i < n; ++i) {
+    const Point2 & a = xy[outline[i]];
+    const Point2 & b = xy[outline[(i + 1) % n]];
+    if (a.y == b.y || hm.y < std::min(a.y, b.y) || hm.y > std::max(a.y, b.y))
+      continue;
+    const double x = a.x + (hm.y - a.y) * (b.x - a.x) / (b.y - a.y);
+    if (x >= hm.x && x < hitX) {
+      hitX = x;
+      edge = i;
+    }
+  }
+  if (edge == n)
+    return; // not inside the outline: ignored
+
+  // The end of that edge furthest along the ray, unless a vertex in the
+  // triangle (hole vertex, hit, end) hides it: then the one of those closest
+  // in angle to the ray
+  size_t p = xy[outline[edge]].x > xy[outline[(edge + 1) % n]].x ? edge : (edge + 1) % n;
+  const Point2 hit = { hitX, hm.y };
+  const Point2 end = xy[outline[p]];
+  double best = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < n; ++i) {
+    const Point2 & v = xy[outline[i]];
+    // (the ends of earlier bridges are there twice: the right one of the
+    // two is the one whose corner opens towards the hole)
+    if (i == p || v.x <= hm.x || !inTriangle(hm, hit, end, v)
+        || !opensTowards(xy[outline[(i + n - 1) % n]], v, xy[outline[(i + 1) % n]], hm))
+      continue;
+    const double slope = std::fabs(v.y - hm.y) / (v.x - hm.x);
+    if (slope < best || (slope == best && v.x < xy[outline[p]].x)) {
+      best = slope;
+      p = i;
+    }
+  }
+
+  // outline ... p, hole m ... m, p ... outline
+  std::vector<int> joined(outline.begin(), outline.begin() + p + 1);
+  for (size_t i = 0; i <= hole.size(); ++i)
+    joined.push_back(hole[(m + i) % hole.size()]);
+  joined.insert(joined.end(), outline.begin() + p, outline.end());
+  outline.swap(joined);
+}
+
+// Ear clipping of a counterclockwise ring (with bridges), triangles appended to 'out'
+void clipEars(const std::vector<int> & ring, const std::vector<Point2> & xy, std::vector<int> & out)
+{
+  const int n = ring.size();
+  if (n < 3)
+    return;
+  std::vector<int> prev(n), next(n);
+  for (int i = 0; i < n; ++i) {
+    prev[i] = (i + n - 1) % n;
+    next[i] = (i + 1) % n;
+  }
+  auto corner = [&](int i) -> const Point2 & { return xy[ring[i]]; };
+  auto turn = [&](int i) { return cross(corner(prev[i]), corner(i), corner(next[i])); };
+  auto isEar = [&](int i) {
+    if (turn(i) <= 0.0)
+      return false;
+    const Point2 & a = corner(prev[i]), & b = corner(i), & c = corner(next[i]);
+    for (int j = next[next[i]]; j != prev[i]; j = next[j]) {
+      const Point2 & p = corner(j);
+      // the duplicated ends of bridges do not count
+      if (!(p == a) && !(p == b) && !(p == c) && inTriangle(a, b, c, p))
+        return false;
+    }
+    return true;
+  };
+  auto emit = [&](int i) {
+    out.push_back(ring[prev[i]]);
+    out.push_back(ring[i]);
+    out.push_back(ring[next[i]]);
+  };
+  auto remove = [&](int i) {
+    next[prev[i]] = next[i];
+    prev[next[i]] = prev[i];
+  };
+
+  int remaining = n, current = 0, stalled = 0;
+  while (remaining > 3) {
+    if (isEar(current)) {
+      emit(current);
+      remove(current);
+      --remaining;
+      current = next[current];
+      stalled = 0;
+      continue;
+    }
+    current = next[current];
+    if (++stalled < remaining)
+      continue;
+
+    // No ear left (self-intersecting or degenerate polygon): drop a flat
+    // vertex, otherwise cut a convex one, otherwise the current one
+    int cut = -1;
+    bool flat = false;
+    int i = current;
+    do {
+      if (turn(i) == 0.0) {
+        cut = i;
+        flat = true;
+      }
+      i = next[i];
+    } while (i != current && cut < 0);
+    for (i = next[current]; cut < 0; i = next[i])
+      if (turn(i) > 0.0 || i == current)
+        cut = i;
+    if (!flat)
+      emit(cut);
+    remove(cut);
+    --remaining;
+    current = next[cut];
+    stalled = 0;
+  }
+  if (turn(current) != 0.0)
+    emit(current);
+}
+
+// The coordinates a shape reads, and the node id of the node they come from
+SbUniqueId readPoints(SoCallbackAction * action, const SoVertexProperty * property, std::vector<SbVec3f> & points)
+{
+  if (property && property->vertex.getNum()) {
+    points.assign(property->vertex.getValues(0), property->vertex.getValues(0) + property->vertex.getNum());
+    return property->getNodeId();
+  }
+  points.resize(action->getNumCoordinates());
+  for (size_t i = 0; i < points.size(); ++i)
+    points[i] = action->getCoordinate3(i);
+  return SoCoordinateElement::getInstance(action->getState())->getNodeId();
+}
+
+// The sizes of the polygons of a face set with 'numPoints' coordinates
+std::vector<int32_t> polygonSizes(const std::vector<int32_t> & numVertices, int numPoints)
+{
+  std::vector<int32_t> counts;
+  for (int i = 0, next = 0; i < int(numVertices.size()) && next < numPoints; ++i) {
+    const int n = numVertices[i] < 0 ? numPoints - next : std::min(int(numVertices[i]), numPoints - next);
+    counts.push_back(n);
+    next += n;
+  }
+  return counts;
+}
+
+struct Visit {
+  SoFaceSet * shape;
+  SoGroup * parent;
+  bool first;
+  std::vector<SbVec3f> points;
+  SbUniqueId coordinates;
+  bool vertexMaterials, vertexNormals, hasNormals;
+  int materialBinding, normalBinding;
+};
+
+struct Collector {
+  std::vector<Visit> visits;
+  std::set<SoNode *> seen;
+};
+
+SoCallbackAction::Response collectCB(void * data, SoCallbackAction * action, const SoNode * node)
+{
+  if (node->getTypeId() != SoFaceSet::getClassTypeId())
+    return SoCallbackAction::CONTINUE;
+  Collector * collector = static_cast<Collector*>(data);
+  Visit visit;
+  visit.shape = const_cast<SoFaceSet*>(static_cast<const SoFaceSet*>(node));
+  const SoPath * path = action->getCurPath();
+  visit.parent = path->getLength() > 1 && path->getNodeFromTail(1)->isOfType(SoGroup::getClassTypeId())
+                 ? static_cast<SoGroup*>(path->getNodeFromTail(1)) : 0;
+  visit.first = collector->seen.insert(visit.shape).second;
+  if (visit.first) {
+    const SoVertexProperty * property = static_cast<const SoVertexProperty*>(visit.shape->vertexProperty.getValue());
+    visit.coordinates = readPoints(action, property, visit.points);
+    // Vertex property data wins over the state, with its own bindings
+    visit.vertexMaterials = property && property->orderedRGBA.getNum();
+    visit.materialBinding = visit.vertexMaterials ? property->materialBinding.getValue() : action->getMaterialBinding();
+    visit.vertexNormals = property && property->normal.getNum();
+    visit.hasNormals = visit.vertexNormals || action->getNumNormals() > 0;
+    visit.normalBinding = visit.vertexNormals ? property->normalBinding.getValue() : action->getNormalBinding();
+  }
+  collector->visits.push_back(visit);
+  return SoCallbackAction::CONTINUE;
+}
+
+bool perFace(int binding)
+{
+  return binding >= SoMaterialBinding::PER_PART && binding <= SoMaterialBinding::PER_FACE_INDEXED;
+}
+
+// The binding of an SoIndexedFaceSet of triangles doing what 'binding' did for the face set
+int indexedBinding(int binding)
+{
+  if (perFace(binding))
+    return SoMaterialBinding::PER_FACE_INDEXED;
+  if (binding == SoMaterialBinding::PER_VERTEX)
+    return SoMaterialBinding::PER_VERTEX_INDEXED;
+  return binding;
+}
+
+// Whether the same state binding does the same for the indexed triangles
+bool keepsMeaning(int binding)
+{
+  return binding == SoMaterialBinding::OVERALL || binding == SoMaterialBinding::PER_PART_INDEXED
+         || binding == SoMaterialBinding::PER_FACE_INDEXED || binding == SoMaterialBinding::PER_VERTEX_INDEXED;
+}
+
+}
+
+
+//____________________________________________________________________
+Triangulator::Triangulator()
+: m_root(0),
+  m_sceneSensor(0),
+  m_updateSensor(0)
+{
+  memset(&m_stats, 0, sizeof(m_stats));
+  m_sceneSensor = new SoNodeSensor(sceneChangedCB, this);
+  m_sceneSensor->setPriority(0); // immediate, so that the trigger node is known in the callback
+  m_updateSensor = new SoOneShotSensor(updateCB, this);
+}
+
+//____________________________________________________________________
+Triangulator::~Triangulator()
+{
+  m_sceneSensor->detach();
+  delete m_sceneSensor;
+  m_updateSensor->unschedule();
+  delete m_updateSensor;
+  clear();
+}
+
+//____________________________________________________________________
+void Triangulator::clear()
+{
+  m_sceneSensor->detach();
+  m_updateSensor->unschedule();
+  for (std::map<SoIndexedFaceSet *, Converted>::const_iterator it = m_converted.begin(); it != m_converted.end(); ++it)
+    it->first->unref();
+  m_converted.clear();
+  if (m_root)
+    m_root->unref();
+  m_root = 0;
+}
+
+//____________________________________________________________________
+std::vector<int> Triangulator::triangulate(const std::vector<SbVec3f> & points,
+                                           const std::vector<std::vector<int> > & rings)
+{
+  std::vector<int> triangles;
+  if (rings.empty() || rings[0].size() < 3)
+    return triangles;
+
+  // Projected along the main axis of the outline's normal (Newell's method)
+  const std::vector<int> & outline = rings[0];
+  SbVec3f normal(0.0f, 0.0f, 0.0f);
+  for (size_t i = 0, j = outline.size() - 1; i < outline.size(); j = i++) {
+    const SbVec3f & p = points[outline[j]];
+    const SbVec3f & q = points[outline[i]];
+    normal += SbVec3f((p[1] - q[1]) * (p[2] + q[2]), (p[2] - q[2]) * (p[0] + q[0]), (p[0] - q[0]) * (p[1] + q[1]));
+  }
+  int axis = 0;
+  for (int i = 1; i < 3; ++i)
+    if (std::fabs(normal[i]) > std::fabs(normal[axis]))
+      axis = i;
+  const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+
+  // Local copies of the rings, indexing 'xy' and 'ids'
+  std::vector<Point2> xy;
+  std::vector<int> ids;
+  std::vector<std::vector<int> > local(rings.size());
+  for (size_t r = 0; r < rings.size(); ++r)
+    for (size_t i = 0; i < rings[r].size(); ++i) {
+      const SbVec3f & p = points[rings[r][i]];
+      const Point2 point = { p[u], p[v] };
+      local[r].push_back(xy.size());
+      xy.push_back(point);
+      ids.push_back(rings[r][i]);
+    }
+
+  // Counterclockwise outline, clockwise holes; the triangles get the
+  // winding of the outline back at the end
+  const bool reversed = ringArea(local[0], xy) < 0.0;
+  if (reversed)
+    std::reverse(local[0].begin(), local[0].end());
+  std::vector<std::pair<double, size_t> > holes;
+  for (size_t r = 1; r < local.size(); ++r) {
+    if (local[r].size() < 3)
+      continue;
+    if (ringArea(local[r], xy) > 0.0)
+      std::reverse(local[r].begin(), local[r].end());
+    double right = -std::numeric_limits<double>::max();
+    for (size_t i = 0; i < local[r].size(); ++i)
+      right = std::max(right, xy[local[r][i]].x);
+    holes.push_back(std::make_pair(right, r));
+  }
+  // Rightmost first, so that later bridges can cross to earlier holes
+  std::sort(holes.rbegin(), holes.rend());
+  std::vector<int> ring = local[0];
+  for (size_t h = 0; h < holes.size(); ++h)
+    bridge(ring, local[holes[h].second], xy);
+
+  std::vector<int> clipped;
+  clipEars(ring, xy, clipped);
+  triangles.resize(clipped.size());
+  for (size_t t = 0; t < clipped.size(); t += 3) {
+    triangles[t] = ids[clipped[t]];
+    triangles[t + 1] = ids[clipped[reversed ? t + 2 : t + 1]];
+    triangles[t + 2] = ids[clipped[reversed ? t + 1 : t + 2]];
+  }
+  return triangles;
+}
+
+//____________________________________________________________________
+void Triangulator::apply(SoNode * root)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  memset(&m_stats, 0, sizeof(m_stats));
+  root->ref();
+  clear();
+  m_root = root;
+
+  Collector collector;
+  SoCallbackAction collect;
+  collect.addPreCallback(SoFaceSet::getClassTypeId(), collectCB, &collector);
+  collect.apply(root);
+  m_stats.shapes = collector.seen.size();
+
+  // The replacement of each face set, built on its first visit
+  std::map<SoNode *, SoNode *> replacements;
+  for (size_t v = 0; v < collector.visits.size(); ++v) {
+    Visit & visit = collector.visits[v];
+    if (!visit.first)
+      continue;
+    SoFaceSet * shape = visit.shape;
+    replacements[shape] = 0;
+    if (shape->startIndex.getValue() != 0) {
+      ++m_stats.skipped;
+      continue;
+    }
+
+    // The polygons
+    Converted converted;
+    converted.numVertices.assign(shape->numVertices.getValues(0), shape->numVertices.getValues(0) + shape->numVertices.getNum());
+    const std::vector<int32_t> counts = polygonSizes(converted.numVertices, visit.points.size());
+    if (std::find_if(counts.begin(), counts.end(), [](int32_t n) { return n > 3; }) == counts.end()) {
+      ++m_stats.skipped;
+      continue;
+    }
+    converted.result = this->triangles(counts, visit.points);
+    converted.materialIndex = perFace(visit.materialBinding);
+    converted.normalIndex = visit.hasNormals && perFace(visit.normalBinding);
+    m_stats.polygons += counts.size();
+    m_stats.triangles += converted.result->faces.size();
+
+    // The triangles, indexing the same coordinates
+    SoIndexedFaceSet * triangles = new SoIndexedFaceSet;
+    SoVertexProperty * property = static_cast<SoVertexProperty*>(shape->vertexProperty.getValue());
+    if ((visit.vertexMaterials && !keepsMeaning(visit.materialBinding))
+        || (visit.vertexNormals && !keepsMeaning(visit.normalBinding))) {
+      property = static_cast<SoVertexProperty*>(property->copy());
+      property->materialBinding = indexedBinding(visit.materialBinding);
+      property->normalBinding = indexedBinding(visit.normalBinding);
+    }
+    triangles->vertexProperty = property;
+    converted.coordinates = property && property->vertex.getNum() ? property->getNodeId() : visit.coordinates;
+    setTriangles(triangles, converted);
+    triangles->ref();
+    m_converted[triangles] = converted;
+
+    // State bindings which would mean something else for the triangles
+    const bool materialBinding = !visit.vertexMaterials && !keepsMeaning(visit.materialBinding);
+    const bool normalBinding = !visit.vertexNormals && visit.hasNormals && !keepsMeaning(visit.normalBinding);
+    SoNode * replacement = triangles;
+    if (materialBinding || normalBinding) {
+      SoSeparator * separator = new SoSeparator;
+      if (materialBinding) {
+        SoMaterialBinding * binding = new SoMaterialBinding;
+        binding->value = indexedBinding(visit.materialBinding);
+        separator->addChild(binding);
+      }
+      if (normalBinding) {
+        SoNormalBinding * binding = new SoNormalBinding;
+        binding->value = indexedBinding(visit.normalBinding);
+        separator->addChild(binding);
+      }
+      separator->addChild(triangles);
+      replacement = separator;
+    }
+    replacement->ref();
+    replacements[shape] = replacement;
+    ++m_stats.converted;
+  }
+
+  // Swapped in after the traversal, in every place the face sets were met
+  for (size_t v = 0; v < collector.visits.size(); ++v) {
+    const Visit & visit = collector.visits[v];
+    SoNode * replacement = replacements[visit.shape];
+    if (replacement && visit.parent)
+      visit.parent->replaceChild(visit.shape, replacement);
+  }
+  for (std::map<SoNode *, SoNode *>::const_iterator it = replacements.begin(); it != replacements.end(); ++it)
+    if (it->second)
+      it->second->unref();
+  m_sceneSensor->attach(root);
+  m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void Triangulator::update()
+{
+  m_updateSensor->unschedule();
+  if (!m_root)
+    return;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  SoCallbackAction action;
+  action.addPreCallback(SoIndexedFaceSet::getClassTypeId(), updateShapeCB, this);
+  action.apply(m_root);
+  m_seen.clear();
+
+  // The results of the coordinates before the edits
+  for (std::map<std::string, std::shared_ptr<const Result> >::iterator it = m_cache.begin(); it != m_cache.end();)
+    if (it->second.use_count() == 1)
+      it = m_cache.erase(it);
+    else
+      ++it;
+  m_stats.time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+std::shared_ptr<const Triangulator::Result> Triangulator::triangles(const std::vector<int32_t> & counts,
+                                                                    const std::vector<SbVec3f> & points)
+{
+  std::string key(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(int32_t));
+  key.append(reinterpret_cast<const char*>(points.data()), points.size() * sizeof(SbVec3f));
+
+  std::shared_ptr<const Result> & cached = m_cache[key];
+  if (cached) {
+    ++m_stats.cacheHits;
+    return cached;
+  }
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::shared_ptr<Result> result = std::make_shared<Result>();
+  std::vector<std::vector<int> > rings(1);
+  for (size_t f = 0, next = 0; f < counts.size(); next += counts[f++]) {
+    if (counts[f] < 3)
+      continue;
+    rings[0].resize(counts[f]);
+    for (int i = 0; i < counts[f]; ++i)
+      rings[0][i] = next + i;
+    const std::vector<int> triangles = triangulate(points, rings);
+    result->triangles.insert(result->triangles.end(), triangles.begin(), triangles.end());
+    result->faces.insert(result->faces.end(), triangles.size() / 3, f);
+  }
+  cached = result;
+  m_stats.triangulationTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return cached;
+}
+
+//____________________________________________________________________
+void Triangulator::setTriangles(SoIndexedFaceSet * shape, const Converted & converted)
+{
+  const Result & result = *converted.result;
+  std::vector<int32_t> coordIndex;
+  coordIndex.reserve(result.triangles.size() / 3 * 4);
+  for (size_t t = 0; t < result.triangles.size(); t += 3) {
+    coordIndex.insert(coordIndex.end(), result.triangles.begin() + t, result.triangles.begin() + t + 3);
+    coordIndex.push_back(-1);
+  }
+  shape->coordIndex.setValues(0, coordIndex.size(), coordIndex.data());
+  shape->coordIndex.setNum(coordIndex.size());
+  const std::vector<int32_t> faces(result.faces.begin(), result.faces.end());
+  if (converted.materialIndex) {
+    shape->materialIndex.setValues(0, faces.size(), faces.data());
+    shape->materialIndex.setNum(faces.size());
+  }
+  if (converted.normalIndex) {
+    shape->normalIndex.setValues(0, faces.size(), faces.data());
+    shape->normalIndex.setNum(faces.size());
+  } else if (shape->normalIndex.getNum()) {
+    // Per corner of the previous triangles (a NormalGenerator's): Coin
+    // generates normals again for the new ones
+    shape->normalIndex.setNum(0);
+    if (SoVertexProperty * property = static_cast<SoVertexProperty*>(shape->vertexProperty.getValue()))
+      property->normal.setNum(0);
+  }
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response Triangulator::updateShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node)
+{
+  Triangulator * self = static_cast<Triangulator *>(userdata);
+  SoIndexedFaceSet * shape = const_cast<SoIndexedFaceSet*>(static_cast<const SoIndexedFaceSet*>(node));
+  std::map<SoIndexedFaceSet *, Converted>::iterator it = self->m_converted.find(shape);
+  // (a shape met again with other coordinates keeps the first ones, as in apply())
+  if (it == self->m_converted.end() || !self->m_seen.insert(shape).second)
+    return SoCallbackAction::CONTINUE;
+
+  Converted & converted = it->second;
+  const SoVertexProperty * property = static_cast<const SoVertexProperty*>(shape->vertexProperty.getValue());
+  const SbUniqueId coordinates = property && property->vertex.getNum()
+                                 ? property->getNodeId() : SoCoordinateElement::getInstance(action->getState())->getNodeId();
+  if (coordinates == converted.coordinates)
+    return SoCallbackAction::CONTINUE;
+  std::vector<SbVec3f> points;
+  converted.coordinates = readPoints(action, property, points);
+  converted.result = self->triangles(polygonSizes(converted.numVertices, points.size()), points);
+  setTriangles(shape, converted);
+  ++self->m_stats.updated;
+  return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void Triangulator::sceneChangedCB(void * userdata, SoSensor * sensor)
+{
+  // Only coordinates edited can change the triangles
+  SoNode * trigger = static_cast<SoNodeSensor *>(sensor)->getTriggerNode();
+  if (trigger && (trigger->isOfType(SoCoordinate3::getClassTypeId()) || trigger->isOfType(SoCoordinate4::getClassTypeId())
+                  || trigger->isOfType(SoVertexProperty::getClassTypeId())))
+    static_cast<Triangulator *>(userdata)->m_updateSensor->schedule();
+}
+
+//____________________________________________________________________
+void Triangulator::updateCB(void * userdata, SoSensor *)
+{
+  static_cast<Triangulator *>(userdata)->update();
+}
+
+//____________________________________________________________________
+void Triangulator::printStats() const
+{
+  printf("triangulator: %u face sets, %u converted (%u from the cache), %u skipped, %u polygons, %u triangles, "
+         "%u updated, %.2f ms (ear clipping %.2f ms)\n",
+         m_stats.shapes, m_stats.converted, m_stats.cacheHits, m_stats.skipped, m_stats.polygons, m_stats.triangles,
+         m_stats.updated, m_stats.time, m_stats.triangulationTime);
+  fflush(stdout);
+}
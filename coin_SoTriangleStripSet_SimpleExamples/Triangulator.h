@@ -0,0 +1,108 @@
+#ifndef TRIANGULATOR_H
+#define TRIANGULATOR_H
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/actions/SoCallbackAction.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class SoIndexedFaceSet;
+class SoNode;
+class SoNodeSensor;
+class SoOneShotSensor;
+class SoSensor;
+
+// Replaces the SoFaceSet shapes of a scene, whose polygons Coin would
+// tessellate each time their render cache is rebuilt, with
+// SoIndexedFaceSet shapes of precomputed triangles.
+//
+// Polygons are triangulated by ear clipping in their plane, so concave
+// ones come out right whatever the shape hints say; triangulate() also
+// takes holes, joined to the outline by bridges. Triangles keep the
+// winding of their polygon and index the same coordinates, which stay
+// where they were (SoCoordinate3 or SoVertexProperty).
+//
+// Results are cached by coordinate content: a face set with the same
+// coordinates and polygons as one already done, anywhere in the scene or
+// in a later apply(), reuses its triangles.
+//
+// The triangles are redone when their coordinates change: a node sensor
+// on the scene of the last apply() sees the coordinate nodes edited, and
+// the shapes whose coordinates are not the ones they were done for are
+// triangulated again in a one-shot sensor, before the next redraw (or in
+// update(), right away). Cached results no shape uses any more are then
+// dropped. Normals given to the triangles afterwards (by a NormalGenerator)
+// are per corner of the old triangles: they are removed, for Coin to
+// generate them again.
+//
+// Normals and materials bound per face or per vertex are turned into
+// their indexed bindings: in the vertex property when they come from it,
+// otherwise with binding nodes in a separator around the new shape. Face
+// sets with a startIndex, or with triangles only, are left alone.
+class Triangulator {
+public:
+  struct Stats {
+    unsigned shapes;     // face sets found
+    unsigned converted;
+    unsigned cacheHits;  // of which reused cached triangles
+    unsigned skipped;
+    unsigned polygons, triangles;
+    unsigned updated;    // triangulated again after an edit, by update()
+    double triangulationTime; // ms, ear clipping only
+    double time;              // ms
+  };
+
+  Triangulator();
+  ~Triangulator();
+
+  void apply(SoNode * root);
+
+  // Triangulates again the shapes of the last scene applied to whose
+  // coordinates changed, right away
+  void update();
+
+  const Stats & stats() const { return m_stats; }
+  void printStats() const;
+
+  // Triangles of a planar polygon, as indices into 'points': rings[0] is
+  // the outline, the others are holes in it. The outline may turn either
+  // way; holes are best turned the other way, but are reversed if not.
+  static std::vector<int> triangulate(const std::vector<SbVec3f> & points,
+                                      const std::vector<std::vector<int> > & rings);
+
+private:
+  // Per coordinate content: the triangles (3 indices each), and the face of each
+  struct Result {
+    std::vector<int> triangles;
+    std::vector<int> faces;
+  };
+  // A face set replaced by triangles
+  struct Converted {
+    std::vector<int32_t> numVertices; // of the face set
+    bool materialIndex, normalIndex;  // whether the triangles index them per face
+    SbUniqueId coordinates;           // node id of the coordinates they were done for
+    std::shared_ptr<const Result> result;
+  };
+
+  SoNode * m_root;
+  SoNodeSensor * m_sceneSensor;
+  SoOneShotSensor * m_updateSensor;
+  std::map<SoIndexedFaceSet *, Converted> m_converted; // referenced
+  std::set<SoIndexedFaceSet *> m_seen;                  // by update()
+  std::map<std::string, std::shared_ptr<const Result> > m_cache;
+  Stats m_stats;
+
+  void clear();
+  std::shared_ptr<const Result> triangles(const std::vector<int32_t> & counts, const std::vector<SbVec3f> & points);
+  static void setTriangles(SoIndexedFaceSet * shape, const Converted & converted);
+
+  static SoCallbackAction::Response updateShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+  static void sceneChangedCB(void * userdata, SoSensor * sensor);
+  static void updateCB(void * userdata, SoSensor * sensor);
+};
+
+#endif
@@ -10,14 +10,28 @@
 #include <Inventor/nodes/SoFaceSet.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoShapeHints.h>
-
-// SoQt includes
-#include <Inventor/Qt/SoQt.h>
-#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+
+// local includes
+#include "FieldBinding.h"
+#include "NormalGenerator.h"
+#include "Stripifier.h"
+#include "Triangulator.h"
+
+// Example harness (viewer, or headless benchmark)
+#include "ExampleHarness.h"
 
 // Qt5 includes
-#include <QApplication>
-#include <QWidget>
+#include <QTemporaryFile>
 
 // C++ includes
 #include <random>
@@ -26,6 +40,12 @@
 #include <ctime>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
 
 // Make two simple polygons out of strips of triangles
@@ -48,7 +68,7 @@ SoSeparator *makeSimpleStripSet() {
   // There are 2 polygons, we use one entry of the array per polygon:
   // - the first polygon is a strip of 4 triangles using 6 vertices
   // - the second polygon is composed by 2 triangles using 4 vertices
-  const int numVertices[2] = { 6,4 };
+  static int32_t numVertices[2] = { 6,4 };
 
   SoSeparator *result = new SoSeparator;
   result->ref();
@@ -61,7 +81,7 @@ SoSeparator *makeSimpleStripSet() {
 
   // define the coordinates of the vertices
   SoCoordinate3 *myCoords = new SoCoordinate3;
-  myCoords->point.setValues(0, 10, vertexPositions);
+  FieldBinding::bind(myCoords->point, vertexPositions);
   result->addChild(myCoords);
 
   // define the SoTriangleStripSet, which will use the coordinates
@@ -69,15 +89,14 @@ SoSeparator *makeSimpleStripSet() {
   // by using them accordingly to the information
   // stored in the numVertices array.
   SoTriangleStripSet *s = new SoTriangleStripSet;
-  s->numVertices.setValues(0, 2, numVertices); // 2 is the number of polygons defined in numVertices
+  FieldBinding::bind(s->numVertices, numVertices);
 
   result->addChild(s);
   result->unrefNoDelete();
   return result;
 }
 
-// TODO: to be fixed! Normals are not calculated properly, visualization is wrong!
-// Make two simple polygons out of strips of triangles, with explicit normals
+// Make two simple polygons out of strips of triangles, with precomputed normals
 SoSeparator *makeSimpleStripSetWithNorms() {
 
   // Two polygons:
@@ -97,17 +116,7 @@ SoSeparator *makeSimpleStripSetWithNorms() {
   // There are 2 polygons, we use one entry of the array per polygon:
   // - the first polygon is a strip of 4 triangles using 6 vertices
   // - the second polygon is composed by 2 triangles using 4 vertices
-  const int numVertices[2] = { 6,4 };
-
-  // Normals for each polygon:
-  // Each entry defines a vector, which is the normal to the polygon's surface
-  static float norms[6][3] =
-  {
-    { 0, 0, 1}, {  0, 0, 1}, //the first two triangles living in the x/y plane (normals are // z)
-    {1, 0, 0}, { 1, 0, 0}, //the second two triangles living in the z/y plane (normals are // -x)
-    { 0, 0, -1}, {  0, 0, 1}//the 4 triangles of the rotated square, all living in the x/y plane (normals are // z)
-  };
-
+  static int32_t numVertices[2] = { 6,4 };
 
   SoSeparator *result = new SoSeparator;
   result->ref();
@@ -118,17 +127,9 @@ SoSeparator *makeSimpleStripSetWithNorms() {
   myHints->vertexOrdering = SoShapeHints::CLOCKWISE;
   result->addChild(myHints);
 
-  // Define the normals used:
-  SoNormal *myNormals = new SoNormal;
-  myNormals->vector.setValues(0, 6, norms);
-  result->addChild(myNormals);
-  SoNormalBinding *myNormalBinding = new SoNormalBinding;
-  myNormalBinding->value = SoNormalBinding::PER_PART;
-  result->addChild(myNormalBinding);
-
   // define the coordinates of the vertices
   SoCoordinate3 *myCoords = new SoCoordinate3;
-  myCoords->point.setValues(0, 10, vertexPositions);
+  FieldBinding::bind(myCoords->point, vertexPositions);
   result->addChild(myCoords);
 
   // define the SoTriangleStripSet, which will use the coordinates
@@ -136,9 +137,15 @@ SoSeparator *makeSimpleStripSetWithNorms() {
   // by using them accordingly to the information
   // stored in the numVertices array.
   SoTriangleStripSet *s = new SoTriangleStripSet;
-  s->numVertices.setValues(0, 2, numVertices); // 2 is the number of polygons defined in numVertices
+  FieldBinding::bind(s->numVertices, numVertices);
 
   result->addChild(s);
+
+  // Compute the normals once and store them in the strip set: the bent
+  // rectangle has a 90 degree crease inside a strip, so it gets one
+  // normal per triangle
+  NormalGenerator().apply(result);
+
   result->unrefNoDelete();
   return result;
 }
@@ -165,7 +172,7 @@ SoSeparator *makeCircle() {
   // There are 2 polygons, we use one entry of the array per polygon:
   // - the first polygon is a strip of 4 triangles using 6 vertices
   // - the second polygon is composed by 2 triangles using 4 vertices
-  const int numVertices[1] = { 9 };
+  static int32_t numVertices[1] = { 9 };
 
   SoSeparator *result = new SoSeparator;
   result->ref();
@@ -179,7 +186,7 @@ SoSeparator *makeCircle() {
 
   // define the coordinates of the vertices
   SoCoordinate3 *myCoords = new SoCoordinate3;
-  myCoords->point.setValues(0, 9, vertexPositions);
+  FieldBinding::bind(myCoords->point, vertexPositions);
   result->addChild(myCoords);
 
   // define the SoTriangleStripSet, which will use the coordinates
@@ -187,7 +194,7 @@ SoSeparator *makeCircle() {
   // by using them accordingly to the information
   // stored in the numVertices array.
   SoFaceSet *s = new SoFaceSet;
-  s->numVertices.setValues(0, 1, numVertices); // 1 is the number of polygons defined in numVertices
+  FieldBinding::bind(s->numVertices, numVertices);
 
   result->addChild(s);
   result->unrefNoDelete();
@@ -227,7 +234,7 @@ SoSeparator *makePennant() {
   // There are 2 polygons, we use one entry of the array per polygon:
   // - the first polygon is a complex flag and it uses the first 32 vertices
   // - the second polygon is a pole and it uses the last 8 vertices
-  const int numVertices[2] = { 32,8 };
+  static int32_t numVertices[2] = { 32,8 };
 
   SoSeparator *result = new SoSeparator;
   result->ref();
@@ -252,11 +259,11 @@ SoSeparator *makePennant() {
   result->addChild(myMaterialBinding);   // D
 
   SoCoordinate3 *myCoords = new SoCoordinate3;
-  myCoords->point.setValues(0, 40, vertexPositions);
+  FieldBinding::bind(myCoords->point, vertexPositions);
   result->addChild(myCoords);
 
   SoTriangleStripSet *s = new SoTriangleStripSet;
-  s->numVertices.setValues(0, 2, numVertices);
+  FieldBinding::bind(s->numVertices, numVertices);
   result->addChild(s);
   result->unrefNoDelete();
   return result;
@@ -285,7 +292,7 @@ SoSeparator* makeObeliskFaceSet()
     // There are eight polygons, we use one entry of the array per polygon:
     // - the first, second, third, and fourth polygons have 3 vertices (triangle)
     // - the fifth, sixth, seventh, and eight polygons have 4 vertices (rectangles)
-    const int numvertices[8] = {3, 3, 3, 3, 4, 4, 4, 4};
+    static int32_t numvertices[8] = {3, 3, 3, 3, 4, 4, 4, 4};
 
     // Normals for each polygon:
     // Each entry defines a vector, which is the normal to the polygon's surface
@@ -302,7 +309,7 @@ SoSeparator* makeObeliskFaceSet()
 
    // Define the normals used:
    SoNormal *myNormals = new SoNormal;
-   myNormals->vector.setValues(0, 8, norms);
+   FieldBinding::bind(myNormals->vector, norms);
    obelisk->addChild(myNormals);
    SoNormalBinding *myNormalBinding = new SoNormalBinding;
    myNormalBinding->value = SoNormalBinding::PER_FACE;
@@ -315,7 +322,7 @@ SoSeparator* makeObeliskFaceSet()
 
    // Define coordinates for vertices
    SoCoordinate3 *myCoords = new SoCoordinate3;
-   myCoords->point.setValues(0, 28, vertices);
+   FieldBinding::bind(myCoords->point, vertices);
    obelisk->addChild(myCoords);
 
    // Define the FaceSet
@@ -323,7 +330,7 @@ SoSeparator* makeObeliskFaceSet()
    // to build the faces, using them accordingly to the definitions
    // stored in the numvertices array
    SoFaceSet *myFaceSet = new SoFaceSet;
-   myFaceSet->numVertices.setValues(0, 8, numvertices);
+   FieldBinding::bind(myFaceSet->numVertices, numvertices);
    obelisk->addChild(myFaceSet);
 
    obelisk->unrefNoDelete();
@@ -332,18 +339,347 @@ SoSeparator* makeObeliskFaceSet()
 
 
 
-int main(int argc, char **argv)
+// A cog with a round hole, triangulated once with the Triangulator: a
+// face set cannot have holes
+SoSeparator *makeWasher() {
+
+  // The outline (24 teeth) and the hole, as two rings of points
+  std::vector<SbVec3f> points;
+  std::vector<std::vector<int> > rings(2);
+  for (int i = 0; i < 96; ++i) {
+    const float angle = 2 * M_PI * i / 96;
+    const float radius = (i / 2) % 2 ? 9.0f : 10.0f;
+    rings[0].push_back(points.size());
+    points.push_back(SbVec3f(radius * std::cos(angle), radius * std::sin(angle), 0));
+  }
+  for (int i = 0; i < 32; ++i) {
+    const float angle = 2 * M_PI * i / 32;
+    rings[1].push_back(points.size());
+    points.push_back(SbVec3f(4 * std::cos(angle), 4 * std::sin(angle), 0));
+  }
+  const std::vector<int> triangles = Triangulator::triangulate(points, rings);
+
+  SoSeparator *result = new SoSeparator;
+  result->ref();
+
+  SoVertexProperty *myVertices = new SoVertexProperty;
+  myVertices->vertex.setValues(0, points.size(), points.data());
+  SoIndexedFaceSet *faces = new SoIndexedFaceSet;
+  faces->vertexProperty = myVertices;
+  std::vector<int32_t> index;
+  for (size_t t = 0; t < triangles.size(); t += 3) {
+    index.insert(index.end(), triangles.begin() + t, triangles.begin() + t + 3);
+    index.push_back(-1);
+  }
+  faces->coordIndex.setValues(0, index.size(), index.data());
+
+  result->addChild(faces);
+  result->unrefNoDelete();
+  return result;
+}
+
+// An N x N field of face sets with the same 8 concave stars of 256
+// corners each, which Coin tessellates for the render caches
+SoSeparator* makeStarField(int n)
+{
+  // The coordinates are copied into each cell, whose points the benchmark
+  // edits (a table bound to all of them would change them all, with only
+  // the edited node notified); the polygon sizes are bound without copies
+  static std::vector<SbVec3f> table;
+  static std::vector<int32_t> numVertices(8, 256);
+  if (table.empty()) {
+    for (int star = 0; star < 8; ++star)
+      for (int i = 0; i < 256; ++i) {
+        const float angle = 2 * M_PI * i / 256;
+        const float radius = i % 2 ? 0.35f + 0.05f * star : 1.0f;
+        table.push_back(SbVec3f(2.5f * star + radius * std::cos(angle), radius * std::sin(angle), 0));
+      }
+  }
+
+  SoSeparator *field = new SoSeparator;
+  field->ref();
+  SoShapeHints *hints = new SoShapeHints;
+  hints->vertexOrdering = SoShapeHints::COUNTERCLOCKWISE;
+  hints->faceType = SoShapeHints::UNKNOWN_FACE_TYPE; // concave
+  field->addChild(hints);
+  for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x) {
+      SoSeparator *cell = new SoSeparator;
+      SoTranslation *translation = new SoTranslation;
+      translation->translation.setValue(21.0f * x, 2.5f * y, 0.0f);
+      cell->addChild(translation);
+      SoCoordinate3 *coords = new SoCoordinate3;
+      coords->point.setValues(0, table.size(), table.data());
+      cell->addChild(coords);
+      SoFaceSet *stars = new SoFaceSet;
+      FieldBinding::bind(stars->numVertices, numVertices);
+      cell->addChild(stars);
+      field->addChild(cell);
+    }
+  field->unrefNoDelete();
+  return field;
+}
+
+// A bumpy N x N grid of quads, as a CAD conversion would give it: an
+// indexed face set with a checker of two materials, one per face
+SoSeparator* makeGridFaceSet(int n)
+{
+  std::vector<float> points;
+  for (int y = 0; y <= n; ++y)
+    for (int x = 0; x <= n; ++x) {
+      points.push_back(x);
+      points.push_back(y);
+      points.push_back(0.5f * std::sin(0.3f * x) * std::cos(0.2f * y));
+    }
+  std::vector<int32_t> index;
+  for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x) {
+      const int a = y * (n + 1) + x;
+      const int32_t quad[5] = { a, a + 1, a + n + 2, a + n + 1, -1 };
+      index.insert(index.end(), quad, quad + 5);
+    }
+
+  SoSeparator *grid = new SoSeparator;
+  grid->ref();
+  const float colors[2][3] = { { .8, .8, .2 }, { .2, .5, .8 } };
+  SoMaterial *materials = new SoMaterial;
+  materials->diffuseColor.setValues(0, 2, colors);
+  grid->addChild(materials);
+  SoMaterialBinding *binding = new SoMaterialBinding;
+  binding->value = SoMaterialBinding::PER_FACE_INDEXED;
+  grid->addChild(binding);
+  SoCoordinate3 *coords = new SoCoordinate3;
+  coords->point.setValues(0, points.size() / 3, reinterpret_cast<const float (*)[3]>(points.data()));
+  grid->addChild(coords);
+  SoIndexedFaceSet *faces = new SoIndexedFaceSet;
+  faces->coordIndex.setValues(0, index.size(), index.data());
+  std::vector<int32_t> materialIndex;
+  for (int y = 0; y < n; ++y)
+    for (int x = 0; x < n; ++x)
+      materialIndex.push_back((x / 8 + y / 8) % 2);
+  faces->materialIndex.setValues(0, materialIndex.size(), materialIndex.data());
+  grid->addChild(faces);
+  grid->unrefNoDelete();
+  return grid;
+}
+
+// Average offscreen frame time of a scene, render caches off;
+// 'beforeFrame', if any, is called before each frame
+double timeFrames(SoNode *scene, int frames, const std::function<void()> &beforeFrame = std::function<void()>())
+{
+  SoSeparator *root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera *camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  root->addChild(scene);
+  const SbViewportRegion region(800, 600);
+  camera->viewAll(scene, region);
+
+  SoOffscreenRenderer renderer(region);
+  double ms = -1.0;
+  if (renderer.render(root)) { // the first frame creates the context
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int i = 0; i < frames && ok; ++i) {
+      if (beforeFrame)
+        beforeFrame();
+      ok = renderer.render(root);
+    }
+    if (ok)
+      ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+  }
+  root->unref();
+  return ms;
+}
+
+// Vertex count and render time of a large face set, before and after stripification
+int runBenchmark(int n, int frames)
 {
+  SoDB::init();
+  SoSeparator::setNumRenderCaches(0); // the geometry is sent every frame
+
+  SoSeparator *faces = makeGridFaceSet(n);
+  faces->ref();
+  Stripifier stripifier;
+  SoSeparator *indexed = stripifier.stripify(faces, Stripifier::INDEXED);
+  indexed->ref();
+  stripifier.printStats();
+  SoSeparator *plain = stripifier.stripify(faces, Stripifier::NON_INDEXED);
+  plain->ref();
+
+  const double before = timeFrames(faces, frames);
+  const double afterIndexed = timeFrames(indexed, frames);
+  const double afterPlain = timeFrames(plain, frames);
+  if (before < 0.0 || afterIndexed < 0.0 || afterPlain < 0.0) {
+    fprintf(stderr, "Could not render offscreen (no offscreen GL context?)\n");
+    return 1;
+  }
+  printf("# %dx%d quads, %d frames, ms per frame (including the read back)\n", n, n, frames);
+  printf("%-34s %10.3f\n", "SoIndexedFaceSet", before);
+  printf("%-34s %10.3f\n", "SoIndexedTriangleStripSet", afterIndexed);
+  printf("%-34s %10.3f\n", "SoTriangleStripSet", afterPlain);
+
+  plain->unref();
+  indexed->unref();
+  faces->unref();
+  return 0;
+}
 
-  // Initialize the Qt system:
-  QApplication app(argc, argv);
+// Triangulation time, and render time of N x N face sets of concave
+// polygons before and after, with and without their coordinates changed
+// (as an animation or an edit would) before each frame
+int runTriangulationBenchmark(int n, int frames)
+{
+  SoDB::init();
+  SoSeparator::setNumRenderCaches(0);
+
+  SoSeparator *polygons = makeStarField(n);
+  polygons->ref();
+  SoSeparator *triangles = static_cast<SoSeparator *>(polygons->copy());
+  triangles->ref();
+  Triangulator triangulator;
+  triangulator.apply(triangles);
+  triangulator.printStats();
+
+  // The tip of the first star of each face set moved out, by a new amount
+  // each frame: Coin tessellates the face sets again, the triangulator
+  // triangulates again (once per frame, the face sets being alike)
+  auto editAll = [](SoNode *scene, Triangulator *triangulator) {
+    SoSearchAction search;
+    search.setType(SoCoordinate3::getClassTypeId());
+    search.setInterest(SoSearchAction::ALL);
+    search.apply(scene);
+    std::vector<SoCoordinate3 *> coords;
+    for (int i = 0; i < search.getPaths().getLength(); ++i)
+      coords.push_back(static_cast<SoCoordinate3 *>(search.getPaths()[i]->getTail()));
+    int frame = 0;
+    return [coords, triangulator, frame]() mutable {
+      const SbVec3f moved(1.0f + 0.001f * (++frame % 100), 0.0f, 0.0f);
+      for (SoCoordinate3 *node : coords)
+        node->point.set1Value(0, moved);
+      if (triangulator)
+        triangulator->update();
+    };
+  };
 
-  // Make a main window:
-  QWidget mainwin;
-  mainwin.resize(400,400);
+  const double before = timeFrames(polygons, frames);
+  const double after = timeFrames(triangles, frames);
+  const double beforeEdited = timeFrames(polygons, frames, editAll(polygons, 0));
+  const double afterEdited = timeFrames(triangles, frames, editAll(triangles, &triangulator));
+  triangulator.printStats();
+  if (before < 0.0 || after < 0.0 || beforeEdited < 0.0 || afterEdited < 0.0) {
+    fprintf(stderr, "Could not render offscreen (no offscreen GL context?)\n");
+    return 1;
+  }
+  printf("# %dx%d face sets of 8 concave 256-gons, %d frames, ms per frame (including the read back)\n",
+         n, n, frames);
+  printf("%-30s %12s %12s\n", "", "unchanged", "edited");
+  printf("%-30s %12.3f %12.3f\n", "SoFaceSet (Coin tessellates)", before, beforeEdited);
+  printf("%-30s %12.3f %12.3f\n", "precomputed triangles", after, afterEdited);
+
+  triangles->unref();
+  polygons->unref();
+  return 0;
+}
 
-  // Initialize SoQt
-  SoQt::init(&mainwin);
+// Resident memory of an N point coordinate table, copied into an
+// SoCoordinate3 or bound to it in place (from memory, or from a mapped file)
+int runMemoryBenchmark(int n)
+{
+  SoDB::init();
+
+  // The table, as a generator or a loader would leave it
+  std::vector<SbVec3f> table(n);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+  for (SbVec3f &point : table)
+    point.setValue(coordinate(random), coordinate(random), coordinate(random));
+  QTemporaryFile file;
+  if (!file.open() || file.write(reinterpret_cast<const char *>(table.data()), n * sizeof(SbVec3f)) != qint64(n * sizeof(SbVec3f))) {
+    fprintf(stderr, "Could not write the table to a temporary file\n");
+    return 1;
+  }
+  file.close();
+
+  printf("# %d points, %.1f MB table, resident memory added by an SoCoordinate3 (MB)\n",
+         n, n * sizeof(SbVec3f) / 1048576.0);
+  printf("%-28s %10s %10s\n", "", "total", "anonymous");
+  for (int mode = 0; mode < 3; ++mode) {
+    const double resident = FieldBinding::residentMemory(), anonymous = FieldBinding::anonymousMemory();
+    SoCoordinate3 *coords = new SoCoordinate3;
+    coords->ref();
+    if (mode == 0)
+      coords->point.setValues(0, n, table.data());
+    else if (mode == 1)
+      FieldBinding::bind(coords->point, table);
+    else if (!FieldBinding::bindMapped(coords->point, coords, file.fileName())) {
+      coords->unref();
+      return 1;
+    }
+    // Read it all, as a render would
+    SbBox3f box;
+    for (int i = 0; i < coords->point.getNum(); ++i)
+      box.extendBy(coords->point[i]);
+    printf("%-28s %10.1f %10.1f\n", mode == 0 ? "setValues (copy)" : mode == 1 ? "bound to the table" : "bound to the mapped file",
+           (FieldBinding::residentMemory() - resident) / 1048576.0, (FieldBinding::anonymousMemory() - anonymous) / 1048576.0);
+    coords->unref();
+  }
+  if (!FieldBinding::residentMemory())
+    printf("(resident memory is not known on this platform)\n");
+  return 0;
+}
+
+// The optional count after argv[i], if the next argument is one (all
+// digits, not 0), otherwise 'fallback'
+int countArgument(int argc, char **argv, int i, int fallback)
+{
+  if (i + 1 >= argc || !*argv[i + 1])
+    return fallback;
+  for (const char *c = argv[i + 1]; *c; ++c)
+    if (*c < '0' || *c > '9')
+      return fallback;
+  const int count = atoi(argv[i + 1]);
+  return count > 0 ? count : fallback;
+}
+
+// Usage: coin_sotrianglestripset_simpleExamples [--stripify] [--coin-normals] [--triangulate]
+//     [--benchmark [N]] [--triangulation-benchmark [N]] [--memory [N]]
+//     [--headless] [--frames N] [--orbit]
+//
+// --stripify shows the face sets converted to strips by the Stripifier,
+// --coin-normals leaves the shapes without normals to Coin's normal
+// generator, instead of computing them once with the NormalGenerator,
+// --triangulate replaces the face sets with precomputed triangles,
+// --benchmark compares, offscreen, an N x N grid of quads (N = 300 by
+// default) with its strips,
+// --triangulation-benchmark does the same for N x N face sets of concave
+// polygons (N = 20 by default) and their precomputed triangles,
+// --memory compares the resident memory of an N point table (N = 5000000
+// by default) copied into a field or bound to it without a copy;
+// the last options come from the ExampleHarness.
+int main(int argc, char **argv)
+{
+  bool stripify = false;
+  bool coinNormals = false;
+  bool triangulate = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--stripify"))
+      stripify = true;
+    else if (!strcmp(argv[i], "--coin-normals"))
+      coinNormals = true;
+    else if (!strcmp(argv[i], "--triangulate"))
+      triangulate = true;
+    else if (!strcmp(argv[i], "--benchmark"))
+      return runBenchmark(countArgument(argc, argv, i, 300), 100);
+    else if (!strcmp(argv[i], "--triangulation-benchmark"))
+      return runTriangulationBenchmark(countArgument(argc, argv, i, 20), 100);
+    else if (!strcmp(argv[i], "--memory"))
+      return runMemoryBenchmark(countArgument(argc, argv, i, 5000000));
+  }
+
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
 
 
   //--- Define the scenegraph
@@ -358,24 +694,36 @@ int main(int argc, char **argv)
   // root->addChild( makeSimpleStripSetWithNorms() );
   // root->addChild( makePennant() );
   // root->addChild( makeObeliskFaceSet() );
-  root->addChild( makeCircle() );
-
-  //--- Init the viewer and launch the app
-
-  // Initialize an examiner viewer:
-  SoQtExaminerViewer * eviewer = new SoQtExaminerViewer(&mainwin);
-  eviewer->setSceneGraph(root);
-  eviewer->show();
-
-  // Pop up the main window.
-  SoQt::show(&mainwin);
-
-  // Loop until exit.
-  SoQt::mainLoop();
+  // root->addChild( makeWasher() );
+  SoSeparator *shape = makeCircle();
+  if (stripify) {
+    // The same shape, as strips
+    shape->ref();
+    Stripifier stripifier;
+    root->addChild( stripifier.stripify(shape) );
+    stripifier.printStats();
+    shape->unref();
+  } else {
+    root->addChild( shape );
+  }
+  Triangulator triangulator; // kept, to redo the triangles if the coordinates change
+  if (triangulate) {
+    triangulator.apply(root);
+    triangulator.printStats();
+  }
+  if (!coinNormals) {
+    // Off the render path: Coin would regenerate them with each render cache
+    NormalGenerator normals;
+    normals.apply(root);
+    normals.printStats();
+  }
+
+  //--- Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
 
   // Clean up resources.
-  delete eviewer;
   root->unref();
 
-  return app.exec();
+  return result;
 }
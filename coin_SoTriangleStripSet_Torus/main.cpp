@@ -13,13 +13,8 @@
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoShapeHints.h>
 
-// SoQt includes
-#include <Inventor/Qt/SoQt.h>
-#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
-
-// Qt5 includes
-#include <QApplication>
-#include <QWidget>
+// Example harness (viewer, or headless benchmark)
+#include "ExampleHarness.h"
 
 // C++ includes
 #include <random>
@@ -30,18 +25,13 @@
 #include <cmath>
 
 
+// Usage: coin_sotrianglestripset_torus [--headless] [--frames N] [--orbit]
+// (see ExampleHarness.h)
 int main(int argc, char **argv)
 {
 
-  // Initialize the Qt system:
-  QApplication app(argc, argv);
-
-  // Make a main window:
-  QWidget mainwin;
-  mainwin.resize(400,400);
-
-  // Initialize SoQt
-  SoQt::init(&mainwin);
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
 
 
   //--- Define the scenegraph
@@ -77,22 +67,12 @@ int main(int argc, char **argv)
 
   root->addChild(torus->getSeparator());
 
-  //--- Init the viewer
-
-  // Initialize an examiner viewer:
-  SoQtExaminerViewer * eviewer = new SoQtExaminerViewer(&mainwin);
-  eviewer->setSceneGraph(root);
-  eviewer->show();
-
-  // Pop up the main window.
-  SoQt::show(&mainwin);
-
-  // Loop until exit.
-  SoQt::mainLoop();
+  //--- Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
 
   // Clean up resources.
-  delete eviewer;
   root->unref();
 
-  return app.exec();
+  return result;
 }
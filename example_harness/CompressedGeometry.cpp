@@ -0,0 +1,412 @@
+#include "CompressedGeometry.h"
+
+#include <Inventor/fields/SoMFNode.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/sensors/SoOneShotSensor.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <memory>
+
+
+namespace {
+
+float signOf(float value)
+{
+  return value < 0.0f ? -1.0f : 1.0f;
+}
+
+// Unit vector to the octahedron, unfolded onto the square [-1,1]^2
+void encodeNormal(const SbVec3f & normal, int16_t * encoded)
+{
+  const float sum = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+  float x = 0.0f, y = 0.0f;
+  if (sum > 0.0f) {
+    x = normal[0] / sum;
+    y = normal[1] / sum;
+    if (normal[2] < 0.0f) {
+      const float folded = (1.0f - std::fabs(y)) * signOf(x);
+      y = (1.0f - std::fabs(x)) * signOf(y);
+      x = folded;
+    }
+  }
+  encoded[0] = int16_t(std::lround(std::min(1.0f, std::max(-1.0f, x)) * 32767.0f));
+  encoded[1] = int16_t(std::lround(std::min(1.0f, std::max(-1.0f, y)) * 32767.0f));
+}
+
+SbVec3f decodeNormal(const int16_t * encoded)
+{
+  float x = encoded[0] / 32767.0f, y = encoded[1] / 32767.0f;
+  const float z = 1.0f - std::fabs(x) - std::fabs(y);
+  if (z < 0.0f) {
+    const float unfolded = (1.0f - std::fabs(y)) * signOf(x);
+    y = (1.0f - std::fabs(x)) * signOf(y);
+    x = unfolded;
+  }
+  const float length = std::sqrt(x * x + y * y + z * z);
+  return SbVec3f(x / length, y / length, z / length);
+}
+
+bool isUnset(const SbVec3f & value)
+{
+  return value[0] != value[0]; // NaN
+}
+
+// By size (powers of two), never reallocated so that the fields bound to
+// them stay valid
+std::map<unsigned, std::unique_ptr<SbVec3f[]> > & placeholders()
+{
+  static std::map<unsigned, std::unique_ptr<SbVec3f[]> > arrays;
+  return arrays;
+}
+
+unsigned placeholderSize(unsigned num)
+{
+  unsigned size = 1024;
+  while (size < num)
+    size *= 2;
+  return size;
+}
+
+SbVec3f * placeholder(unsigned num)
+{
+  std::unique_ptr<SbVec3f[]> & array = placeholders()[placeholderSize(num)];
+  if (!array) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    array.reset(new SbVec3f[placeholderSize(num)]);
+    std::fill(array.get(), array.get() + placeholderSize(num), SbVec3f(nan, nan, nan));
+  }
+  return array.get();
+}
+
+}
+
+
+//____________________________________________________________________
+CompressedGeometry::CompressedGeometry()
+: m_root(0),
+  m_sceneSensor(0),
+  m_updateSensor(0),
+  m_updating(false),
+  m_encodes(0),
+  m_decodes(0),
+  m_encodedVertices(0),
+  m_decodedVertices(0),
+  m_encodeTime(0.0),
+  m_decodeTime(0.0),
+  m_benchmark(0.0)
+{
+  m_sceneSensor = new SoNodeSensor(sceneChangedCB, this);
+  m_sceneSensor->setPriority(0); // immediate, so that the trigger node is known in the callback
+  m_updateSensor = new SoOneShotSensor(updateCB, this);
+}
+
+//____________________________________________________________________
+CompressedGeometry::~CompressedGeometry()
+{
+  m_sceneSensor->detach();
+  delete m_sceneSensor;
+  m_updateSensor->unschedule();
+  delete m_updateSensor;
+  clear();
+}
+
+//____________________________________________________________________
+void CompressedGeometry::setSceneGraph(SoNode * root)
+{
+  m_sceneSensor->detach();
+  m_updateSensor->unschedule();
+  clear();
+  m_root = root;
+  if (root) {
+    m_sceneSensor->attach(root);
+    update();
+  }
+}
+
+//____________________________________________________________________
+void CompressedGeometry::clear()
+{
+  // The scene as it was
+  m_updating = true;
+  for (std::unordered_map<SoVertexProperty *, Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+    restore(it->first, it->second);
+    it->first->unref();
+  }
+  m_blocks.clear();
+  m_updating = false;
+}
+
+//____________________________________________________________________
+void CompressedGeometry::update()
+{
+  if (!m_root)
+    return;
+  std::set<SoVertexProperty *> shown, hidden;
+  std::set<std::pair<SoNode *, bool> > visited;
+  collect(m_root, true, shown, hidden, visited);
+
+  m_updating = true;
+  // Shown again, or gone from the scene: back in their fields
+  for (std::unordered_map<SoVertexProperty *, Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ) {
+    if (shown.count(it->first) || !hidden.count(it->first)) {
+      restore(it->first, it->second);
+      it->first->unref();
+      it = m_blocks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Newly hidden
+  for (std::set<SoVertexProperty *>::const_iterator it = hidden.begin(); it != hidden.end(); ++it) {
+    if (shown.count(*it) || m_blocks.count(*it) || (*it)->vertex.getNum() == 0)
+      continue;
+    (*it)->ref();
+    encode(*it, m_blocks[*it]);
+  }
+  m_updating = false;
+  m_updateSensor->unschedule(); // done, whatever our own changes scheduled
+}
+
+//____________________________________________________________________
+void CompressedGeometry::collect(SoNode * node, bool visible, std::set<SoVertexProperty *> & shown,
+                                 std::set<SoVertexProperty *> & hidden,
+                                 std::set<std::pair<SoNode *, bool> > & visited)
+{
+  if (!visited.insert(std::make_pair(node, visible)).second)
+    return;
+  if (node->isOfType(SoVertexProperty::getClassTypeId()))
+    (visible ? shown : hidden).insert(static_cast<SoVertexProperty *>(node));
+
+  // The nodes held in fields (the vertexProperty of shapes) are used where the node is
+  SoFieldList fields;
+  node->getFields(fields);
+  for (int i = 0; i < fields.getLength(); ++i) {
+    if (fields[i]->isOfType(SoSFNode::getClassTypeId())) {
+      if (SoNode * value = static_cast<SoSFNode *>(fields[i])->getValue())
+        collect(value, visible, shown, hidden, visited);
+    } else if (fields[i]->isOfType(SoMFNode::getClassTypeId())) {
+      const SoMFNode * values = static_cast<SoMFNode *>(fields[i]);
+      for (int j = 0; j < values->getNum(); ++j)
+        if ((*values)[j])
+          collect((*values)[j], visible, shown, hidden, visited);
+    }
+  }
+
+  SoChildList * children = node->getChildren();
+  if (!children)
+    return;
+  // Only plain switches: a blinker would decode and release at each step.
+  // An inherited whichChild counts as all children shown.
+  int which = SO_SWITCH_ALL;
+  if (node->getTypeId() == SoSwitch::getClassTypeId() &&
+      static_cast<SoSwitch *>(node)->whichChild.getValue() != SO_SWITCH_INHERIT)
+    which = static_cast<SoSwitch *>(node)->whichChild.getValue();
+  for (int i = 0; i < children->getLength(); ++i)
+    collect((*children)[i], visible && (which == SO_SWITCH_ALL || which == i), shown, hidden, visited);
+}
+
+//____________________________________________________________________
+void CompressedGeometry::encode(SoVertexProperty * vertexProperty, Block & block)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  const SbVec3f * positions = vertexProperty->vertex.getValues(0);
+  block.numVertices = vertexProperty->vertex.getNum();
+  SbVec3f max = positions[0];
+  block.min = positions[0];
+  for (unsigned i = 1; i < block.numVertices; ++i) {
+    for (int k = 0; k < 3; ++k) {
+      block.min[k] = std::min(block.min[k], positions[i][k]);
+      max[k] = std::max(max[k], positions[i][k]);
+    }
+  }
+  for (int k = 0; k < 3; ++k)
+    block.step[k] = (max[k] - block.min[k]) / 65535.0f;
+  block.positions.resize(3 * block.numVertices);
+  for (unsigned i = 0; i < block.numVertices; ++i)
+    for (int k = 0; k < 3; ++k)
+      block.positions[3 * i + k] = block.step[k] > 0.0f ?
+        uint16_t(std::lround(std::min(65535.0f, (positions[i][k] - block.min[k]) / block.step[k]))) : 0;
+
+  const SbVec3f * normals = vertexProperty->normal.getValues(0);
+  block.numNormals = vertexProperty->normal.getNum();
+  block.normals.resize(2 * block.numNormals);
+  for (unsigned i = 0; i < block.numNormals; ++i)
+    encodeNormal(normals[i], &block.normals[2 * i]);
+
+  // Frees the arrays in Coin (setValuesPointer does not copy)
+  if (block.numVertices)
+    vertexProperty->vertex.setValuesPointer(block.numVertices, placeholder(block.numVertices));
+  if (block.numNormals)
+    vertexProperty->normal.setValuesPointer(block.numNormals, placeholder(block.numNormals));
+
+  ++m_encodes;
+  m_encodedVertices += block.numVertices;
+  m_encodeTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void CompressedGeometry::decode(const Block & block, SbVec3f * positions, SbVec3f * normals)
+{
+  const uint16_t * values = block.positions.data();
+  for (unsigned i = 0; positions && i < block.numVertices; ++i, values += 3)
+    positions[i].setValue(block.min[0] + values[0] * block.step[0],
+                          block.min[1] + values[1] * block.step[1],
+                          block.min[2] + values[2] * block.step[2]);
+  for (unsigned i = 0; normals && i < block.numNormals; ++i)
+    normals[i] = decodeNormal(&block.normals[2 * i]);
+}
+
+//____________________________________________________________________
+void CompressedGeometry::restore(SoVertexProperty * vertexProperty, const Block & block)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<SbVec3f> positions(block.numVertices), normals(block.numNormals);
+  decode(block, positions.data(), normals.data());
+  unbind(vertexProperty->vertex, positions);
+  unbind(vertexProperty->normal, normals);
+
+  ++m_decodes;
+  m_decodedVertices += block.numVertices;
+  m_decodeTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void CompressedGeometry::unbind(SoMFVec3f & field, std::vector<SbVec3f> & values)
+{
+  // The values set since, in the placeholder or in an array Coin grew or
+  // shrank from it, over the decoded ones. A shorter array truncates them.
+  const unsigned num = field.getNum();
+  const SbVec3f * current = field.getValues(0);
+  values.resize(num, SbVec3f(0.0f, 0.0f, 0.0f));
+  for (unsigned i = 0; i < num; ++i)
+    if (!isUnset(current[i]))
+      values[i] = current[i];
+  if (isPlaceholder(field)) {
+    // NaN again, for the other arrays bound to it
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    SbVec3f * shared = placeholder(num);
+    for (unsigned i = 0; i < num; ++i)
+      if (!isUnset(shared[i]))
+        shared[i].setValue(nan, nan, nan);
+  }
+  field.setNum(0); // unbinds a placeholder, without freeing it
+  if (num)
+    field.setValues(0, num, values.data());
+}
+
+//____________________________________________________________________
+double CompressedGeometry::benchmarkDecode()
+{
+  unsigned long long vertices = 0;
+  std::vector<SbVec3f> positions, normals;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::unordered_map<SoVertexProperty *, Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+    positions.resize(std::max<size_t>(positions.size(), it->second.numVertices));
+    normals.resize(std::max<size_t>(normals.size(), it->second.numNormals));
+    decode(it->second, positions.data(), normals.data());
+    vertices += it->second.numVertices;
+  }
+  const double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  m_benchmark = vertices ? time / (vertices / 1e6) : 0.0;
+  return m_benchmark;
+}
+
+//____________________________________________________________________
+unsigned long long CompressedGeometry::originalBytes() const
+{
+  unsigned long long bytes = 0;
+  for (std::unordered_map<SoVertexProperty *, Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+    bytes += (unsigned long long)(it->second.numVertices + it->second.numNormals) * sizeof(SbVec3f);
+  return bytes;
+}
+
+//____________________________________________________________________
+unsigned long long CompressedGeometry::compressedBytes() const
+{
+  unsigned long long bytes = 0;
+  for (std::unordered_map<SoVertexProperty *, Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+    bytes += sizeof(Block) + it->second.positions.size() * sizeof(uint16_t)
+           + it->second.normals.size() * sizeof(int16_t);
+  for (std::map<unsigned, std::unique_ptr<SbVec3f[]> >::const_iterator it = placeholders().begin();
+       it != placeholders().end(); ++it)
+    bytes += (unsigned long long)it->first * sizeof(SbVec3f);
+  return bytes;
+}
+
+//____________________________________________________________________
+bool CompressedGeometry::isPlaceholder(const SoMFVec3f & field)
+{
+  if (field.getNum() == 0)
+    return false;
+  std::map<unsigned, std::unique_ptr<SbVec3f[]> >::const_iterator it =
+    placeholders().find(placeholderSize(field.getNum()));
+  return it != placeholders().end() && field.getValues(0) == it->second.get();
+}
+
+//____________________________________________________________________
+void CompressedGeometry::printReport() const
+{
+  const unsigned long long original = originalBytes(), compressed = compressedBytes();
+  printf("compressed geometry: %u hidden vertex properties, %.3f MB -> %.3f MB (%.2f:1), "
+         "%llu vertices encoded in %.2f ms\n",
+         numCompressed(), original / 1048576.0, compressed / 1048576.0,
+         compressed ? double(original) / compressed : 0.0, m_encodedVertices, m_encodeTime);
+  printf("compressed geometry: %u decodes, %llu vertices in %.2f ms (%.2f ms per million vertices)",
+         m_decodes, m_decodedVertices, m_decodeTime,
+         m_decodedVertices ? m_decodeTime / (m_decodedVertices / 1e6) : 0.0);
+  if (m_benchmark > 0.0)
+    printf(", decode of all the hidden ones: %.2f ms per million vertices", m_benchmark);
+  printf("\n");
+  fflush(stdout);
+}
+
+//____________________________________________________________________
+void CompressedGeometry::sceneChangedCB(void * userdata, SoSensor * sensor)
+{
+  CompressedGeometry * self = static_cast<CompressedGeometry *>(userdata);
+  if (self->m_updating)
+    return; // our own changes
+  SoNodeSensor * nodeSensor = static_cast<SoNodeSensor *>(sensor);
+  SoNode * trigger = nodeSensor->getTriggerNode();
+  SoField * field = nodeSensor->getTriggerField();
+  if (!trigger)
+    return;
+
+  if (trigger->isOfType(SoVertexProperty::getClassTypeId())) {
+    // New values set while compressed: decoded now, under them, before
+    // another array bound to the same placeholder is edited. Compressed
+    // again at the next update if still hidden.
+    SoVertexProperty * vertexProperty = static_cast<SoVertexProperty *>(trigger);
+    std::unordered_map<SoVertexProperty *, Block>::iterator it = self->m_blocks.find(vertexProperty);
+    if (it != self->m_blocks.end() && (field == &vertexProperty->vertex || field == &vertexProperty->normal)) {
+      self->m_updating = true;
+      self->restore(vertexProperty, it->second);
+      self->m_blocks.erase(it);
+      self->m_updating = false;
+      vertexProperty->unref();
+      self->m_updateSensor->schedule();
+    }
+    return;
+  }
+  // A switch turned, or children added or removed
+  if ((trigger->isOfType(SoSwitch::getClassTypeId()) && field == &static_cast<SoSwitch *>(trigger)->whichChild) ||
+      (!field && trigger->getChildren()))
+    self->m_updateSensor->schedule();
+}
+
+//____________________________________________________________________
+void CompressedGeometry::updateCB(void * userdata, SoSensor *)
+{
+  static_cast<CompressedGeometry *>(userdata)->update();
+}
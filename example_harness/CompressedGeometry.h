@@ -0,0 +1,98 @@
+#ifndef COMPRESSEDGEOMETRY_H
+#define COMPRESSEDGEOMETRY_H
+
+#include <Inventor/SbLinear.h>
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SoMFVec3f;
+class SoNode;
+class SoNodeSensor;
+class SoOneShotSensor;
+class SoSensor;
+class SoVertexProperty;
+
+// Keeps the geometry which is not shown compressed: the vertex arrays of
+// the subgraphs below switches that do not traverse them (collapsed
+// subsystems) take a fraction of their memory until they are shown.
+//
+// The positions of a SoVertexProperty are stored as 16-bit values in its
+// bounding box, its normals as two 16-bit octahedral coordinates; its
+// vertex and normal fields are then bound (setValuesPointer) to a NaN
+// placeholder shared by all the compressed arrays. When a switch change
+// makes it visible, the arrays are decoded back into the fields, and
+// released again when it is hidden. A vertex property used by a visible
+// shape as well is left alone.
+//
+// Values set in a compressed array (set1Value, setValues, startEditing...)
+// land in the placeholder; they are seen right away, the array is decoded
+// and the values that are no longer NaN are kept over the decoded ones.
+// Only one compressed array may be edited at a time (no startEditing() on
+// two of them before finishEditing()). The other fields (colors, texture
+// coordinates) are not compressed.
+//
+// Switch changes (and children added or removed) are seen through a node
+// sensor on the scene; the subgraphs are decoded in a one-shot sensor,
+// before the next redraw. The decoded positions are within 1/65535 of
+// the box of the array from the original ones, the normals within about
+// 0.005 rad.
+class CompressedGeometry {
+public:
+  CompressedGeometry();
+  ~CompressedGeometry(); // decodes everything back
+
+  void setSceneGraph(SoNode * root);
+
+  // Compresses and decodes as the switches say, right away
+  void update();
+
+  unsigned numCompressed() const { return m_blocks.size(); }
+  unsigned long long originalBytes() const;
+  unsigned long long compressedBytes() const; // with the placeholders
+
+  // Whether the values of the field are a placeholder, not its own
+  static bool isPlaceholder(const SoMFVec3f & field);
+
+  // Decodes all the compressed arrays into a scratch buffer (the scene is
+  // not changed), and returns the time per million vertices in ms
+  double benchmarkDecode();
+
+  void printReport() const;
+
+private:
+  struct Block {
+    SbVec3f min, step;                 // position = min + value * step
+    std::vector<uint16_t> positions;   // 3 per vertex
+    std::vector<int16_t> normals;      // 2 per normal
+    unsigned numVertices, numNormals;
+  };
+
+  SoNode * m_root;
+  SoNodeSensor * m_sceneSensor;
+  SoOneShotSensor * m_updateSensor;
+  bool m_updating;
+  std::unordered_map<SoVertexProperty *, Block> m_blocks; // referenced
+
+  // Statistics
+  unsigned m_encodes, m_decodes;
+  unsigned long long m_encodedVertices, m_decodedVertices;
+  double m_encodeTime, m_decodeTime; // ms
+  double m_benchmark;                // ms per million vertices, 0 if not run
+
+  void clear();
+  void collect(SoNode * node, bool visible, std::set<SoVertexProperty *> & shown,
+               std::set<SoVertexProperty *> & hidden, std::set<std::pair<SoNode *, bool> > & visited);
+  void encode(SoVertexProperty * vertexProperty, Block & block);
+  static void decode(const Block & block, SbVec3f * positions, SbVec3f * normals); // either may be 0
+  void restore(SoVertexProperty * vertexProperty, const Block & block);
+  static void unbind(SoMFVec3f & field, std::vector<SbVec3f> & values);
+
+  static void sceneChangedCB(void * userdata, SoSensor * sensor);
+  static void updateCB(void * userdata, SoSensor * sensor);
+};
+
+#endif
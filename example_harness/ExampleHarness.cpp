@@ -0,0 +1,343 @@
+#include "ExampleHarness.h"
+#include "CompressedGeometry.h"
+#include "FrameTiming.h"
+#include "GlbExporter.h"
+#include "SceneMemory.h"
+
+#include <Inventor/Qt/SoQt.h>
+#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/sensors/SoSensorManager.h>
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QTimer>
+#include <QWidget>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+
+// An examiner viewer which traces its first frame
+class TracedViewer : public SoQtExaminerViewer {
+public:
+  TracedViewer(QWidget * parent, StartupTrace * trace) : SoQtExaminerViewer(parent), m_trace(trace) {}
+
+protected:
+  virtual void actualRedraw()
+  {
+    if (!m_trace) {
+      SoQtExaminerViewer::actualRedraw();
+      return;
+    }
+    // The first frame: traversal with the caches built, then the swap,
+    // done by SoQt once we return; over when Qt gets back to its events
+    StartupTrace * trace = m_trace;
+    m_trace = 0;
+    trace->begin("first render");
+    SoQtExaminerViewer::actualRedraw();
+    trace->begin("first swap");
+    QTimer::singleShot(0, [trace]() { trace->finish(); });
+  }
+
+private:
+  StartupTrace * m_trace; // until the first frame
+};
+
+// Turns the camera by 'angle' around its vertical axis through the focal point
+void orbit(SoCamera * camera, float angle)
+{
+  SbVec3f direction;
+  camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+  const SbVec3f focalPoint = camera->position.getValue() + direction * camera->focalDistance.getValue();
+  camera->orientation = camera->orientation.getValue() * SbRotation(SbVec3f(0, 1, 0), angle);
+  camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+  camera->position = focalPoint - direction * camera->focalDistance.getValue();
+}
+
+}
+
+
+//____________________________________________________________________
+ExampleHarness::ExampleHarness(int & argc, char ** argv)
+: m_headless(false),
+  m_frames(0),
+  m_orbit(false),
+  m_sceneMemory(false),
+  m_compressHidden(false),
+  m_width(800),
+  m_height(600),
+  m_name(QFileInfo(argv[0]).fileName()),
+  m_firstFrame(0.0)
+{
+  // Our options out, the others kept in order
+  bool framesGiven = false;
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--headless")) {
+      m_headless = true;
+    } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+      m_frames = std::max(0, atoi(argv[++i]));
+      framesGiven = true;
+    } else if (!strcmp(argv[i], "--orbit")) {
+      m_orbit = true;
+    } else if (!strcmp(argv[i], "--scene-memory")) {
+      m_sceneMemory = true;
+    } else if (!strcmp(argv[i], "--scene-memory-json") && i + 1 < argc) {
+      m_sceneMemory = true;
+      m_sceneMemoryFile = argv[++i];
+    } else if (!strcmp(argv[i], "--compress-hidden")) {
+      m_compressHidden = true;
+    } else if (!strcmp(argv[i], "--export-glb") && i + 1 < argc) {
+      m_glbFile = argv[++i];
+    } else if (!strcmp(argv[i], "--startup-trace") && i + 1 < argc) {
+      m_trace.setFile(argv[++i]);
+    } else if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+      if (sscanf(argv[++i], "%dx%d", &m_width, &m_height) != 2 || m_width <= 0 || m_height <= 0) {
+        fprintf(stderr, "--size takes WxH, e.g. 800x600\n");
+        m_width = 800;
+        m_height = 600;
+      }
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+  argv[argc] = 0;
+
+  if (m_headless) {
+    if (!framesGiven)
+      m_frames = 100;
+    FrameTiming::requestSoftwareGL();
+    m_trace.begin("QCoreApplication");
+    m_application.reset(new QCoreApplication(argc, argv));
+    // What SoQt::init() would do
+    m_trace.begin("SoDB::init");
+    SoDB::init();
+    SoNodeKit::init();
+    SoInteraction::init();
+  } else {
+    // Initialize the Qt system:
+    m_trace.begin("QApplication");
+    m_application.reset(new QApplication(argc, argv));
+
+    // Coin's classes first, to tell them apart from SoQt's own start
+    // (SoQt::init() does this too, but only once)
+    m_trace.begin("SoDB::init");
+    SoDB::init();
+    SoNodeKit::init();
+    SoInteraction::init();
+
+    // Make a main window:
+    m_trace.begin("SoQt::init");
+    m_window.reset(new QWidget);
+    m_window->resize(400, 400);
+
+    // Initialize SoQt
+    SoQt::init(m_window.get());
+  }
+  m_trace.begin("scene");
+}
+
+//____________________________________________________________________
+ExampleHarness::~ExampleHarness()
+{
+}
+
+//____________________________________________________________________
+int ExampleHarness::optionLength(int argc, char ** argv, int i)
+{
+  if (!strcmp(argv[i], "--headless") || !strcmp(argv[i], "--orbit") || !strcmp(argv[i], "--scene-memory") ||
+      !strcmp(argv[i], "--compress-hidden"))
+    return 1;
+  if ((!strcmp(argv[i], "--frames") || !strcmp(argv[i], "--size") || !strcmp(argv[i], "--startup-trace") ||
+       !strcmp(argv[i], "--scene-memory-json") || !strcmp(argv[i], "--export-glb")) && i + 1 < argc)
+    return 2;
+  return 0;
+}
+
+//____________________________________________________________________
+int ExampleHarness::run(SoNode * root)
+{
+  root->ref();
+  // First, so that the memory report counts the compressed scene
+  if (m_compressHidden) {
+    m_trace.begin("compress hidden geometry");
+    m_compressed.reset(new CompressedGeometry);
+    m_compressed->setSceneGraph(root);
+    m_compressed->benchmarkDecode();
+    m_compressed->printReport();
+  }
+  if (m_sceneMemory) {
+    m_trace.begin("scene memory");
+    SceneMemory memory;
+    memory.apply(root);
+    memory.printReport();
+    if (!m_sceneMemoryFile.isEmpty())
+      memory.writeJson(m_sceneMemoryFile);
+  }
+  if (!m_glbFile.isEmpty()) {
+    m_trace.begin("glb export");
+    GlbExporter exporter;
+    if (exporter.write(root, m_glbFile))
+      exporter.printReport();
+  }
+  const int result = m_headless ? runHeadless(root) : runViewer(root);
+  if (m_compressed) {
+    if (!m_headless)
+      m_compressed->printReport(); // with the switches turned in the viewer
+    m_compressed.reset(); // decodes everything back
+  }
+  root->unrefNoDelete();
+  m_trace.finish(); // if the window was closed before its first frame
+  return result;
+}
+
+//____________________________________________________________________
+int ExampleHarness::runHeadless(SoNode * root)
+{
+  // The camera of the scene if it has one, otherwise one looking at all of it,
+  // and a headlight as in the viewer
+  SoSearchAction search;
+  search.setType(SoCamera::getClassTypeId());
+  search.setInterest(SoSearchAction::FIRST);
+  search.apply(root);
+  SoCamera * camera = search.getPath() ? static_cast<SoCamera*>(search.getPath()->getTail()) : 0;
+
+  m_trace.begin("setup");
+  const SbViewportRegion region(m_width, m_height);
+  SoSeparator * top = new SoSeparator;
+  top->ref();
+  if (!camera) {
+    camera = new SoPerspectiveCamera;
+    top->addChild(camera);
+  }
+  SoDirectionalLight * headlight = new SoDirectionalLight;
+  top->addChild(headlight);
+  top->addChild(root);
+  if (top->getChild(0) == camera)
+    camera->viewAll(root, region);
+
+  SoOffscreenRenderer renderer(region);
+  auto frame = [&]() {
+    // What the main loop would do between frames: Qt events (e.g. work
+    // done on other threads) and Coin sensors
+    QCoreApplication::processEvents();
+    SoDB::getSensorManager()->processTimerQueue();
+    SoDB::getSensorManager()->processDelayQueue(TRUE);
+
+    SbVec3f direction;
+    camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+    headlight->direction = direction;
+
+    // NB: render() also reads the pixels back, which makes the GL
+    // pipeline finish before the clock stops
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool ok = renderer.render(top);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok ? ms : -1.0;
+  };
+
+  m_frameTimes.clear();
+  m_trace.begin("first render"); // with the GL context made, the caches built
+  m_firstFrame = frame();
+  m_trace.finish();
+  bool ok = m_firstFrame >= 0.0;
+  for (unsigned i = 0; i < m_frames && ok; ++i) {
+    if (m_orbit)
+      orbit(camera, float(2 * M_PI / m_frames));
+    m_frameTimes.push_back(frame());
+    ok = m_frameTimes.back() >= 0.0;
+  }
+  top->unref();
+  if (!ok) {
+    fprintf(stderr, "%s: could not render offscreen (no offscreen GL context? try xvfb-run)\n", qPrintable(m_name));
+    return 1;
+  }
+  report();
+  return 0;
+}
+
+//____________________________________________________________________
+int ExampleHarness::runViewer(SoNode * root)
+{
+  // Initialize an examiner viewer:
+  m_trace.begin("viewer");
+  TracedViewer * viewer = new TracedViewer(m_window.get(), &m_trace);
+  viewer->setSceneGraph(root);
+  viewer->show();
+
+  // Pop up the main window; it is mapped, then painted, from the main loop
+  SoQt::show(m_window.get());
+  m_trace.begin("show");
+
+  // The frames once the window is up, or a camera turning until closed
+  QTimer turn;
+  if (m_frames) {
+    QTimer::singleShot(0, [this, viewer]() {
+      m_frameTimes.clear();
+      m_firstFrame = FrameTiming::timedRender(viewer);
+      for (unsigned i = 0; i < m_frames; ++i) {
+        if (m_orbit && viewer->getCamera())
+          orbit(viewer->getCamera(), float(2 * M_PI / m_frames));
+        m_frameTimes.push_back(FrameTiming::timedRender(viewer));
+      }
+      report();
+      SoQt::exitMainLoop();
+    });
+  } else if (m_orbit) {
+    QObject::connect(&turn, &QTimer::timeout, [viewer]() {
+      if (viewer->getCamera())
+        orbit(viewer->getCamera(), float(M_PI / 180));
+    });
+    turn.start(16);
+  }
+
+  // Loop until exit.
+  SoQt::mainLoop();
+
+  // Clean up resources.
+  delete viewer;
+  return 0;
+}
+
+//____________________________________________________________________
+void ExampleHarness::report() const
+{
+  printf("# %s: %s %dx%d, %u frames%s\n", qPrintable(m_name), m_headless ? "offscreen" : "viewer",
+         m_headless ? m_width : m_window->width(), m_headless ? m_height : m_window->height(),
+         unsigned(m_frameTimes.size()), m_orbit ? ", orbiting" : "");
+  printf("# frame  render[ms]\n");
+  printf("%7s  %10.3f\n", "first", m_firstFrame);
+  for (size_t i = 0; i < m_frameTimes.size(); ++i)
+    printf("%7u  %10.3f\n", unsigned(i), m_frameTimes[i]);
+
+  double total = 0.0;
+  for (size_t i = 0; i < m_frameTimes.size(); ++i)
+    total += m_frameTimes[i];
+  const double mean = m_frameTimes.empty() ? 0.0 : total / m_frameTimes.size();
+  printf("# %s: first frame %.3f ms, then mean %.3f ms (%.1f fps), p50 %.3f ms, p95 %.3f ms, max %.3f ms\n",
+         qPrintable(m_name), m_firstFrame, mean, mean > 0.0 ? 1000.0 / mean : 0.0,
+         FrameTiming::percentile(m_frameTimes, 50), FrameTiming::percentile(m_frameTimes, 95),
+         FrameTiming::percentile(m_frameTimes, 100));
+  for (size_t i = 0; i < m_counters.size(); ++i) {
+    const std::map<std::string, double> counters = m_counters[i]();
+    for (std::map<std::string, double>::const_iterator it = counters.begin(); it != counters.end(); ++it)
+      printf("# %-28s %10.2f\n", it->first.c_str(), it->second);
+  }
+  fflush(stdout);
+}
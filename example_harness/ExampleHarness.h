@@ -0,0 +1,115 @@
+#ifndef EXAMPLEHARNESS_H
+#define EXAMPLEHARNESS_H
+
+#include "StartupTrace.h"
+
+#include <QString>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CompressedGeometry;
+class QCoreApplication;
+class QWidget;
+class SoNode;
+
+// What every example does around its scene: Qt and SoQt set up, an
+// examiner viewer in a window, the main loop. Or, with --headless, no
+// window at all: the scene is rendered offscreen and the frame times
+// reported, so that any example can run as a performance test.
+//
+// Options, taken out of argc/argv so that the example can parse the rest:
+//   --headless   render offscreen, with a software GL (Mesa's llvmpipe is
+//                asked for with LIBGL_ALWAYS_SOFTWARE; on a machine without
+//                a display, run under xvfb-run)
+//   --frames N   render N frames after the first one, print their times
+//                and exit (100 by default when headless)
+//   --orbit      turn the camera around the scene, a full turn over the
+//                frames (in the viewer without --frames: until closed)
+//   --size WxH   of the offscreen image, 800x600 by default
+//   --startup-trace FILE
+//                also write the startup phases as a Chrome trace
+//   --scene-memory
+//                print what the field values of the scene take in memory,
+//                by node type, DEF name and separator (see SceneMemory)
+//   --scene-memory-json FILE
+//                the same, written as JSON
+//   --compress-hidden
+//                keep the vertex arrays below switches that are off
+//                compressed until they are shown (see CompressedGeometry),
+//                and print the compression ratio and decode time
+//   --export-glb FILE
+//                write the triangles of the scene to a binary glTF file
+//                before rendering, and print the export throughput (see
+//                GlbExporter)
+//
+// The phases of the start (Qt, Coin and SoQt initialization, building the
+// scene, the first render and, in the viewer, the first swap) are timed
+// and printed to stderr once the first frame is done; examples can split
+// the building of their scene with phase().
+//
+// Use:
+//   ExampleHarness harness(argc, argv); // first: it initializes Coin
+//   SoSeparator *root = new SoSeparator;
+//   ... // build the scene
+//   return harness.run(root);
+class ExampleHarness {
+public:
+  ExampleHarness(int & argc, char ** argv);
+  ~ExampleHarness();
+
+  // Number of arguments of the harness option at argv[i] (0 if it is not
+  // one), for examples which parse their arguments before the harness
+  static int optionLength(int argc, char ** argv, int i);
+
+  bool headless() const { return m_headless; }
+  unsigned frames() const { return m_frames; }
+  bool orbit() const { return m_orbit; }
+
+  // Starts a phase of the startup, which ends with the next one (e.g.
+  // reading a file, then optimizing it); no-op after the first frame
+  void phase(const char * name) { m_trace.begin(name); }
+
+  // The main window, 0 when headless
+  QWidget * window() const { return m_window.get(); }
+
+  // Shows the scene until the window is closed, or renders the frames;
+  // returns the exit code for main()
+  int run(SoNode * root);
+
+  // Named counters of the example (e.g. a manager's statistics), read
+  // when the frame times are reported and printed after them
+  typedef std::function<std::map<std::string, double>()> Counters;
+  void addCounters(const Counters & counters) { m_counters.push_back(counters); }
+
+  // Frame times of the last run, in ms (the first frame apart)
+  double firstFrameTime() const { return m_firstFrame; }
+  const std::vector<double> & frameTimes() const { return m_frameTimes; }
+
+private:
+  StartupTrace m_trace; // first: from the construction of the harness
+  bool m_headless;
+  unsigned m_frames;
+  bool m_orbit;
+  bool m_sceneMemory;
+  QString m_sceneMemoryFile;
+  QString m_glbFile;
+  bool m_compressHidden;
+  std::unique_ptr<CompressedGeometry> m_compressed;
+  int m_width, m_height;
+  QString m_name;
+  std::unique_ptr<QCoreApplication> m_application;
+  std::unique_ptr<QWidget> m_window;
+  double m_firstFrame;
+  std::vector<double> m_frameTimes;
+  std::vector<Counters> m_counters;
+
+  int runHeadless(SoNode * root);
+  int runViewer(SoNode * root);
+  void report() const;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "FrameTiming.h"
+
+#include <Inventor/Qt/SoQtRenderArea.h>
+#include <Inventor/system/gl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+
+//____________________________________________________________________
+double FrameTiming::timedRender(SoQtRenderArea * area)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  area->render();
+  glFinish(); // the whole frame, as the offscreen renderer which waits for the pixels
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+double FrameTiming::percentile(std::vector<double> values, double p)
+{
+  if (values.empty())
+    return 0.0;
+  p = std::min(100.0, std::max(0.0, p));
+  size_t rank = size_t(std::ceil(p / 100.0 * values.size()));
+  if (rank > 0)
+    --rank;
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank];
+}
+
+//____________________________________________________________________
+void FrameTiming::requestSoftwareGL()
+{
+  // Honoured by Mesa: forces the llvmpipe/softpipe rasterizer
+  setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+}
@@ -0,0 +1,27 @@
+#ifndef FRAMETIMING_H
+#define FRAMETIMING_H
+
+#include <vector>
+
+class SoQtRenderArea;
+
+// Frame timing helpers shared by the example harness and the custom
+// examiner viewer.
+namespace FrameTiming {
+
+// Renders the scene of 'area' right away (synchronously, bypassing the
+// redraw queue), waits for GL to finish it, and returns how long that
+// took, in ms
+double timedRender(SoQtRenderArea * area);
+
+// Nearest-rank percentile of 'values', p in [0,100]; 0 if there are none
+double percentile(std::vector<double> values, double p);
+
+// Asks Mesa for its software rasterizer (llvmpipe or softpipe), unless
+// LIBGL_ALWAYS_SOFTWARE is set already. Must be called before the first
+// GL context is created.
+void requestSoftwareGL();
+
+}
+
+#endif
@@ -0,0 +1,373 @@
+#include "GlbExporter.h"
+
+#include <Inventor/SbColor.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/nodes/SoShape.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+
+namespace {
+
+// Binary chunk written in blocks of this size
+const size_t bufferSize = 1 << 20;
+
+// glTF constants
+const int FLOAT = 5126;
+const int UNSIGNED_INT = 5125;
+const int ARRAY_BUFFER = 34962;
+const int ELEMENT_ARRAY_BUFFER = 34963;
+const int TRIANGLES = 4;
+
+void writeUInt32(QFile & file, uint32_t value)
+{
+  file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+QJsonArray toJson(const float * values, int n)
+{
+  QJsonArray array;
+  for (int i = 0; i < n; ++i)
+    array.append(double(values[i]));
+  return array;
+}
+
+QJsonObject accessor(int bufferView, int componentType, int count, const char * type)
+{
+  QJsonObject object;
+  object["bufferView"] = bufferView;
+  object["componentType"] = componentType;
+  object["count"] = count;
+  object["type"] = type;
+  return object;
+}
+
+QJsonObject bufferView(unsigned long long offset, unsigned long long length, int target)
+{
+  QJsonObject object;
+  object["buffer"] = 0;
+  object["byteOffset"] = double(offset); // exact up to 2^53
+  object["byteLength"] = double(length);
+  object["target"] = target;
+  return object;
+}
+
+}
+
+
+//____________________________________________________________________
+bool GlbExporter::Vertex::operator==(const Vertex & other) const
+{
+  return !memcmp(this, &other, sizeof(Vertex));
+}
+
+//____________________________________________________________________
+size_t GlbExporter::VertexHash::operator()(const Vertex & vertex) const
+{
+  // FNV-1a over the bits of the six floats
+  uint32_t words[6];
+  memcpy(words, &vertex, sizeof(words));
+  size_t hash = 2166136261u;
+  for (int i = 0; i < 6; ++i)
+    hash = (hash ^ words[i]) * 16777619u;
+  return hash;
+}
+
+//____________________________________________________________________
+GlbExporter::GlbExporter()
+: m_material(0),
+  m_binaryBytes(0),
+  m_failed(false),
+  m_shapes(0),
+  m_triangles(0),
+  m_vertexCount(0),
+  m_fileBytes(0),
+  m_time(0.0)
+{
+}
+
+//____________________________________________________________________
+GlbExporter::~GlbExporter()
+{
+}
+
+//____________________________________________________________________
+bool GlbExporter::write(SoNode * root, const QString & filename)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_meshes.clear();
+  m_materials.clear();
+  m_buffer.clear();
+  m_buffer.reserve(bufferSize);
+  m_binaryBytes = 0;
+  m_failed = false;
+  m_shapes = 0;
+  m_triangles = m_vertexCount = m_fileBytes = 0;
+
+  m_binary.reset(new QTemporaryFile);
+  if (!m_binary->open(QIODevice::ReadWrite)) {
+    fprintf(stderr, "Cannot create a temporary file for %s\n", qPrintable(filename));
+    m_binary.reset();
+    return false;
+  }
+
+  SoCallbackAction action;
+  action.addPreCallback(SoShape::getClassTypeId(), preShapeCB, this);
+  action.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, this);
+  action.addPostCallback(SoShape::getClassTypeId(), postShapeCB, this);
+  root->ref();
+  action.apply(root);
+  root->unrefNoDelete();
+  flush();
+
+  const bool ok = !m_failed && writeGlb(filename);
+  m_binary.reset();
+  m_vertexIndices.clear();
+  m_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return ok;
+}
+
+//____________________________________________________________________
+void GlbExporter::append(const void * data, size_t size)
+{
+  if (m_buffer.size() + size > bufferSize)
+    flush();
+  const char * bytes = static_cast<const char *>(data);
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+  m_binaryBytes += size;
+}
+
+//____________________________________________________________________
+void GlbExporter::flush()
+{
+  if (m_buffer.empty())
+    return;
+  if (m_binary->write(m_buffer.data(), m_buffer.size()) != qint64(m_buffer.size()) && !m_failed) {
+    fprintf(stderr, "Cannot write to the temporary file %s\n", qPrintable(m_binary->fileName()));
+    m_failed = true;
+  }
+  m_buffer.clear();
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response GlbExporter::preShapeCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+  GlbExporter * self = static_cast<GlbExporter *>(userdata);
+  self->m_matrix = action->getModelMatrix();
+  self->m_normalMatrix = self->m_matrix.inverse().transpose();
+  self->m_vertexIndices.clear();
+  self->m_vertices.clear();
+  self->m_indices.clear();
+  self->m_material = self->material(action);
+  return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void GlbExporter::triangleCB(void * userdata, SoCallbackAction *,
+                             const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3)
+{
+  GlbExporter * self = static_cast<GlbExporter *>(userdata);
+  self->addVertex(v1);
+  self->addVertex(v2);
+  self->addVertex(v3);
+  ++self->m_triangles;
+}
+
+//____________________________________________________________________
+void GlbExporter::addVertex(const SoPrimitiveVertex * primitiveVertex)
+{
+  SbVec3f position, normal;
+  m_matrix.multVecMatrix(primitiveVertex->getPoint(), position);
+  m_normalMatrix.multDirMatrix(primitiveVertex->getNormal(), normal);
+  if (normal.length() > 0.0f)
+    normal.normalize();
+
+  Vertex vertex;
+  memset(&vertex, 0, sizeof(vertex)); // no padding bits in the comparisons
+  for (int k = 0; k < 3; ++k) {
+    vertex.position[k] = position[k];
+    vertex.normal[k] = normal[k] + 0.0f; // -0 as 0
+  }
+  std::pair<std::unordered_map<Vertex, uint32_t, VertexHash>::iterator, bool> inserted =
+    m_vertexIndices.insert(std::make_pair(vertex, uint32_t(m_vertices.size())));
+  if (inserted.second)
+    m_vertices.push_back(vertex);
+  m_indices.push_back(inserted.first->second);
+  ++m_vertexCount;
+}
+
+//____________________________________________________________________
+int GlbExporter::material(SoCallbackAction * action)
+{
+  SbColor ambient, diffuse, specular, emission;
+  float shininess = 0.0f, transparency = 0.0f;
+  action->getMaterial(ambient, diffuse, specular, emission, shininess, transparency);
+  const SbVec4f color(diffuse[0], diffuse[1], diffuse[2], 1.0f - transparency);
+  std::vector<SbVec4f>::const_iterator it = std::find(m_materials.begin(), m_materials.end(), color);
+  if (it != m_materials.end())
+    return int(it - m_materials.begin());
+  m_materials.push_back(color);
+  return int(m_materials.size()) - 1;
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response GlbExporter::postShapeCB(void * userdata, SoCallbackAction *, const SoNode * node)
+{
+  static_cast<GlbExporter *>(userdata)->endShape(node);
+  return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void GlbExporter::endShape(const SoNode * shape)
+{
+  if (m_indices.empty())
+    return; // lines, points, text
+  ++m_shapes;
+
+  Mesh mesh;
+  mesh.name = shape->getName().getLength() ? shape->getName().getString() : shape->getTypeId().getName().getString();
+  mesh.offset = m_binaryBytes;
+  mesh.vertices = m_vertices.size();
+  mesh.indices = m_indices.size();
+  mesh.material = m_material;
+  for (int k = 0; k < 3; ++k) {
+    mesh.min[k] = m_vertices[0].position[k];
+    mesh.max[k] = m_vertices[0].position[k];
+  }
+  for (size_t i = 0; i < m_vertices.size(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      mesh.min[k] = std::min(mesh.min[k], m_vertices[i].position[k]);
+      mesh.max[k] = std::max(mesh.max[k], m_vertices[i].position[k]);
+    }
+    append(m_vertices[i].position, sizeof(m_vertices[i].position));
+  }
+  for (size_t i = 0; i < m_vertices.size(); ++i)
+    append(m_vertices[i].normal, sizeof(m_vertices[i].normal));
+  append(m_indices.data(), m_indices.size() * sizeof(uint32_t));
+  m_meshes.push_back(mesh);
+}
+
+//____________________________________________________________________
+bool GlbExporter::writeGlb(const QString & filename)
+{
+  QJsonArray bufferViews, accessors, meshes, nodes, sceneNodes, materials;
+  for (size_t i = 0; i < m_meshes.size(); ++i) {
+    const Mesh & mesh = m_meshes[i];
+    const unsigned long long arrayBytes = 3ull * sizeof(float) * mesh.vertices;
+    bufferViews.append(bufferView(mesh.offset, arrayBytes, ARRAY_BUFFER));
+    bufferViews.append(bufferView(mesh.offset + arrayBytes, arrayBytes, ARRAY_BUFFER));
+    bufferViews.append(bufferView(mesh.offset + 2 * arrayBytes, sizeof(uint32_t) * mesh.indices,
+                                  ELEMENT_ARRAY_BUFFER));
+
+    const int first = int(3 * i);
+    QJsonObject positions = accessor(first, FLOAT, mesh.vertices, "VEC3");
+    positions["min"] = toJson(mesh.min, 3);
+    positions["max"] = toJson(mesh.max, 3);
+    accessors.append(positions);
+    accessors.append(accessor(first + 1, FLOAT, mesh.vertices, "VEC3"));
+    accessors.append(accessor(first + 2, UNSIGNED_INT, mesh.indices, "SCALAR"));
+
+    QJsonObject attributes;
+    attributes["POSITION"] = first;
+    attributes["NORMAL"] = first + 1;
+    QJsonObject primitive;
+    primitive["attributes"] = attributes;
+    primitive["indices"] = first + 2;
+    primitive["material"] = mesh.material;
+    primitive["mode"] = TRIANGLES;
+    QJsonObject object;
+    object["name"] = mesh.name;
+    object["primitives"] = QJsonArray{ primitive };
+    meshes.append(object);
+
+    QJsonObject node;
+    node["mesh"] = int(i);
+    nodes.append(node);
+    sceneNodes.append(int(i));
+  }
+  for (size_t i = 0; i < m_materials.size(); ++i) {
+    QJsonObject pbr;
+    pbr["baseColorFactor"] = toJson(m_materials[i].getValue(), 4);
+    pbr["metallicFactor"] = 0.0;
+    QJsonObject object;
+    object["pbrMetallicRoughness"] = pbr;
+    if (m_materials[i][3] < 1.0f)
+      object["alphaMode"] = "BLEND";
+    object["doubleSided"] = true; // Inventor shapes often are not closed, or not consistently ordered
+    materials.append(object);
+  }
+
+  QJsonObject gltf;
+  gltf["asset"] = QJsonObject{ { "version", "2.0" }, { "generator", "Coin3D-SoQt-Examples GlbExporter" } };
+  gltf["scene"] = 0;
+  gltf["scenes"] = QJsonArray{ QJsonObject{ { "nodes", sceneNodes } } };
+  gltf["nodes"] = nodes;
+  gltf["meshes"] = meshes;
+  gltf["materials"] = materials;
+  gltf["accessors"] = accessors;
+  gltf["bufferViews"] = bufferViews;
+  if (m_binaryBytes)
+    gltf["buffers"] = QJsonArray{ QJsonObject{ { "byteLength", double(m_binaryBytes) } } };
+
+  // Both chunks padded to 4 bytes: the JSON with spaces, the binary with zeros
+  QByteArray json = QJsonDocument(gltf).toJson(QJsonDocument::Compact);
+  while (json.size() % 4)
+    json.append(' ');
+  const unsigned long long binaryLength = (m_binaryBytes + 3) & ~3ull;
+  m_fileBytes = 12 + 8 + json.size() + (m_binaryBytes ? 8 + binaryLength : 0);
+  if (m_fileBytes > 0xffffffffull) {
+    fprintf(stderr, "Cannot write %s: %.0f MB, more than GLB files can hold (4 GB)\n",
+            qPrintable(filename), m_fileBytes / 1048576.0);
+    return false;
+  }
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    fprintf(stderr, "Cannot write file %s\n", qPrintable(filename));
+    return false;
+  }
+  writeUInt32(file, 0x46546C67); // "glTF"
+  writeUInt32(file, 2);
+  writeUInt32(file, uint32_t(m_fileBytes));
+  writeUInt32(file, json.size());
+  writeUInt32(file, 0x4E4F534A); // "JSON"
+  file.write(json);
+  if (m_binaryBytes) {
+    writeUInt32(file, uint32_t(binaryLength));
+    writeUInt32(file, 0x004E4942); // "BIN"
+    m_binary->seek(0);
+    std::vector<char> block(bufferSize);
+    qint64 read = 0;
+    while ((read = m_binary->read(block.data(), block.size())) > 0)
+      file.write(block.data(), read);
+    file.write("\0\0\0", binaryLength - m_binaryBytes);
+  }
+  if (file.error() != QFileDevice::NoError) {
+    fprintf(stderr, "Cannot write file %s: %s\n", qPrintable(filename), qPrintable(file.errorString()));
+    return false;
+  }
+  return true;
+}
+
+//____________________________________________________________________
+void GlbExporter::printReport() const
+{
+  unsigned long long written = 0;
+  for (size_t i = 0; i < m_meshes.size(); ++i)
+    written += m_meshes[i].vertices;
+  const double megabytes = m_fileBytes / 1048576.0;
+  printf("glb export: %u shapes, %llu triangles, %llu vertices (%llu after deduplication), %u materials\n",
+         m_shapes, m_triangles, m_vertexCount, written, unsigned(m_materials.size()));
+  printf("glb export: %.3f MB in %.2f ms, %.1f MB/s\n", megabytes, m_time,
+         m_time > 0.0 ? megabytes / (m_time / 1000.0) : 0.0);
+  fflush(stdout);
+}
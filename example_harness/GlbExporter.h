@@ -0,0 +1,97 @@
+#ifndef GLBEXPORTER_H
+#define GLBEXPORTER_H
+
+#include <Inventor/SbLinear.h>
+#include <Inventor/actions/SoCallbackAction.h>
+
+#include <QString>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class QFile;
+class SoPrimitiveVertex;
+
+// Writes the triangles of a scene to a binary glTF 2.0 file (.glb), for
+// the web viewers and the tools which read glTF.
+//
+// The scene is traversed with a SoCallbackAction, so whatever a shape
+// generates is exported: MyTorus, face and strip sets, node kit parts,
+// the primitives of Coin. Each shape traversed becomes a glTF mesh and
+// node, with its vertices in world coordinates (instances are written as
+// many times as they are traversed), its vertices deduplicated and
+// indexed, and the diffuse color and transparency of its first material.
+// Lines, points, text and textures are not exported.
+//
+// Only one shape is held in memory at a time: its arrays are appended to
+// the binary chunk as soon as it is done, through a 1 MB write buffer.
+// As the JSON chunk, which comes first in the file, needs the sizes of
+// all the arrays, the binary chunk is streamed to a temporary file and
+// copied after it at the end. The floats and indices are written in the
+// byte order of the machine, which glTF expects to be little-endian.
+class GlbExporter {
+public:
+  GlbExporter();
+  ~GlbExporter();
+
+  bool write(SoNode * root, const QString & filename);
+
+  // Shapes, triangles and vertices exported, size and time of the last write
+  void printReport() const;
+  unsigned long long fileBytes() const { return m_fileBytes; }
+  double time() const { return m_time; } // ms
+
+private:
+  // A vertex, as compared for deduplication
+  struct Vertex {
+    float position[3];
+    float normal[3];
+    bool operator==(const Vertex & other) const;
+  };
+  struct VertexHash {
+    size_t operator()(const Vertex & vertex) const;
+  };
+
+  // What the JSON chunk says of a mesh written to the binary chunk
+  struct Mesh {
+    QString name;
+    unsigned long long offset; // in the binary chunk
+    unsigned vertices, indices;
+    float min[3], max[3];
+    int material;
+  };
+
+  // The shape being exported
+  SbMatrix m_matrix, m_normalMatrix;
+  std::unordered_map<Vertex, uint32_t, VertexHash> m_vertexIndices;
+  std::vector<Vertex> m_vertices;
+  std::vector<uint32_t> m_indices;
+  int m_material;
+
+  std::vector<Mesh> m_meshes;
+  std::vector<SbVec4f> m_materials; // diffuse color and alpha
+  std::unique_ptr<QFile> m_binary;
+  std::vector<char> m_buffer;
+  unsigned long long m_binaryBytes;
+  bool m_failed;
+
+  unsigned m_shapes;
+  unsigned long long m_triangles, m_vertexCount, m_fileBytes;
+  double m_time;
+
+  void append(const void * data, size_t size);
+  void flush();
+  void addVertex(const SoPrimitiveVertex * vertex);
+  int material(SoCallbackAction * action);
+  void endShape(const SoNode * shape);
+  bool writeGlb(const QString & filename);
+
+  static SoCallbackAction::Response preShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+  static SoCallbackAction::Response postShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+  static void triangleCB(void * userdata, SoCallbackAction * action,
+                         const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3);
+};
+
+#endif
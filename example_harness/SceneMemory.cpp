@@ -0,0 +1,302 @@
+#include "SceneMemory.h"
+#include "CompressedGeometry.h"
+
+#include <Inventor/SbString.h>
+#include <Inventor/fields/SoFieldContainer.h>
+#include <Inventor/fields/SoMFBool.h>
+#include <Inventor/fields/SoMFColor.h>
+#include <Inventor/fields/SoMFColorRGBA.h>
+#include <Inventor/fields/SoMFDouble.h>
+#include <Inventor/fields/SoMFEngine.h>
+#include <Inventor/fields/SoMFEnum.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFMatrix.h>
+#include <Inventor/fields/SoMFName.h>
+#include <Inventor/fields/SoMFNode.h>
+#include <Inventor/fields/SoMFPath.h>
+#include <Inventor/fields/SoMFPlane.h>
+#include <Inventor/fields/SoMFRotation.h>
+#include <Inventor/fields/SoMFShort.h>
+#include <Inventor/fields/SoMFString.h>
+#include <Inventor/fields/SoMFTime.h>
+#include <Inventor/fields/SoMFUInt32.h>
+#include <Inventor/fields/SoMFUShort.h>
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec3d.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoMFVec4f.h>
+#include <Inventor/fields/SoSFImage.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+
+namespace {
+
+// Size of one value of the multiple-value fields of fixed size
+size_t valueSize(const SoField * field)
+{
+  static std::vector<std::pair<SoType, size_t> > sizes;
+  if (sizes.empty()) {
+    sizes.push_back(std::make_pair(SoMFVec3f::getClassTypeId(), sizeof(SbVec3f)));
+    sizes.push_back(std::make_pair(SoMFVec2f::getClassTypeId(), sizeof(SbVec2f)));
+    sizes.push_back(std::make_pair(SoMFVec4f::getClassTypeId(), sizeof(SbVec4f)));
+    sizes.push_back(std::make_pair(SoMFVec3d::getClassTypeId(), sizeof(SbVec3d)));
+    sizes.push_back(std::make_pair(SoMFColor::getClassTypeId(), sizeof(SbColor)));
+    sizes.push_back(std::make_pair(SoMFColorRGBA::getClassTypeId(), sizeof(SbColor4f)));
+    sizes.push_back(std::make_pair(SoMFInt32::getClassTypeId(), sizeof(int32_t)));
+    sizes.push_back(std::make_pair(SoMFUInt32::getClassTypeId(), sizeof(uint32_t)));
+    sizes.push_back(std::make_pair(SoMFShort::getClassTypeId(), sizeof(short)));
+    sizes.push_back(std::make_pair(SoMFUShort::getClassTypeId(), sizeof(unsigned short)));
+    sizes.push_back(std::make_pair(SoMFFloat::getClassTypeId(), sizeof(float)));
+    sizes.push_back(std::make_pair(SoMFDouble::getClassTypeId(), sizeof(double)));
+    sizes.push_back(std::make_pair(SoMFBool::getClassTypeId(), sizeof(SbBool)));
+    sizes.push_back(std::make_pair(SoMFEnum::getClassTypeId(), sizeof(int))); // and SoMFBitMask
+    sizes.push_back(std::make_pair(SoMFRotation::getClassTypeId(), sizeof(SbRotation)));
+    sizes.push_back(std::make_pair(SoMFMatrix::getClassTypeId(), sizeof(SbMatrix)));
+    sizes.push_back(std::make_pair(SoMFPlane::getClassTypeId(), sizeof(SbPlane)));
+    sizes.push_back(std::make_pair(SoMFTime::getClassTypeId(), sizeof(SbTime)));
+    sizes.push_back(std::make_pair(SoMFName::getClassTypeId(), sizeof(SbName)));
+    sizes.push_back(std::make_pair(SoMFNode::getClassTypeId(), sizeof(SoNode *)));
+    sizes.push_back(std::make_pair(SoMFPath::getClassTypeId(), sizeof(SoPath *)));
+    sizes.push_back(std::make_pair(SoMFEngine::getClassTypeId(), sizeof(SoEngine *)));
+  }
+  for (size_t i = 0; i < sizes.size(); ++i)
+    if (field->isOfType(sizes[i].first))
+      return sizes[i].second;
+  return 0;
+}
+
+QJsonArray toJson(const std::vector<SceneMemory::Entry> & entries)
+{
+  QJsonArray array;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    QJsonObject entry;
+    entry["label"] = QString::fromStdString(entries[i].label);
+    entry["type"] = QString::fromStdString(entries[i].type);
+    entry["nodes"] = int(entries[i].nodes);
+    entry["bytes"] = double(entries[i].bytes); // exact up to 2^53
+    entry["subtree"] = double(entries[i].subtree);
+    array.append(entry);
+  }
+  return array;
+}
+
+}
+
+
+//____________________________________________________________________
+SceneMemory::SceneMemory(unsigned limit)
+: m_limit(limit),
+  m_total(0),
+  m_nodes(0),
+  m_fields(0),
+  m_shared(0),
+  m_sharedImages(0),
+  m_time(0.0)
+{
+}
+
+//____________________________________________________________________
+unsigned long long SceneMemory::fieldBytes(const SoField * field)
+{
+  if (field->isOfType(SoSFImage::getClassTypeId())) {
+    SbVec2s size;
+    int components = 0;
+    static_cast<const SoSFImage *>(field)->getValue(size, components);
+    return (unsigned long long)size[0] * size[1] * components;
+  }
+  if (!field->isOfType(SoMField::getClassTypeId()))
+    return 0;
+
+  // Bound by a CompressedGeometry: its own values are in its report
+  if (field->isOfType(SoMFVec3f::getClassTypeId()) &&
+      CompressedGeometry::isPlaceholder(*static_cast<const SoMFVec3f *>(field)))
+    return 0;
+
+  const SoMField * values = static_cast<const SoMField *>(field);
+  if (field->isOfType(SoMFString::getClassTypeId())) {
+    const SoMFString * strings = static_cast<const SoMFString *>(field);
+    unsigned long long bytes = 0;
+    for (int i = 0; i < strings->getNum(); ++i)
+      bytes += sizeof(SbString) + (*strings)[i].getLength() + 1;
+    return bytes;
+  }
+  return (unsigned long long)values->getNum() * valueSize(field);
+}
+
+//____________________________________________________________________
+void SceneMemory::apply(SoNode * root)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_total = 0;
+  m_nodes = m_fields = m_shared = m_sharedImages = 0;
+  m_visited.clear();
+  m_sharedNodes.clear();
+  m_images.clear();
+  m_types.clear();
+  m_names.clear();
+  m_separators.clear();
+
+  root->ref();
+  m_total = visit(root, "");
+  root->unrefNoDelete();
+  m_visited.clear();
+  m_sharedNodes.clear();
+  m_images.clear();
+  m_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+unsigned long long SceneMemory::visit(SoNode * node, const std::string & path)
+{
+  if (!m_visited.insert(node).second) {
+    // Counted where it was first met
+    if (m_sharedNodes.insert(node).second)
+      ++m_shared;
+    return 0;
+  }
+  ++m_nodes;
+
+  // The node's own values, and the nodes its fields hold
+  unsigned long long own = 0, subtree = 0;
+  std::vector<std::pair<SoNode *, std::string> > held; // with the field name
+  SoFieldList fields;
+  node->getFields(fields);
+  for (int i = 0; i < fields.getLength(); ++i) {
+    unsigned long long bytes = fieldBytes(fields[i]);
+    if (bytes && fields[i]->isOfType(SoSFImage::getClassTypeId())) {
+      // Pixels shared between nodes (set with NO_COPY) are counted once too
+      SbVec2s size;
+      int components = 0;
+      if (!m_images.insert(static_cast<SoSFImage *>(fields[i])->getValue(size, components)).second) {
+        ++m_sharedImages;
+        bytes = 0;
+      }
+    }
+    if (bytes)
+      ++m_fields;
+    own += bytes;
+    SbName fieldName;
+    if (!node->getFieldName(fields[i], fieldName))
+      continue;
+    if (fields[i]->isOfType(SoSFNode::getClassTypeId())) {
+      if (SoNode * value = static_cast<SoSFNode *>(fields[i])->getValue())
+        held.push_back(std::make_pair(value, std::string(fieldName.getString())));
+    } else if (fields[i]->isOfType(SoMFNode::getClassTypeId())) {
+      const SoMFNode * values = static_cast<SoMFNode *>(fields[i]);
+      for (int j = 0; j < values->getNum(); ++j)
+        if ((*values)[j])
+          held.push_back(std::make_pair((*values)[j], std::string(fieldName.getString()) + "." + std::to_string(j)));
+    }
+  }
+  for (size_t i = 0; i < held.size(); ++i)
+    subtree += visit(held[i].first, path + "/" + held[i].second);
+
+  // All the children, whichever a switch would traverse, node kit parts too
+  if (SoChildList * children = node->getChildren())
+    for (int i = 0; i < children->getLength(); ++i)
+      subtree += visit((*children)[i], path + "/" + std::to_string(i));
+  subtree += own;
+
+  const std::string type = node->getTypeId().getName().getString();
+  Entry & byType = m_types[type];
+  byType.label = byType.type = type;
+  ++byType.nodes;
+  byType.bytes += own;
+  byType.subtree += own;
+
+  const std::string name = node->getName().getString();
+  if (!name.empty()) {
+    Entry entry = { name, type, 1, own, subtree };
+    m_names.push_back(entry);
+  }
+  if (node->isOfType(SoSeparator::getClassTypeId())) {
+    Entry entry = { name.empty() ? (path.empty() ? std::string("/") : path) : name + " (" + path + ")",
+                    type, 1, own, subtree };
+    m_separators.push_back(entry);
+  }
+  return subtree;
+}
+
+//____________________________________________________________________
+std::vector<SceneMemory::Entry> SceneMemory::sorted(std::vector<Entry> entries) const
+{
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry & a, const Entry & b) { return a.subtree > b.subtree; });
+  if (m_limit && entries.size() > m_limit)
+    entries.resize(m_limit);
+  return entries;
+}
+
+//____________________________________________________________________
+std::vector<SceneMemory::Entry> SceneMemory::typesBySize() const
+{
+  // All of them: there are not many types
+  std::vector<Entry> types;
+  for (std::map<std::string, Entry>::const_iterator it = m_types.begin(); it != m_types.end(); ++it)
+    types.push_back(it->second);
+  std::stable_sort(types.begin(), types.end(), [](const Entry & a, const Entry & b) { return a.bytes > b.bytes; });
+  return types;
+}
+
+//____________________________________________________________________
+void SceneMemory::printReport() const
+{
+  printf("scene memory: %.3f MB of field values in %u fields of %u nodes (%u shared and %u shared images, "
+         "counted once), %.2f ms\n", m_total / 1048576.0, m_fields, m_nodes, m_shared, m_sharedImages, m_time);
+
+  const std::vector<Entry> types = typesBySize();
+  printf("# %-30s  %8s  %14s\n", "node type", "nodes", "bytes");
+  for (size_t i = 0; i < types.size(); ++i)
+    printf("  %-30s  %8u  %14llu\n", types[i].label.c_str(), types[i].nodes, types[i].bytes);
+
+  const std::vector<Entry> names = sorted(m_names);
+  if (!names.empty()) {
+    printf("# %-30s  %-20s  %14s  %14s\n", "DEF name", "type", "bytes", "subtree");
+    for (size_t i = 0; i < names.size(); ++i)
+      printf("  %-30s  %-20s  %14llu  %14llu\n", names[i].label.c_str(), names[i].type.c_str(),
+             names[i].bytes, names[i].subtree);
+  }
+
+  const std::vector<Entry> separators = sorted(m_separators);
+  printf("# %-30s  %14s\n", "separator (child indices)", "subtree");
+  for (size_t i = 0; i < separators.size(); ++i)
+    printf("  %-30s  %14llu\n", separators[i].label.c_str(), separators[i].subtree);
+  fflush(stdout);
+}
+
+//____________________________________________________________________
+bool SceneMemory::writeJson(const QString & filename) const
+{
+  QJsonObject report;
+  report["bytes"] = double(m_total);
+  report["fields"] = int(m_fields);
+  report["nodes"] = int(m_nodes);
+  report["shared"] = int(m_shared);
+  report["sharedImages"] = int(m_sharedImages);
+  report["byType"] = toJson(typesBySize());
+  report["byName"] = toJson(sorted(m_names));
+  report["bySeparator"] = toJson(sorted(m_separators));
+
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    fprintf(stderr, "Cannot write file %s\n", qPrintable(filename));
+    return false;
+  }
+  file.write(QJsonDocument(report).toJson());
+  return true;
+}
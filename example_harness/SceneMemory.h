@@ -0,0 +1,68 @@
+#ifndef SCENEMEMORY_H
+#define SCENEMEMORY_H
+
+#include <QString>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class SoField;
+class SoNode;
+
+// What the geometry of a scene takes in memory: the values held by the
+// multiple-value fields (SoMFVec3f, SoMFInt32, SoMFColor...) of all its
+// nodes, and the images of SoSFImage fields, which for textures are the
+// other big item.
+//
+// The whole graph is walked: all the children of groups, switches
+// included, node kit parts, and the nodes held in fields (e.g. the
+// vertexProperty of a shape). A node met several times is counted once,
+// in the subtree it was first met in, so that the subtrees add up to the
+// total; so is an image whose pixels several nodes share (NO_COPY). The bytes are reported by node type, by DEF name (the node's own
+// and its subtree's) and by separator subtree, as text or as JSON.
+//
+// The sizes are those of the values (getNum() times the size of one), not
+// of the memory allocated for them, nor of the nodes themselves; values
+// bound with setValuesPointer() are counted although they are not owned,
+// except the placeholders of a CompressedGeometry.
+class SceneMemory {
+public:
+  struct Entry {
+    std::string label;   // type, DEF name or path of child indices
+    std::string type;
+    unsigned nodes;
+    unsigned long long bytes;   // of the node(s) itself
+    unsigned long long subtree; // with what is under it
+  };
+
+  SceneMemory(unsigned limit = 20);
+
+  void apply(SoNode * root);
+
+  unsigned long long totalBytes() const { return m_total; }
+
+  // The largest first: all the types, at most 'limit' (0 for all) of the
+  // names and of the separators
+  void printReport() const;
+  bool writeJson(const QString & filename) const;
+
+  static unsigned long long fieldBytes(const SoField * field);
+
+private:
+  unsigned m_limit;
+  unsigned long long m_total;
+  unsigned m_nodes, m_fields, m_shared, m_sharedImages;
+  double m_time; // ms
+  std::set<const SoNode *> m_visited, m_sharedNodes;
+  std::set<const unsigned char *> m_images; // pixels already counted
+  std::map<std::string, Entry> m_types;
+  std::vector<Entry> m_names, m_separators;
+
+  unsigned long long visit(SoNode * node, const std::string & path);
+  std::vector<Entry> sorted(std::vector<Entry> entries) const;
+  std::vector<Entry> typesBySize() const;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "StartupTrace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+
+namespace {
+
+// How long ago the process started, in ms, from its start time in
+// /proc/self/stat (in clock ticks since boot); 0 if not known
+double processAge()
+{
+#ifdef CLOCK_BOOTTIME
+  FILE * file = fopen("/proc/self/stat", "r");
+  if (!file)
+    return 0.0;
+  char line[1024];
+  const bool read = fgets(line, sizeof(line), file) != 0;
+  fclose(file);
+  // The command name, in parentheses, may hold spaces: fields are counted
+  // after it, starttime being the 22nd
+  const char * field = read ? strrchr(line, ')') : 0;
+  for (int i = 2; field && i < 22; ++i)
+    field = strchr(field + 1, ' ');
+  if (!field)
+    return 0.0;
+  const double started = strtod(field + 1, 0) / sysconf(_SC_CLK_TCK);
+
+  timespec uptime;
+  if (clock_gettime(CLOCK_BOOTTIME, &uptime) != 0)
+    return 0.0;
+  const double age = uptime.tv_sec + uptime.tv_nsec * 1e-9 - started;
+  return age > 0.0 ? age * 1000.0 : 0.0;
+#else
+  return 0.0;
+#endif
+}
+
+QString applicationName()
+{
+  return QCoreApplication::instance() ? QFileInfo(QCoreApplication::applicationFilePath()).fileName()
+                                      : QString("example");
+}
+
+}
+
+
+//____________________________________________________________________
+StartupTrace::StartupTrace()
+: m_origin(std::chrono::steady_clock::now()),
+  m_processAge(processAge()),
+  m_open(false),
+  m_finished(false)
+{
+  if (m_processAge > 0.0)
+    m_phases.push_back({ "before main", 0.0, m_processAge }); // loading, static initialization
+}
+
+//____________________________________________________________________
+double StartupTrace::now() const
+{
+  return m_processAge + std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_origin).count();
+}
+
+//____________________________________________________________________
+void StartupTrace::begin(const char * name)
+{
+  if (m_finished)
+    return;
+  end();
+  m_phases.push_back({ name, now(), 0.0 });
+  m_open = true;
+}
+
+//____________________________________________________________________
+void StartupTrace::end()
+{
+  if (!m_open)
+    return;
+  m_phases.back().duration = now() - m_phases.back().start;
+  m_open = false;
+}
+
+//____________________________________________________________________
+void StartupTrace::finish()
+{
+  if (m_finished)
+    return;
+  end();
+  m_finished = true;
+
+  const QString name = applicationName();
+  fprintf(stderr, "# %s startup%s\n", qPrintable(name), m_processAge > 0.0 ? ", from exec" : ", from main");
+  fprintf(stderr, "# %-20s  %9s  %12s\n", "phase", "start[ms]", "duration[ms]");
+  for (size_t i = 0; i < m_phases.size(); ++i)
+    fprintf(stderr, "  %-20s  %9.3f  %12.3f\n", m_phases[i].name.c_str(), m_phases[i].start, m_phases[i].duration);
+  if (!m_phases.empty())
+    fprintf(stderr, "# %s: first frame after %.3f ms\n", qPrintable(name),
+            m_phases.back().start + m_phases.back().duration);
+
+  if (!m_filename.isEmpty())
+    writeChromeTrace();
+}
+
+//____________________________________________________________________
+void StartupTrace::writeChromeTrace() const
+{
+  // The Trace Event Format: complete ("X") events, times in us
+  const qint64 pid = QCoreApplication::applicationPid();
+  QJsonArray events;
+  QJsonObject process;
+  process["name"] = "process_name";
+  process["ph"] = "M";
+  process["pid"] = pid;
+  process["args"] = QJsonObject{ { "name", applicationName() } };
+  events.append(process);
+  for (size_t i = 0; i < m_phases.size(); ++i) {
+    QJsonObject event;
+    event["name"] = QString::fromStdString(m_phases[i].name);
+    event["cat"] = "startup";
+    event["ph"] = "X";
+    event["ts"] = m_phases[i].start * 1000.0;
+    event["dur"] = m_phases[i].duration * 1000.0;
+    event["pid"] = pid;
+    event["tid"] = 1;
+    events.append(event);
+  }
+  QJsonObject trace;
+  trace["traceEvents"] = events;
+  trace["displayTimeUnit"] = "ms";
+
+  QFile file(m_filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    fprintf(stderr, "Cannot write file %s\n", qPrintable(m_filename));
+    return;
+  }
+  file.write(QJsonDocument(trace).toJson());
+}
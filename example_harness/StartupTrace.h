@@ -0,0 +1,50 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// The phases of a start, from the exec() of the process to the first
+// frame on screen, one after the other: each begin() ends the phase
+// before it. finish() prints them to stderr and, if a file was given,
+// writes them as a Chrome trace (chrome://tracing, or ui.perfetto.dev).
+//
+// Times are from the start of the process as the kernel saw it, when
+// /proc tells (to 10 ms or so, the clock tick), otherwise from the
+// construction of the trace.
+class StartupTrace {
+public:
+  StartupTrace();
+
+  void setFile(const QString & filename) { m_filename = filename; }
+
+  // Ends the phase under way, if any, and starts 'name'
+  void begin(const char * name);
+  // Ends the phase under way
+  void end();
+  // Ends the phase under way and reports them all; once
+  void finish();
+  bool finished() const { return m_finished; }
+
+  // Since the start of the process, in ms
+  double now() const;
+
+private:
+  struct Phase {
+    std::string name;
+    double start, duration; // ms
+  };
+
+  std::chrono::steady_clock::time_point m_origin;
+  double m_processAge; // at m_origin, in ms; 0 if unknown
+  std::vector<Phase> m_phases;
+  bool m_open, m_finished;
+  QString m_filename;
+
+  void writeChromeTrace() const;
+};
+
+#endif
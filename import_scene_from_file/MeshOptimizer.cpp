@@ -0,0 +1,396 @@
+#include "MeshOptimizer.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoIndexedTriangleStripSet.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <set>
+
+
+namespace {
+
+// Forsyth's tuning
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, int valence, unsigned cacheSize)
+{
+  if (valence <= 0)
+    return -1.0f; // no face left to draw with it
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3)
+      score = lastTriangleScore; // used by the last face: no bonus for it over the others
+    else
+      score = std::pow(1.0f - float(cachePosition - 3) / float(cacheSize - 3), cacheDecayPower);
+  }
+  return score + valenceBoostScale * std::pow(float(valence), -valenceBoostPower);
+}
+
+struct Candidate {
+  SoIndexedShape * shape;
+  int materialBinding, normalBinding;
+  bool stateTexCoords; // texture coordinates outside the vertex property
+};
+
+struct Collector {
+  std::vector<Candidate> shapes;
+  std::set<SoNode *> seen;
+};
+
+// The bindings in effect for the shape: those of its own vertex property,
+// if it has the data, or those of the state. Shapes without normals get
+// them generated, so their normal binding does not matter.
+SoCallbackAction::Response collectCB(void * data, SoCallbackAction * action, const SoNode * node)
+{
+  Collector * collector = static_cast<Collector*>(data);
+  SoIndexedShape * shape = const_cast<SoIndexedShape*>(static_cast<const SoIndexedShape*>(node));
+  if (!collector->seen.insert(shape).second)
+    return SoCallbackAction::CONTINUE;
+  const SoVertexProperty * property = static_cast<const SoVertexProperty*>(shape->vertexProperty.getValue());
+  Candidate candidate = { shape, int(action->getMaterialBinding()), int(action->getNormalBinding()),
+                          action->getNumTextureCoordinates() > 0 };
+  if (property && property->orderedRGBA.getNum())
+    candidate.materialBinding = property->materialBinding.getValue();
+  if (property && property->normal.getNum())
+    candidate.normalBinding = property->normalBinding.getValue();
+  else if (!action->getNumNormals())
+    candidate.normalBinding = SoMaterialBinding::OVERALL;
+  collector->shapes.push_back(candidate);
+  return SoCallbackAction::CONTINUE;
+}
+
+}
+
+
+//____________________________________________________________________
+MeshOptimizer::MeshOptimizer(unsigned cacheSize)
+: m_cacheSize(std::max(cacheSize, 4u))
+{
+  m_stats = Stats();
+}
+
+//____________________________________________________________________
+std::vector<int> MeshOptimizer::order(const std::vector<std::vector<int> > & primitives, int numVertices, unsigned cacheSize)
+{
+  const int numPrimitives = primitives.size();
+  std::vector<int> result;
+  result.reserve(numPrimitives);
+
+  // Primitives around each vertex
+  std::vector<int> valence(numVertices, 0);
+  for (int p = 0; p < numPrimitives; ++p)
+    for (size_t i = 0; i < primitives[p].size(); ++i)
+      ++valence[primitives[p][i]];
+  std::vector<int> first(numVertices + 1, 0);
+  for (int v = 0; v < numVertices; ++v)
+    first[v + 1] = first[v] + valence[v];
+  std::vector<int> around(first[numVertices]), filled(first.begin(), first.end() - 1);
+  for (int p = 0; p < numPrimitives; ++p)
+    for (size_t i = 0; i < primitives[p].size(); ++i)
+      around[filled[primitives[p][i]]++] = p;
+
+  std::vector<int> cachePosition(numVertices, -1);
+  std::vector<float> score(numVertices);
+  for (int v = 0; v < numVertices; ++v)
+    score[v] = vertexScore(-1, valence[v], cacheSize);
+  std::vector<bool> drawn(numPrimitives, false);
+  std::vector<float> primitiveScore(numPrimitives);
+  // Normalized to a triangle, so that large polygons and strips do not always win
+  auto rescore = [&](int p) {
+    float s = 0.0f;
+    for (size_t i = 0; i < primitives[p].size(); ++i)
+      s += score[primitives[p][i]];
+    primitiveScore[p] = primitives[p].empty() ? 0.0f : s * 3.0f / primitives[p].size();
+  };
+  int best = -1;
+  for (int p = 0; p < numPrimitives; ++p) {
+    rescore(p);
+    if (best < 0 || primitiveScore[p] > primitiveScore[best])
+      best = p;
+  }
+
+  std::vector<int> cache, next;
+  int cursor = 0; // for restarts, when no primitive touches the cache
+  while (int(result.size()) < numPrimitives) {
+    if (best < 0) {
+      while (drawn[cursor])
+        ++cursor;
+      best = cursor;
+    }
+    result.push_back(best);
+    drawn[best] = true;
+    const std::vector<int> & primitive = primitives[best];
+
+    // The vertices of the primitive go to the front of the cache
+    next.clear();
+    for (size_t i = 0; i < primitive.size(); ++i) {
+      --valence[primitive[i]];
+      if (std::find(next.begin(), next.end(), primitive[i]) == next.end())
+        next.push_back(primitive[i]);
+    }
+    for (size_t i = 0; i < cache.size(); ++i)
+      if (std::find(next.begin(), next.end(), cache[i]) == next.end())
+        next.push_back(cache[i]);
+    for (size_t i = 0; i < next.size(); ++i) {
+      cachePosition[next[i]] = i < cacheSize ? int(i) : -1;
+      score[next[i]] = vertexScore(cachePosition[next[i]], valence[next[i]], cacheSize);
+    }
+
+    // The next primitive is the best one around the cache
+    best = -1;
+    for (size_t i = 0; i < next.size(); ++i) {
+      const int v = next[i];
+      for (int j = first[v]; j < first[v + 1]; ++j) {
+        const int p = around[j];
+        if (drawn[p])
+          continue;
+        rescore(p);
+        if (best < 0 || primitiveScore[p] > primitiveScore[best])
+          best = p;
+      }
+    }
+    if (next.size() > cacheSize)
+      next.resize(cacheSize);
+    cache.swap(next);
+  }
+  return result;
+}
+
+//____________________________________________________________________
+unsigned long MeshOptimizer::cacheMisses(const std::vector<std::vector<int> > & primitives, const std::vector<int> & order,
+                                         unsigned cacheSize)
+{
+  std::set<int> cached;
+  std::deque<int> fifo;
+  unsigned long misses = 0;
+  for (size_t p = 0; p < order.size(); ++p) {
+    const std::vector<int> & primitive = primitives[order[p]];
+    for (size_t i = 0; i < primitive.size(); ++i) {
+      if (cached.count(primitive[i]))
+        continue;
+      ++misses;
+      cached.insert(primitive[i]);
+      fifo.push_back(primitive[i]);
+      if (fifo.size() > cacheSize) {
+        cached.erase(fifo.front());
+        fifo.pop_front();
+      }
+    }
+  }
+  return misses;
+}
+
+//____________________________________________________________________
+void MeshOptimizer::apply(SoNode * root)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+
+  // Collect first: the shapes are not changed during the traversal
+  Collector collector;
+  SoCallbackAction collect;
+  collect.addPreCallback(SoIndexedFaceSet::getClassTypeId(), collectCB, &collector);
+  collect.addPreCallback(SoIndexedTriangleStripSet::getClassTypeId(), collectCB, &collector);
+  collect.apply(root);
+
+  for (size_t i = 0; i < collector.shapes.size(); ++i) {
+    const Candidate & candidate = collector.shapes[i];
+    candidate.shape->ref();
+    optimize(candidate.shape, candidate.materialBinding, candidate.normalBinding, candidate.stateTexCoords);
+    candidate.shape->unrefNoDelete();
+  }
+  m_stats.shapes = collector.shapes.size();
+  m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void MeshOptimizer::optimize(SoIndexedShape * shape, int materialBinding, int normalBinding, bool stateTexCoords)
+{
+  const bool strips = shape->isOfType(SoIndexedTriangleStripSet::getClassTypeId());
+
+  // The primitives, their range in coordIndex, and their faces (triangles
+  // of a strip, for PER_FACE_INDEXED)
+  const int32_t * index = shape->coordIndex.getValues(0);
+  const int numIndices = shape->coordIndex.getNum();
+  std::vector<std::vector<int> > primitives;
+  std::vector<int> begin, faceBegin;
+  int numVertices = 0, numFaces = 0;
+  for (int i = 0; i < numIndices;) {
+    std::vector<int> primitive;
+    const int b = i;
+    for (; i < numIndices && index[i] >= 0; ++i) {
+      primitive.push_back(index[i]);
+      numVertices = std::max(numVertices, index[i] + 1);
+    }
+    ++i; // the -1
+    if (primitive.empty())
+      continue;
+    begin.push_back(b);
+    faceBegin.push_back(numFaces);
+    numFaces += strips ? std::max(int(primitive.size()) - 2, 0) : 1;
+    primitives.push_back(primitive);
+  }
+  if (primitives.empty())
+    return;
+  const int coordEnd = begin.back() + primitives.back().size();
+
+  // Which index fields follow the primitives, and how
+  struct Field {
+    SoMFInt32 * field;
+    int binding;
+  };
+  const Field fields[3] = {
+    { &shape->materialIndex, materialBinding },
+    { &shape->normalIndex, normalBinding },
+    { &shape->textureCoordIndex, SoMaterialBinding::PER_VERTEX_INDEXED }
+  };
+  for (int f = 0; f < 3; ++f) {
+    const int n = fields[f].field->getNum();
+    switch (fields[f].binding) {
+    case SoMaterialBinding::OVERALL:
+      break;
+    case SoMaterialBinding::PER_VERTEX_INDEXED:
+      if (n && n < coordEnd) { // parallel to coordIndex, if not empty
+        ++m_stats.skipped;
+        return;
+      }
+      break;
+    case SoMaterialBinding::PER_FACE_INDEXED:
+    case SoMaterialBinding::PER_PART_INDEXED:
+      if (n < (fields[f].binding == SoMaterialBinding::PER_FACE_INDEXED ? numFaces : int(primitives.size()))) {
+        ++m_stats.skipped;
+        return;
+      }
+      break;
+    default: // values consumed in order
+      ++m_stats.skipped;
+      return;
+    }
+  }
+
+  const std::vector<int> order = MeshOptimizer::order(primitives, numVertices, m_cacheSize);
+  std::vector<int> identity(primitives.size());
+  for (size_t p = 0; p < identity.size(); ++p)
+    identity[p] = p;
+  for (size_t p = 0; p < primitives.size(); ++p)
+    m_stats.triangles += std::max(int(primitives[p].size()) - 2, 0);
+  m_stats.missesBefore += cacheMisses(primitives, identity, m_cacheSize);
+  m_stats.missesAfter += cacheMisses(primitives, order, m_cacheSize);
+  ++m_stats.optimized;
+
+  // The index fields, in the new order
+  for (int f = 0; f < 3; ++f) {
+    SoMFInt32 & field = *fields[f].field;
+    const int binding = fields[f].binding;
+    if (binding == SoMaterialBinding::OVERALL || !field.getNum())
+      continue;
+    const std::vector<int32_t> old(field.getValues(0), field.getValues(0) + field.getNum());
+    std::vector<int32_t> reordered;
+    for (size_t o = 0; o < order.size(); ++o) {
+      const int p = order[o];
+      if (binding == SoMaterialBinding::PER_VERTEX_INDEXED) {
+        if (o)
+          reordered.push_back(-1);
+        reordered.insert(reordered.end(), old.begin() + begin[p], old.begin() + begin[p] + primitives[p].size());
+      } else if (binding == SoMaterialBinding::PER_FACE_INDEXED) {
+        const int faces = strips ? std::max(int(primitives[p].size()) - 2, 0) : 1;
+        reordered.insert(reordered.end(), old.begin() + faceBegin[p], old.begin() + faceBegin[p] + faces);
+      } else {
+        reordered.push_back(old[p]);
+      }
+    }
+    field.setValues(0, reordered.size(), reordered.data());
+    field.setNum(reordered.size());
+  }
+
+  // Vertices in the order of their first use, if the shape owns them
+  std::vector<int> renumber(numVertices, -1);
+  SoVertexProperty * property = static_cast<SoVertexProperty*>(shape->vertexProperty.getValue());
+  bool ownsVertices = property && property->getRefCount() == 1 && property->vertex.getNum() >= numVertices;
+  if (ownsVertices) {
+    // Data indexed through coordIndex, but held by other nodes, would no
+    // longer match the vertices
+    const int count = property->vertex.getNum();
+    if (normalBinding == SoMaterialBinding::PER_VERTEX_INDEXED && !shape->normalIndex.getNum()
+        && property->normal.getNum() != count)
+      ownsVertices = false;
+    if (materialBinding == SoMaterialBinding::PER_VERTEX_INDEXED && !shape->materialIndex.getNum()
+        && property->orderedRGBA.getNum() != count)
+      ownsVertices = false;
+    if (!shape->textureCoordIndex.getNum() && property->texCoord.getNum() != count && stateTexCoords)
+      ownsVertices = false;
+  }
+  if (ownsVertices) {
+    int next = 0;
+    for (size_t o = 0; o < order.size(); ++o)
+      for (size_t i = 0; i < primitives[order[o]].size(); ++i)
+        if (renumber[primitives[order[o]][i]] < 0)
+          renumber[primitives[order[o]][i]] = next++;
+    for (int v = 0; v < numVertices; ++v)
+      if (renumber[v] < 0)
+        renumber[v] = next++;
+
+    // Whatever is laid out like the vertices moves with them
+    const int count = property->vertex.getNum();
+    auto permute = [&](SoMFVec3f & values) {
+      const std::vector<SbVec3f> old(values.getValues(0), values.getValues(0) + values.getNum());
+      SbVec3f * out = values.startEditing();
+      for (int v = 0; v < numVertices; ++v)
+        out[renumber[v]] = old[v];
+      values.finishEditing();
+    };
+    permute(property->vertex);
+    if (property->normal.getNum() == count && normalBinding == SoMaterialBinding::PER_VERTEX_INDEXED
+        && !shape->normalIndex.getNum())
+      permute(property->normal);
+    if (property->texCoord.getNum() == count && !shape->textureCoordIndex.getNum()) {
+      const std::vector<SbVec2f> old(property->texCoord.getValues(0), property->texCoord.getValues(0) + count);
+      SbVec2f * out = property->texCoord.startEditing();
+      for (int v = 0; v < numVertices; ++v)
+        out[renumber[v]] = old[v];
+      property->texCoord.finishEditing();
+    }
+    if (property->orderedRGBA.getNum() == count && materialBinding == SoMaterialBinding::PER_VERTEX_INDEXED
+        && !shape->materialIndex.getNum()) {
+      const std::vector<uint32_t> old(property->orderedRGBA.getValues(0), property->orderedRGBA.getValues(0) + count);
+      uint32_t * out = property->orderedRGBA.startEditing();
+      for (int v = 0; v < numVertices; ++v)
+        out[renumber[v]] = old[v];
+      property->orderedRGBA.finishEditing();
+    }
+    ++m_stats.renumbered;
+  }
+
+  std::vector<int32_t> coordIndex;
+  coordIndex.reserve(numIndices);
+  for (size_t o = 0; o < order.size(); ++o) {
+    if (o)
+      coordIndex.push_back(-1);
+    for (size_t i = 0; i < primitives[order[o]].size(); ++i) {
+      const int v = primitives[order[o]][i];
+      coordIndex.push_back(ownsVertices ? renumber[v] : v);
+    }
+  }
+  shape->coordIndex.setValues(0, coordIndex.size(), coordIndex.data());
+  shape->coordIndex.setNum(coordIndex.size());
+}
+
+//____________________________________________________________________
+void MeshOptimizer::printStats() const
+{
+  printf("mesh optimizer: %u indexed shapes, %u reordered (%u with their vertices), %u skipped for their bindings, "
+         "%u triangles, ACMR %.3f -> %.3f (FIFO cache of %u), %.2f ms\n",
+         m_stats.shapes, m_stats.optimized, m_stats.renumbered, m_stats.skipped, m_stats.triangles,
+         m_stats.acmrBefore(), m_stats.acmrAfter(), m_cacheSize, m_stats.time);
+  fflush(stdout);
+}
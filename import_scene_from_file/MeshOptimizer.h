@@ -0,0 +1,65 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+
+class SoIndexedShape;
+class SoNode;
+
+// Reorders the indexed shapes of a scene for the post-transform vertex
+// cache of the GPU.
+//
+// The faces of each SoIndexedFaceSet (or the strips of each
+// SoIndexedTriangleStripSet) are reordered with Forsyth's "linear-speed
+// vertex cache optimisation": the next face is the one whose vertices
+// score best, favouring vertices still in a simulated LRU cache and the
+// ones with few faces left. Polygons and strips are moved as a whole, so
+// quads stay quads and strips stay strips. Then, when the shape owns its
+// SoVertexProperty, the vertices are renumbered in the order of their
+// first use, for memory locality.
+//
+// Per-face data must follow the faces, so shapes bound with non-indexed
+// PER_FACE or PER_PART (normals or materials) are left alone; their
+// values are consumed in order and may be shared with other shapes.
+// Coordinates in an SoCoordinate3, or in a shared SoVertexProperty, are
+// not renumbered either: only the faces are reordered.
+//
+// The cache efficiency is reported as the ACMR (average cache miss
+// ratio: vertices transformed per triangle, from 0.5 at best to 3) of a
+// FIFO cache, before and after.
+class MeshOptimizer {
+public:
+  struct Stats {
+    unsigned shapes;      // indexed shapes found
+    unsigned optimized;   // faces reordered
+    unsigned renumbered;  // vertices renumbered as well
+    unsigned skipped;     // because of their bindings
+    unsigned triangles;
+    unsigned long missesBefore, missesAfter;
+    double time;          // ms
+    double acmrBefore() const { return triangles ? double(missesBefore) / triangles : 0.0; }
+    double acmrAfter() const { return triangles ? double(missesAfter) / triangles : 0.0; }
+  };
+
+  MeshOptimizer(unsigned cacheSize = 32);
+
+  // Optimizes each SoIndexedFaceSet and SoIndexedTriangleStripSet below root once
+  void apply(SoNode * root);
+
+  const Stats & stats() const { return m_stats; }
+  void printStats() const;
+
+  // The order in which to draw 'primitives' (lists of vertex indices)
+  static std::vector<int> order(const std::vector<std::vector<int> > & primitives, int numVertices, unsigned cacheSize);
+  // Misses of a FIFO cache of 'cacheSize' vertices, drawing the primitives in this order
+  static unsigned long cacheMisses(const std::vector<std::vector<int> > & primitives, const std::vector<int> & order,
+                                   unsigned cacheSize);
+
+private:
+  unsigned m_cacheSize;
+  Stats m_stats;
+
+  void optimize(SoIndexedShape * shape, int materialBinding, int normalBinding, bool stateTexCoords);
+};
+
+#endif
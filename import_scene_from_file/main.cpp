@@ -1,5 +1,3 @@
-#include <Inventor/Qt/SoQt.h>
-#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoTranslation.h>
@@ -11,14 +9,16 @@
 #include <Inventor/nodes/SoCylinder.h>
 #include <Inventor/nodes/SoSphere.h>
 #include <Inventor/nodes/SoCone.h>
-#include <QApplication>
-#include <QWidget>
+#include <Inventor/actions/SoWriteAction.h>
+#include "ExampleHarness.h"
+#include "MeshOptimizer.h"
 #include <random>
 #include <stdexcept>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <cmath>
+#include <cstring>
 
 
 SoSeparator *
@@ -41,37 +41,82 @@ readFile(const char *filename)
    return myGraph;
 }
 
+// Usage: import_scene_from_file [file.iv] [--optimize [cacheSize]] [--write out.iv]
+//                               [--headless] [--frames N] [--orbit]
+//
+// --optimize reorders the indexed face and strip sets of the scene for the
+// vertex cache (see MeshOptimizer) and prints the ACMR before and after;
+// with --write the scene is written out instead of shown, so that the
+// pass can be run on its own. The last options come from the
+// ExampleHarness.
 int main(int argc, char **argv)
 {
+  const char *filename = "data/test.iv";
+  const char *output = NULL;
+  bool optimize = false;
+  unsigned cacheSize = 32;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--optimize")) {
+      optimize = true;
+      // A size only if the whole argument is a number: '3d_detector.iv' is a file
+      if (i + 1 < argc && *argv[i + 1] && strspn(argv[i + 1], "0123456789") == strlen(argv[i + 1])
+          && atoi(argv[i + 1]) > 0)
+        cacheSize = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--write") && i + 1 < argc) {
+      output = argv[++i];
+    } else if (ExampleHarness::optionLength(argc, argv, i)) {
+      i += ExampleHarness::optionLength(argc, argv, i) - 1; // parsed by the harness
+    } else {
+      filename = argv[i];
+    }
+  }
 
-  // Initialize the Qt system:
-  QApplication app(argc, argv);
+  if (output) {
+    SoDB::init();
+    SoSeparator *scene = readFile(filename);
+    scene->ref();
+    if (optimize) {
+      MeshOptimizer optimizer(cacheSize);
+      optimizer.apply(scene);
+      optimizer.printStats();
+    }
+    SoOutput out;
+    if (!out.openFile(output)) {
+      fprintf(stderr, "Cannot write file %s\n", output);
+      return 1;
+    }
+    SoWriteAction write(&out);
+    write.apply(scene);
+    out.closeFile();
+    scene->unref();
+    return 0;
+  }
 
-  // Make a main window:
-  QWidget mainwin;
-  mainwin.resize(400,400);
-
-  // Initialize SoQt
-  SoQt::init(&mainwin);
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
 
   // The root of a scene graph
   SoSeparator *root = new SoSeparator;
   root->ref();
 
-  root->addChild(readFile("data/test.iv"));
-
-  // Initialize an examiner viewer:
-  SoQtExaminerViewer * eviewer = new SoQtExaminerViewer(&mainwin);
-  eviewer->setSceneGraph(root);
-  eviewer->show();
+  harness.phase("read file");
+  SoSeparator *scene = readFile(filename);
+  if (optimize) {
+    harness.phase("optimize");
+    scene->ref();
+    MeshOptimizer optimizer(cacheSize);
+    optimizer.apply(scene);
+    optimizer.printStats();
+    scene->unrefNoDelete();
+  }
+  root->addChild(scene);
 
-  // Pop up the main window.
-  SoQt::show(&mainwin);
-
-  // Loop until exit.
-  SoQt::mainLoop();
+  // Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
 
   // Clean up resources.
-  delete eviewer;
   root->unref();
+
+  return result;
 }
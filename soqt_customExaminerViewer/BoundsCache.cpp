@@ -0,0 +1,535 @@
+#include "BoundsCache.h"
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/nodekits/SoBaseKit.h>
+#include <Inventor/nodes/SoArray.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoCylinder.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoIndexedShape.h>
+#include <Inventor/nodes/SoLineSet.h>
+#include <Inventor/nodes/SoMultipleCopy.h>
+#include <Inventor/nodes/SoPointSet.h>
+#include <Inventor/nodes/SoQuadMesh.h>
+#include <Inventor/nodes/SoResetTransform.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoTransformSeparator.h>
+#include <Inventor/nodes/SoTransformation.h>
+#include <Inventor/nodes/SoTriangleStripSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+
+
+namespace {
+
+// Below this many vertices, threads cost more than they save
+const unsigned long parallelThreshold = 20000;
+// Vertices per task: large arrays are shared out too
+const int pieceSize = 65536;
+
+class RangeTask : public QRunnable {
+public:
+	RangeTask(const std::function<void(size_t, size_t)> & function, size_t begin, size_t end)
+	: m_function(function), m_begin(begin), m_end(end) {}
+	void run() { m_function(m_begin, m_end); }
+private:
+	std::function<void(size_t, size_t)> m_function;
+	size_t m_begin, m_end;
+};
+
+// Vertices used by a non-indexed shape from its startIndex, -1 if all
+int usedVertices(const SoNode * shape)
+{
+	const SoMFInt32 * counts = 0;
+	if (shape->isOfType(SoFaceSet::getClassTypeId()))
+		counts = &static_cast<const SoFaceSet*>(shape)->numVertices;
+	else if (shape->isOfType(SoTriangleStripSet::getClassTypeId()))
+		counts = &static_cast<const SoTriangleStripSet*>(shape)->numVertices;
+	else if (shape->isOfType(SoLineSet::getClassTypeId()))
+		counts = &static_cast<const SoLineSet*>(shape)->numVertices;
+	else if (shape->isOfType(SoPointSet::getClassTypeId()))
+		return static_cast<const SoPointSet*>(shape)->numPoints.getValue();
+	else if (shape->isOfType(SoQuadMesh::getClassTypeId()))
+		return static_cast<const SoQuadMesh*>(shape)->verticesPerColumn.getValue()
+		     * static_cast<const SoQuadMesh*>(shape)->verticesPerRow.getValue();
+	if (!counts)
+		return -1;
+	int used = 0;
+	for (int i = 0; i < counts->getNum(); ++i) {
+		if ((*counts)[i] < 0)
+			return -1; // SO_FACE_SET_USE_REST_OF_VERTICES and the like
+		used += (*counts)[i];
+	}
+	return used;
+}
+
+// Box of a piece of a vertex array
+SbBox3f boundPoints(const SbVec3f * points, int numPoints, const int32_t * indices, int begin, int end)
+{
+	float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+	for (int i = begin; i < end; ++i) {
+		const int index = indices ? indices[i] : i;
+		if (index < 0 || index >= numPoints)
+			continue; // end of a face, or out of range
+		const float * p = points[index].getValue();
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = std::min(lo[k], p[k]);
+			hi[k] = std::max(hi[k], p[k]);
+		}
+	}
+	SbBox3f box;
+	if (lo[0] <= hi[0])
+		box.setBounds(lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]);
+	return box;
+}
+
+void extendBy(SbBox3f & box, SbBox3f other, const SbMatrix & matrix)
+{
+	if (other.isEmpty())
+		return;
+	other.transform(matrix);
+	box.extendBy(other);
+}
+
+}
+
+
+//____________________________________________________________________
+BoundsCache::BoundsCache()
+: m_root(0),
+  m_sensor(0),
+  m_dirty(true),
+  m_boxValid(false),
+  m_resetFound(false),
+  m_matrixAction(SbViewportRegion()),
+  m_boxAction(SbViewportRegion()),
+  m_lastReused(0),
+  m_lastWalked(0),
+  m_lastPoints(0),
+  m_lastTime(0.0)
+{
+	m_sensor = new SoNodeSensor(sceneChangedCB, this);
+	m_sensor->setPriority(0); // immediate, so that the trigger node is known in the callback
+}
+
+//____________________________________________________________________
+BoundsCache::~BoundsCache()
+{
+	m_sensor->detach();
+	delete m_sensor;
+	clear();
+}
+
+//____________________________________________________________________
+void BoundsCache::setSceneGraph(SoNode * root)
+{
+	m_sensor->detach();
+	m_root = root;
+	if (root)
+		m_sensor->attach(root);
+	clear(); // and no reference to the old scene kept
+	invalidate();
+}
+
+//____________________________________________________________________
+void BoundsCache::invalidate()
+{
+	m_dirty = true;
+	m_boxValid = false;
+}
+
+//____________________________________________________________________
+void BoundsCache::clear()
+{
+	for (std::unordered_map<const SoNode*, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		it->first->unref();
+	m_entries.clear();
+	m_owners.clear();
+	m_top = Entry();
+	m_dirty = false;
+}
+
+//____________________________________________________________________
+SbBox3f BoundsCache::boundingBox()
+{
+	if (!m_root)
+		return SbBox3f();
+	if (m_boxValid && !m_dirty)
+		return m_box;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (m_dirty)
+		clear();
+	m_lastReused = m_lastWalked = 0;
+	m_lastPoints = 0;
+	m_reached.clear();
+	m_resetFound = false;
+
+	// The top frame: what is not below any separator
+	release(0, m_top);
+	Frame top = { 0, &m_top, SbBox3f(), {}, {}, false };
+	m_frames.assign(1, top);
+	m_stack.assign(1, 0);
+	State state;
+	state.matrix = SbMatrix::identity();
+	state.coords = 0;
+	state.numCoords = 0;
+	state.coordsLevel = 0;
+	visit(m_root, state);
+	boundJobs();
+	combine();
+	prune();
+
+	m_box = m_frames[0].box;
+	if (m_resetFound) {
+		// A SoResetTransform below a separator: back to world coordinates,
+		// which the walk does not know there
+		m_boxAction.apply(m_root);
+		m_box = m_boxAction.getBoundingBox();
+	}
+	m_boxValid = true;
+	m_frames.clear();
+	m_jobs.clear();
+	m_lastTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return m_box;
+}
+
+//____________________________________________________________________
+void BoundsCache::own(const SoNode * node)
+{
+	// Walked for the innermost separator being walked
+	const Frame & frame = m_frames[m_stack.back()];
+	m_owners.insert(std::make_pair(node, frame.separator));
+	frame.entry->members.push_back(node);
+}
+
+//____________________________________________________________________
+void BoundsCache::release(const SoNode * separator, Entry & entry)
+{
+	// Before walking it again: its nodes will say again what they are in
+	for (size_t i = 0; i < entry.members.size(); ++i) {
+		typedef std::unordered_multimap<const SoNode*, const SoNode*>::iterator Iterator;
+		std::pair<Iterator, Iterator> range = m_owners.equal_range(entry.members[i]);
+		for (Iterator it = range.first; it != range.second; ++it) {
+			if (it->second == separator) {
+				m_owners.erase(it);
+				break;
+			}
+		}
+	}
+	entry.members.clear();
+}
+
+//____________________________________________________________________
+void BoundsCache::visit(SoNode * node, State & state)
+{
+	own(node);
+
+	if (node->isOfType(SoSeparator::getClassTypeId())) {
+		visitSeparator(node, state);
+	} else if (node->isOfType(SoSwitch::getClassTypeId())) {
+		const int which = static_cast<SoSwitch*>(node)->whichChild.getValue();
+		SoChildList * children = node->getChildren();
+		if (which >= 0 && which < children->getLength())
+			visit((*children)[which], state);
+		else if (which == SO_SWITCH_ALL || which == SO_SWITCH_INHERIT) // inherited: all, to be safe
+			for (int i = 0; i < children->getLength(); ++i)
+				visit((*children)[i], state);
+	} else if (node->isOfType(SoTransformSeparator::getClassTypeId())) {
+		const SbMatrix matrix = state.matrix;
+		SoChildList * children = node->getChildren();
+		for (int i = 0; i < children->getLength(); ++i)
+			visit((*children)[i], state);
+		state.matrix = matrix;
+	} else if (node->isOfType(SoGroup::getClassTypeId()) && !node->isOfType(SoArray::getClassTypeId())
+	           && !node->isOfType(SoMultipleCopy::getClassTypeId())) {
+		// Its state goes on to the nodes after it
+		SoChildList * children = node->getChildren();
+		for (int i = 0; i < children->getLength(); ++i)
+			visit((*children)[i], state);
+	} else if (node->isOfType(SoTransformation::getClassTypeId())) {
+		if (node->isOfType(SoResetTransform::getClassTypeId())) {
+			if (static_cast<SoResetTransform*>(node)->whatToReset.getValue() & SoResetTransform::TRANSFORM) {
+				state.matrix = SbMatrix::identity();
+				// Right at the top only: below a separator the boxes above
+				// it depend on where it is, and the whole box is bounded
+				// with a SoGetBoundingBoxAction
+				if (m_stack.size() > 1) {
+					m_resetFound = true;
+					for (size_t level = 1; level < m_stack.size(); ++level)
+						m_frames[m_stack[level]].contextual = true;
+				}
+			}
+		} else {
+			m_matrixAction.apply(node);
+			state.matrix = m_matrixAction.getMatrix() * state.matrix;
+		}
+	} else if (node->isOfType(SoCoordinate3::getClassTypeId())) {
+		const SoMFVec3f & point = static_cast<SoCoordinate3*>(node)->point;
+		state.coords = point.getValues(0);
+		state.numCoords = point.getNum();
+		state.coordsLevel = m_stack.size() - 1;
+	} else if (node->isOfType(SoVertexProperty::getClassTypeId())) {
+		const SoMFVec3f & vertex = static_cast<SoVertexProperty*>(node)->vertex;
+		if (vertex.getNum() > 0) {
+			state.coords = vertex.getValues(0);
+			state.numCoords = vertex.getNum();
+			state.coordsLevel = m_stack.size() - 1;
+		}
+	} else if (node->isOfType(SoShape::getClassTypeId()) || node->getChildren()) {
+		// Shapes, and node kits, arrays and other containers as a whole
+		visitShape(node, state);
+	}
+}
+
+//____________________________________________________________________
+void BoundsCache::visitSeparator(SoNode * separator, const State & state)
+{
+	m_reached.push_back(separator);
+	std::unordered_map<const SoNode*, Entry>::iterator it = m_entries.find(separator);
+	if (it == m_entries.end()) {
+		// Kept alive while cached: a new node at the same address must not
+		// find its box
+		separator->ref();
+		it = m_entries.insert(std::make_pair(separator, Entry())).first;
+		it->second.valid = false;
+	}
+	if (it->second.valid) {
+		++m_lastReused;
+		extendBy(m_frames[m_stack.back()].box, it->second.box, state.matrix);
+		return;
+	}
+	++m_lastWalked;
+
+	Entry & entry = it->second; // stays in place as the map grows
+	release(separator, entry);
+	entry.valid = false;
+	const size_t index = m_frames.size();
+	Frame frame = { separator, &entry, SbBox3f(), {}, {}, false };
+	m_frames.push_back(frame);
+	m_frames[m_stack.back()].children.push_back(std::make_pair(state.matrix, index));
+
+	// In its own coordinates, with the coordinates from above it
+	m_stack.push_back(index);
+	State inside = state;
+	inside.matrix = SbMatrix::identity();
+	SoChildList * children = separator->getChildren();
+	for (int i = 0; i < children->getLength(); ++i)
+		visit((*children)[i], inside);
+	m_stack.pop_back();
+}
+
+//____________________________________________________________________
+void BoundsCache::visitShape(SoNode * shape, State & state)
+{
+	Frame & frame = m_frames[m_stack.back()];
+	SbBox3f box;
+
+	if (shape->isOfType(SoVertexShape::getClassTypeId())) {
+		// Only the vertex array for now, bounded with the others in parallel
+		const SoVertexProperty * vertexProperty =
+			static_cast<const SoVertexProperty*>(static_cast<SoVertexShape*>(shape)->vertexProperty.getValue());
+		Job job = { 0, 0, 0, 0, 0, SbBox3f() };
+		if (vertexProperty && vertexProperty->vertex.getNum() > 0) {
+			own(vertexProperty);
+			job.points = vertexProperty->vertex.getValues(0);
+			job.numPoints = vertexProperty->vertex.getNum();
+		} else {
+			job.points = state.coords;
+			job.numPoints = state.numCoords;
+			// The separators between the coordinates and here depend on them
+			for (size_t level = state.coordsLevel + 1; level < m_stack.size(); ++level)
+				m_frames[m_stack[level]].contextual = true;
+		}
+		if (!job.points || job.numPoints <= 0)
+			return;
+		if (shape->isOfType(SoIndexedShape::getClassTypeId())) {
+			const SoMFInt32 & coordIndex = static_cast<SoIndexedShape*>(shape)->coordIndex;
+			job.indices = coordIndex.getValues(0);
+			job.end = coordIndex.getNum();
+		} else if (shape->isOfType(SoNonIndexedShape::getClassTypeId())) {
+			const int startIndex = static_cast<SoNonIndexedShape*>(shape)->startIndex.getValue();
+			const int used = usedVertices(shape);
+			job.begin = std::min(std::max(startIndex, 0), job.numPoints);
+			job.end = used < 0 ? job.numPoints : std::min(job.numPoints, job.begin + used);
+		} else {
+			job.end = job.numPoints;
+		}
+		m_jobs.push_back(job);
+		frame.jobs.push_back(std::make_pair(state.matrix, m_jobs.size() - 1));
+		return;
+	}
+
+	if (shape->isOfType(SoCube::getClassTypeId())) {
+		const SoCube * cube = static_cast<SoCube*>(shape);
+		const SbVec3f half(cube->width.getValue() / 2, cube->height.getValue() / 2, cube->depth.getValue() / 2);
+		box.setBounds(-half, half);
+	} else if (shape->isOfType(SoSphere::getClassTypeId())) {
+		const float r = static_cast<SoSphere*>(shape)->radius.getValue();
+		box.setBounds(-r, -r, -r, r, r, r);
+	} else if (shape->isOfType(SoCone::getClassTypeId())) {
+		const SoCone * cone = static_cast<SoCone*>(shape);
+		const float r = cone->bottomRadius.getValue(), h = cone->height.getValue() / 2;
+		box.setBounds(-r, -h, -r, r, h, r);
+	} else if (shape->isOfType(SoCylinder::getClassTypeId())) {
+		const SoCylinder * cylinder = static_cast<SoCylinder*>(shape);
+		const float r = cylinder->radius.getValue(), h = cylinder->height.getValue() / 2;
+		box.setBounds(-r, -h, -r, r, h, r);
+	} else {
+		m_boxAction.apply(shape);
+		box = m_boxAction.getBoundingBox();
+	}
+	extendBy(frame.box, box, state.matrix);
+}
+
+//____________________________________________________________________
+void BoundsCache::boundJobs()
+{
+	// Large arrays in several pieces, so that the cores share the work evenly
+	struct Piece {
+		size_t job;
+		int begin, end;
+		SbBox3f box;
+	};
+	std::vector<Piece> pieces;
+	for (size_t j = 0; j < m_jobs.size(); ++j) {
+		m_lastPoints += m_jobs[j].end - m_jobs[j].begin;
+		for (int begin = m_jobs[j].begin; begin < m_jobs[j].end; begin += pieceSize) {
+			Piece piece = { j, begin, std::min(begin + pieceSize, m_jobs[j].end), SbBox3f() };
+			pieces.push_back(piece);
+		}
+	}
+
+	const std::function<void(size_t, size_t)> bound = [this, &pieces](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			const Job & job = m_jobs[pieces[i].job];
+			pieces[i].box = boundPoints(job.points, job.numPoints, job.indices, pieces[i].begin, pieces[i].end);
+		}
+	};
+	const int numThreads = QThread::idealThreadCount();
+	if (m_lastPoints < parallelThreshold || numThreads < 2 || pieces.size() < 2) {
+		bound(0, pieces.size());
+	} else {
+		// Several tasks per thread, since the pieces are not all the same size
+		QThreadPool pool;
+		pool.setMaxThreadCount(numThreads);
+		const size_t chunk = std::max<size_t>(1, pieces.size() / (4 * numThreads));
+		for (size_t begin = 0; begin < pieces.size(); begin += chunk)
+			pool.start(new RangeTask(bound, begin, std::min(begin + chunk, pieces.size())));
+		pool.waitForDone();
+	}
+
+	for (size_t i = 0; i < pieces.size(); ++i)
+		if (!pieces[i].box.isEmpty())
+			m_jobs[pieces[i].job].box.extendBy(pieces[i].box);
+}
+
+//____________________________________________________________________
+void BoundsCache::combine()
+{
+	// Frames come after their parent: children first from the end
+	for (size_t f = m_frames.size(); f-- > 0; ) {
+		Frame & frame = m_frames[f];
+		for (size_t j = 0; j < frame.jobs.size(); ++j)
+			extendBy(frame.box, m_jobs[frame.jobs[j].second].box, frame.jobs[j].first);
+		for (size_t c = 0; c < frame.children.size(); ++c)
+			extendBy(frame.box, m_frames[frame.children[c].second].box, frame.children[c].first);
+		if (frame.separator) {
+			frame.entry->box = frame.box;
+			frame.entry->valid = !frame.contextual; // walked again next time, but its nodes are known
+		}
+	}
+}
+
+//____________________________________________________________________
+void BoundsCache::prune()
+{
+	// The separators reached by this walk, and those below the ones reused
+	std::unordered_set<const SoNode*> reached(m_reached.begin(), m_reached.end());
+	std::vector<const SoNode*> queue(m_reached);
+	while (!queue.empty()) {
+		std::unordered_map<const SoNode*, Entry>::const_iterator it = m_entries.find(queue.back());
+		queue.pop_back();
+		if (it == m_entries.end())
+			continue;
+		for (size_t i = 0; i < it->second.members.size(); ++i) {
+			const SoNode * member = it->second.members[i];
+			if (m_entries.count(member) && reached.insert(member).second)
+				queue.push_back(member);
+		}
+	}
+
+	// The others are no longer in the scene
+	for (std::unordered_map<const SoNode*, Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ) {
+		if (reached.count(it->first)) {
+			++it;
+			continue;
+		}
+		release(it->first, it->second);
+		it->first->unref();
+		it = m_entries.erase(it);
+	}
+}
+
+//____________________________________________________________________
+void BoundsCache::invalidate(const SoNode * node)
+{
+	// The separators the node was walked for, and the ones above them
+	m_boxValid = false;
+	bool known = false;
+	std::unordered_set<const SoNode*> seen;
+	std::vector<const SoNode*> queue(1, node);
+	std::unordered_map<const SoNode*, Entry>::iterator self = m_entries.find(node);
+	if (self != m_entries.end()) {
+		self->second.valid = false;
+		known = true;
+	}
+	while (!queue.empty()) {
+		const SoNode * current = queue.back();
+		queue.pop_back();
+		typedef std::unordered_multimap<const SoNode*, const SoNode*>::const_iterator Iterator;
+		std::pair<Iterator, Iterator> range = m_owners.equal_range(current);
+		for (Iterator it = range.first; it != range.second; ++it) {
+			known = true;
+			if (!it->second || !seen.insert(it->second).second)
+				continue; // the top, walked each time anyway
+			std::unordered_map<const SoNode*, Entry>::iterator owner = m_entries.find(it->second);
+			if (owner != m_entries.end())
+				owner->second.valid = false;
+			queue.push_back(it->second);
+		}
+	}
+	// Not walked (e.g. a node kit part): we do not know where it is
+	if (!known)
+		m_dirty = true;
+}
+
+//____________________________________________________________________
+void BoundsCache::sceneChangedCB(void * userdata, SoSensor * sensor)
+{
+	BoundsCache * self = static_cast<BoundsCache*>(userdata);
+	if (self->m_dirty)
+		return;
+	SoNode * trigger = static_cast<SoNodeSensor*>(sensor)->getTriggerNode();
+	if (trigger && trigger->isOfType(SoCamera::getClassTypeId()))
+		return;
+	if (trigger)
+		self->invalidate(trigger);
+	else
+		self->invalidate();
+}
@@ -0,0 +1,127 @@
+#ifndef BOUNDSCACHE_H
+#define BOUNDSCACHE_H
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGetMatrixAction.h>
+
+#include <unordered_map>
+#include <vector>
+
+class SoNode;
+class SoSensor;
+class SoNodeSensor;
+
+// Bounding box of a scene, kept up to date without a SoGetBoundingBoxAction
+// over the whole graph each time.
+//
+// The box of each separator, in the coordinates it is traversed in, is
+// cached. A node sensor on the scene invalidates the separators above the
+// node that changed, and only those: the next query walks down to them,
+// reusing the boxes of all the others. Camera changes are ignored.
+//
+// The walk itself follows transformations, coordinates and groups
+// (switches honouring whichChild) and, for the vertex shapes, only
+// collects their raw vertex arrays; the boxes of these arrays are then
+// computed on all the cores at once. Cubes, spheres, cones and cylinders
+// are bounded from their fields; any other shape, and node kits, with a
+// SoGetBoundingBoxAction of their own (so, without the font or complexity
+// set above them). Non-indexed shapes are bounded by all the coordinates
+// from their startIndex on, when numVertices does not tell how many they
+// use.
+//
+// A separator whose shapes use coordinates from above it is walked again
+// each time, its box depends on where it is. So is a separator holding a
+// SoResetTransform, and then the box of the whole scene is computed with
+// a SoGetBoundingBoxAction.
+//
+// The cached separators are referenced, and the ones a walk finds no
+// longer in the scene are dropped.
+class BoundsCache {
+public:
+	BoundsCache();
+	~BoundsCache();
+
+	void setSceneGraph(SoNode * root);
+	void invalidate();
+
+	// Bounding box of the whole scene, in world coordinates (those of its root)
+	SbBox3f boundingBox();
+
+	unsigned numCached() const { return m_entries.size(); }
+	unsigned lastReused() const { return m_lastReused; }  // separators not walked again by the last query
+	unsigned lastWalked() const { return m_lastWalked; }  // and walked
+	unsigned long lastPoints() const { return m_lastPoints; } // vertices bounded
+	double lastTime() const { return m_lastTime; } // ms
+
+private:
+	struct Entry {
+		SbBox3f box;
+		bool valid;
+		std::vector<const SoNode*> members; // nodes walked for this box
+	};
+
+	// Vertex array of a shape, bounded in parallel
+	struct Job {
+		const SbVec3f * points;
+		int numPoints;
+		const int32_t * indices; // or all the points from 'begin'
+		int begin, end;          // in indices, or in points
+		SbBox3f box;
+	};
+
+	// What the walk has found for a separator whose box is not cached
+	struct Frame {
+		const SoNode * separator; // none for the top
+		Entry * entry;
+		SbBox3f box; // of the shapes bounded right away
+		std::vector<std::pair<SbMatrix, size_t> > jobs;
+		std::vector<std::pair<SbMatrix, size_t> > children; // frames
+		bool contextual; // uses coordinates from above it
+	};
+
+	// Traversal state, as far as the bounds are concerned
+	struct State {
+		SbMatrix matrix; // to the coordinates of the current frame
+		const SbVec3f * coords;
+		int numCoords;
+		size_t coordsLevel; // level of the frame which set them
+	};
+
+	SoNode * m_root;
+	SoNodeSensor * m_sensor;
+	bool m_dirty; // everything
+	bool m_boxValid;
+	std::unordered_map<const SoNode*, Entry> m_entries; // referenced
+	std::unordered_multimap<const SoNode*, const SoNode*> m_owners; // node -> separators it was walked for
+	Entry m_top; // the nodes which are not below a separator
+	SbBox3f m_box;
+
+	std::vector<Frame> m_frames;
+	std::vector<size_t> m_stack; // frames being walked
+	std::vector<Job> m_jobs;
+	std::vector<const SoNode*> m_reached; // separators walked or reused
+	bool m_resetFound;
+	SoGetMatrixAction m_matrixAction;
+	SoGetBoundingBoxAction m_boxAction;
+
+	unsigned m_lastReused, m_lastWalked;
+	unsigned long m_lastPoints;
+	double m_lastTime;
+
+	void clear();
+	void invalidate(const SoNode * node);
+	void visit(SoNode * node, State & state);
+	void visitSeparator(SoNode * separator, const State & state);
+	void visitShape(SoNode * shape, State & state);
+	void own(const SoNode * node);
+	void release(const SoNode * separator, Entry & entry);
+	void boundJobs();
+	void combine();
+	void prune();
+
+	static void sceneChangedCB(void * userdata, SoSensor * sensor);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "Bvh.h"
+
+
+//____________________________________________________________________
+void Bvh::build(const std::vector<Box> & boxes, unsigned leafSize)
+{
+	clear();
+	if (boxes.empty())
+		return;
+
+	m_prims.resize(boxes.size());
+	for (unsigned i = 0; i < m_prims.size(); ++i)
+		m_prims[i] = i;
+
+	// A binary tree with leaves of at least leafSize/2 primitives has
+	// fewer than 2*N/(leafSize/2) nodes
+	m_nodes.reserve(2 * boxes.size() / std::max(1u, leafSize / 2) + 1);
+	Node root;
+	root.first = 0;
+	root.count = boxes.size();
+	m_nodes.push_back(root);
+	split(0, boxes, std::max(1u, leafSize), 0);
+}
+
+//____________________________________________________________________
+void Bvh::split(unsigned nodeIndex, const std::vector<Box> & boxes, unsigned leafSize, unsigned depth)
+{
+	const unsigned first = m_nodes[nodeIndex].first;
+	const unsigned count = m_nodes[nodeIndex].count;
+
+	Box box, centroids;
+	for (unsigned i = first; i < first + count; ++i) {
+		const Box & b = boxes[m_prims[i]];
+		box.extendBy(b);
+		const float c[3] = { b.center(0), b.center(1), b.center(2) };
+		centroids.extendBy(c);
+	}
+	m_nodes[nodeIndex].box = box;
+
+	// Keep the traversal stack (64 entries) safe, whatever the input
+	if (count <= leafSize || depth >= 48)
+		return;
+
+	int axis = 0;
+	float extent = centroids.max[0] - centroids.min[0];
+	for (int i = 1; i < 3; ++i) {
+		if (centroids.max[i] - centroids.min[i] > extent) {
+			extent = centroids.max[i] - centroids.min[i];
+			axis = i;
+		}
+	}
+	if (extent <= 0.0f)
+		return; // all centroids in one point, no way to split
+
+	const unsigned half = count / 2;
+	std::vector<unsigned>::iterator begin = m_prims.begin() + first;
+	std::nth_element(begin, begin + half, begin + count,
+	                 [&boxes, axis](unsigned a, unsigned b) { return boxes[a].center(axis) < boxes[b].center(axis); });
+
+	const unsigned left = m_nodes.size();
+	Node child;
+	child.first = first;
+	child.count = half;
+	m_nodes.push_back(child);
+	child.first = first + half;
+	child.count = count - half;
+	m_nodes.push_back(child);
+
+	m_nodes[nodeIndex].first = left;
+	m_nodes[nodeIndex].count = 0;
+
+	split(left, boxes, leafSize, depth + 1);
+	split(left + 1, boxes, leafSize, depth + 1);
+}
@@ -0,0 +1,126 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+// A small bounding volume hierarchy over axis-aligned boxes, used to
+// accelerate ray queries (see PickAccelerator). It does not know what
+// the boxes contain: the caller gives a functor which intersects the
+// primitive with a given index.
+//
+// The tree is built once by median split along the longest axis of the
+// primitive centroids, and stored flat in a vector.
+class Bvh {
+public:
+	struct Box {
+		float min[3];
+		float max[3];
+
+		Box() { makeEmpty(); }
+		void makeEmpty()
+		{
+			min[0] = min[1] = min[2] = FLT_MAX;
+			max[0] = max[1] = max[2] = -FLT_MAX;
+		}
+		void extendBy(const float p[3])
+		{
+			for (int i = 0; i < 3; ++i) {
+				min[i] = std::min(min[i], p[i]);
+				max[i] = std::max(max[i], p[i]);
+			}
+		}
+		void extendBy(const Box & b)
+		{
+			extendBy(b.min);
+			extendBy(b.max);
+		}
+		bool isEmpty() const { return min[0] > max[0]; }
+		float center(int axis) const { return 0.5f * (min[axis] + max[axis]); }
+
+		// Slab test; on a hit, tnear is where the ray enters the box
+		bool intersect(const float orig[3], const float invDir[3], float tmax, float & tnear) const
+		{
+			float t0 = 0.0f, t1 = tmax;
+			for (int i = 0; i < 3; ++i) {
+				float ta = (min[i] - orig[i]) * invDir[i];
+				float tb = (max[i] - orig[i]) * invDir[i];
+				if (ta > tb)
+					std::swap(ta, tb);
+				t0 = std::max(t0, ta);
+				t1 = std::min(t1, tb);
+				if (t0 > t1)
+					return false;
+			}
+			tnear = t0;
+			return true;
+		}
+	};
+
+	Bvh() {}
+
+	void build(const std::vector<Box> & boxes, unsigned leafSize = 4);
+	void clear() { m_nodes.clear(); m_prims.clear(); }
+	bool isEmpty() const { return m_nodes.empty(); }
+	const Box & bounds() const { return m_nodes.front().box; }
+	size_t memoryUsage() const { return m_nodes.size() * sizeof(Node) + m_prims.size() * sizeof(unsigned); }
+
+	// Finds the closest hit along the ray, from 0 to tmax.
+	// 'test' is called as test(primitiveIndex, tmax) and must return true,
+	// and lower tmax, if the primitive is hit before the current tmax.
+	template <class Test>
+	bool closestHit(const float orig[3], const float dir[3], float & tmax, Test & test) const
+	{
+		if (m_nodes.empty())
+			return false;
+		float invDir[3];
+		for (int i = 0; i < 3; ++i)
+			invDir[i] = dir[i] != 0.0f ? 1.0f / dir[i] : FLT_MAX;
+
+		bool hit = false;
+		unsigned stack[64];
+		int top = 0;
+		float tnear;
+		if (!m_nodes[0].box.intersect(orig, invDir, tmax, tnear))
+			return false;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node & node = m_nodes[stack[--top]];
+			if (!node.box.intersect(orig, invDir, tmax, tnear))
+				continue; // tmax went down since the node was pushed
+			if (node.count) {
+				for (unsigned i = node.first; i < node.first + node.count; ++i)
+					if (test(m_prims[i], tmax))
+						hit = true;
+				continue;
+			}
+			// Visit the closer child first
+			float tl, tr;
+			const bool hl = m_nodes[node.first].box.intersect(orig, invDir, tmax, tl);
+			const bool hr = m_nodes[node.first + 1].box.intersect(orig, invDir, tmax, tr);
+			if (hl && hr) {
+				stack[top++] = tl < tr ? node.first + 1 : node.first;
+				stack[top++] = tl < tr ? node.first : node.first + 1;
+			} else if (hl) {
+				stack[top++] = node.first;
+			} else if (hr) {
+				stack[top++] = node.first + 1;
+			}
+		}
+		return hit;
+	}
+
+private:
+	struct Node {
+		Box box;
+		unsigned first; // leaf: first primitive in m_prims; inner node: left child (right is first+1)
+		unsigned count; // number of primitives, 0 for inner nodes
+	};
+	std::vector<Node> m_nodes;
+	std::vector<unsigned> m_prims;
+
+	void split(unsigned nodeIndex, const std::vector<Box> & boxes, unsigned leafSize, unsigned depth);
+};
+
+#endif
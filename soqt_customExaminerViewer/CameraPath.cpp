@@ -0,0 +1,181 @@
+#include "CameraPath.h"
+
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+//____________________________________________________________________
+CameraPath::CameraPath()
+: m_recording(false)
+{
+}
+
+//____________________________________________________________________
+void CameraPath::startRecording()
+{
+	m_keys.clear();
+	m_startTime = SbTime::getTimeOfDay();
+	m_recording = true;
+}
+
+//____________________________________________________________________
+void CameraPath::stopRecording()
+{
+	m_recording = false;
+}
+
+//____________________________________________________________________
+CameraPath::Keyframe CameraPath::keyframeFromCamera(const SoCamera * camera)
+{
+	Keyframe key;
+	key.time = 0.0;
+	key.position = camera->position.getValue();
+	key.orientation = camera->orientation.getValue();
+	key.focalDistance = camera->focalDistance.getValue();
+	key.orthographic = camera->isOfType(SoOrthographicCamera::getClassTypeId());
+	if (key.orthographic)
+		key.height = static_cast<const SoOrthographicCamera*>(camera)->height.getValue();
+	else if (camera->isOfType(SoPerspectiveCamera::getClassTypeId()))
+		key.height = static_cast<const SoPerspectiveCamera*>(camera)->heightAngle.getValue();
+	else
+		key.height = 0.785398f; // 45 degrees, the SoPerspectiveCamera default
+	return key;
+}
+
+//____________________________________________________________________
+void CameraPath::record(const SoCamera * camera)
+{
+	if (!m_recording || !camera)
+		return;
+
+	Keyframe key = keyframeFromCamera(camera);
+	key.time = (SbTime::getTimeOfDay() - m_startTime).getValue();
+
+	if (!m_keys.empty()) {
+		const Keyframe & last = m_keys.back();
+		if (last.position == key.position && last.orientation == key.orientation
+		    && last.focalDistance == key.focalDistance && last.height == key.height)
+			return; // the camera did not move
+		// Keep the idle time before this move: hold the previous state until now
+		if (key.time - last.time > 0.1) {
+			Keyframe hold = last;
+			hold.time = key.time - 0.05;
+			m_keys.push_back(hold);
+		}
+	}
+	m_keys.push_back(key);
+}
+
+//____________________________________________________________________
+CameraPath::Keyframe CameraPath::stateAt(double t) const
+{
+	if (m_keys.empty())
+		return Keyframe();
+	if (t <= m_keys.front().time)
+		return m_keys.front();
+	if (t >= m_keys.back().time)
+		return m_keys.back();
+
+	// Keyframes are sorted by time
+	unsigned hi = 1;
+	while (m_keys[hi].time < t)
+		++hi;
+	const Keyframe & a = m_keys[hi - 1];
+	const Keyframe & b = m_keys[hi];
+	const double span = b.time - a.time;
+	const float f = span > 0.0 ? static_cast<float>((t - a.time) / span) : 1.0f;
+
+	Keyframe key;
+	key.time = t;
+	key.position = a.position + (b.position - a.position) * f;
+	key.orientation = SbRotation::slerp(a.orientation, b.orientation, f);
+	key.focalDistance = a.focalDistance + (b.focalDistance - a.focalDistance) * f;
+	key.height = a.height + (b.height - a.height) * f;
+	key.orthographic = a.orthographic;
+	return key;
+}
+
+//____________________________________________________________________
+double CameraPath::stepTime(unsigned i, unsigned numSteps) const
+{
+	if (numSteps < 2)
+		return 0.0;
+	return duration() * static_cast<double>(i) / static_cast<double>(numSteps - 1);
+}
+
+//____________________________________________________________________
+void CameraPath::applyTo(const Keyframe & key, SoCamera * camera)
+{
+	camera->position = key.position;
+	camera->orientation = key.orientation;
+	camera->focalDistance = key.focalDistance;
+	if (camera->isOfType(SoOrthographicCamera::getClassTypeId()))
+		static_cast<SoOrthographicCamera*>(camera)->height = key.height;
+	else if (camera->isOfType(SoPerspectiveCamera::getClassTypeId()))
+		static_cast<SoPerspectiveCamera*>(camera)->heightAngle = key.height;
+}
+
+//____________________________________________________________________
+SoCamera * CameraPath::createCamera() const
+{
+	SoCamera * camera;
+	if (!m_keys.empty() && m_keys.front().orthographic)
+		camera = new SoOrthographicCamera;
+	else
+		camera = new SoPerspectiveCamera;
+	if (!m_keys.empty())
+		applyTo(m_keys.front(), camera);
+	return camera;
+}
+
+//____________________________________________________________________
+bool CameraPath::save(const std::string & filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+		return false;
+	file << "# CameraPath v1\n";
+	file << "# time px py pz qx qy qz qw focalDistance height orthographic\n";
+	file << std::setprecision(9);
+	for (size_t i = 0; i < m_keys.size(); ++i) {
+		const Keyframe & k = m_keys[i];
+		float q0, q1, q2, q3;
+		k.orientation.getValue(q0, q1, q2, q3);
+		file << k.time << " "
+		     << k.position[0] << " " << k.position[1] << " " << k.position[2] << " "
+		     << q0 << " " << q1 << " " << q2 << " " << q3 << " "
+		     << k.focalDistance << " " << k.height << " " << (k.orthographic ? 1 : 0) << "\n";
+	}
+	return static_cast<bool>(file);
+}
+
+//____________________________________________________________________
+bool CameraPath::load(const std::string & filename)
+{
+	std::ifstream file(filename.c_str());
+	if (!file)
+		return false;
+
+	std::vector<Keyframe> keys;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::istringstream in(line);
+		Keyframe k;
+		float px, py, pz, q0, q1, q2, q3;
+		int ortho;
+		if (!(in >> k.time >> px >> py >> pz >> q0 >> q1 >> q2 >> q3 >> k.focalDistance >> k.height >> ortho))
+			return false;
+		k.position.setValue(px, py, pz);
+		k.orientation.setValue(q0, q1, q2, q3);
+		k.orthographic = (ortho != 0);
+		keys.push_back(k);
+	}
+	m_keys.swap(keys);
+	return true;
+}
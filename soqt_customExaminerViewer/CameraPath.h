@@ -0,0 +1,68 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <Inventor/SbLinear.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbTime.h>
+
+#include <string>
+#include <vector>
+
+class SoCamera;
+
+// A recorded camera path: a list of timestamped camera states.
+//
+// The path is recorded by the CustomExaminerViewer ([R] shortcut) and
+// can be replayed at fixed steps, either in the viewer or offscreen (see
+// OffscreenReplay.h), to get reproducible per-frame render times.
+//
+// File format (text, one keyframe per line, '#' starts a comment):
+//   time[s] px py pz qx qy qz qw focalDistance height orthographic(0|1)
+// where "height" is the heightAngle of a perspective camera, or the
+// height of an orthographic one.
+class CameraPath {
+public:
+	struct Keyframe {
+		double time; // seconds from the start of the recording
+		SbVec3f position;
+		SbRotation orientation;
+		float focalDistance;
+		float height;
+		bool orthographic;
+	};
+
+	CameraPath();
+
+	// Recording
+	void startRecording();
+	void stopRecording();
+	bool isRecording() const { return m_recording; }
+	// Adds a keyframe if the camera moved since the last one
+	void record(const SoCamera * camera);
+
+	void clear() { m_keys.clear(); }
+	bool isEmpty() const { return m_keys.empty(); }
+	unsigned numKeyframes() const { return m_keys.size(); }
+	const Keyframe & keyframe(unsigned i) const { return m_keys[i]; }
+	double duration() const { return m_keys.empty() ? 0.0 : m_keys.back().time; }
+
+	// Interpolated state at time t (clamped to the path duration)
+	Keyframe stateAt(double t) const;
+	// Time of replay step i out of numSteps, evenly spaced over the duration
+	double stepTime(unsigned i, unsigned numSteps) const;
+
+	static Keyframe keyframeFromCamera(const SoCamera * camera);
+	static void applyTo(const Keyframe & key, SoCamera * camera);
+	// A new camera of the type used in the recording (refcount 0)
+	SoCamera * createCamera() const;
+
+	bool save(const std::string & filename) const;
+	bool load(const std::string & filename);
+
+private:
+	std::vector<Keyframe> m_keys;
+	bool m_recording;
+	SbTime m_startTime;
+};
+
+#endif
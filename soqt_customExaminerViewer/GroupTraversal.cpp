@@ -0,0 +1,40 @@
+#include "GroupTraversal.h"
+
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+
+//____________________________________________________________________
+bool GroupTraversal::isPlain(SoNode * node)
+{
+	const SoType type = node->getTypeId();
+	return type == SoSeparator::getClassTypeId() || type == SoGroup::getClassTypeId();
+}
+
+//____________________________________________________________________
+void GroupTraversal::renderChildren(SoGroup * group, SoGLRenderAction * action, const ChildRenderer & renderChild)
+{
+	const int n = group->getNumChildren();
+	action->pushCurPath();
+	for (int i = 0; i < n && !action->hasTerminated(); ++i) {
+		SoNode * child = group->getChild(i);
+		action->popPushCurPath(i, child);
+		if (action->abortNow())
+			break;
+		renderChild(child, i);
+	}
+	action->popCurPath();
+}
+
+//____________________________________________________________________
+void GroupTraversal::open(SoGroup * group, SoGLRenderAction * action, const ChildRenderer & renderChild)
+{
+	SoState * state = action->getState();
+	const bool separator = group->isOfType(SoSeparator::getClassTypeId());
+	if (separator)
+		state->push();
+	renderChildren(group, action, renderChild);
+	if (separator)
+		state->pop();
+}
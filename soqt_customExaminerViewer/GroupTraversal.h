@@ -0,0 +1,34 @@
+#ifndef GROUPTRAVERSAL_H
+#define GROUPTRAVERSAL_H
+
+#include <functional>
+
+class SoGLRenderAction;
+class SoGroup;
+class SoNode;
+
+// Render traversal of groups one child at a time, for the nodes which
+// open the groups below them instead of letting them render themselves:
+// the RenderProfiler times each child, the OcclusionCullingGroup culls
+// the separators inside it.
+namespace GroupTraversal {
+
+typedef std::function<void (SoNode * child, int index)> ChildRenderer;
+
+// Whether the node is a plain SoGroup or SoSeparator, which may be opened;
+// subclasses (switches, LODs, annotations, ...) traverse in their own way
+bool isPlain(SoNode * node);
+
+// Calls 'renderChild' for each child of 'group', with the current path of
+// the action set as the group would set it, until the action terminates
+// or aborts
+void renderChildren(SoGroup * group, SoGLRenderAction * action, const ChildRenderer & renderChild);
+
+// The same for a plain group met in such a traversal: if it is a
+// separator, the children are rendered in a state of their own, as it
+// would do itself (minus its render cache)
+void open(SoGroup * group, SoGLRenderAction * action, const ChildRenderer & renderChild);
+
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include "MultiView.h"
+#include "customViewer.h"
+#include "CameraPath.h"
+
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+
+#include <QCoreApplication>
+#include <QGridLayout>
+#include <QGLWidget>
+#include <QOpenGLWidget>
+#include <QOpenGLContext>
+#include <QtDebug>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+
+namespace {
+
+// Rotates the camera by 'angle' radians around the vertical axis through its focal point
+void orbit(SoCamera * camera, float angle)
+{
+	SbVec3f direction;
+	camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+	const SbVec3f focalPoint = camera->position.getValue() + direction * camera->focalDistance.getValue();
+	const SbRotation rotation(SbVec3f(0, 1, 0), angle);
+	camera->orientation = camera->orientation.getValue() * rotation;
+	camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+	camera->position = focalPoint - direction * camera->focalDistance.getValue();
+}
+
+// Front, top, side and a 3/4 view, then front views again
+SbRotation viewOrientation(unsigned i)
+{
+	const SbRotation views[4] = {
+		SbRotation::identity(),
+		SbRotation(SbVec3f(1, 0, 0), -M_PI / 2),
+		SbRotation(SbVec3f(0, 1, 0), M_PI / 2),
+		SbRotation(SbVec3f(0, 1, 0), M_PI / 4) * SbRotation(SbVec3f(1, 0, 0), -M_PI / 6)
+	};
+	return views[i % 4];
+}
+
+bool sameView(const CameraPath::Keyframe & a, const CameraPath::Keyframe & b)
+{
+	return a.position == b.position && a.orientation == b.orientation
+	    && a.focalDistance == b.focalDistance && a.height == b.height;
+}
+
+}
+
+
+//____________________________________________________________________
+MultiView::MultiView(SoNode * root, int rows, int columns, bool shareCaches, QWidget * parent)
+: QWidget(parent),
+  m_shareCaches(shareCaches),
+  m_sharingCaches(false),
+  m_linkCameras(false),
+  m_syncing(false)
+{
+	QGridLayout * layout = new QGridLayout(this);
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->setSpacing(2);
+
+	for (int r = 0; r < rows; ++r) {
+		for (int c = 0; c < columns; ++c) {
+			QWidget * cell = new QWidget(this);
+			layout->addWidget(cell, r, c);
+			m_viewers.push_back(new CustomExaminerViewer(cell));
+			SoNodeSensor * sensor = new SoNodeSensor(cameraChangedCB, this);
+			sensor->setPriority(0); // immediate, so that m_syncing stops the ping-pong between the views
+			m_cameraSensors.push_back(sensor);
+		}
+	}
+	setSceneGraph(root);
+}
+
+//____________________________________________________________________
+void MultiView::setSceneGraph(SoNode * root)
+{
+	for (size_t i = 0; i < m_viewers.size(); ++i) {
+		m_viewers[i]->setSceneGraph(root);
+		if (SoCamera * camera = m_viewers[i]->getCamera()) {
+			camera->orientation = viewOrientation(i);
+			m_viewers[i]->viewAll();
+		}
+	}
+	updateCameraSensors();
+	if (m_linkCameras)
+		setCameraLinking(true);
+}
+
+//____________________________________________________________________
+void MultiView::updateCameraSensors()
+{
+	for (size_t i = 0; i < m_viewers.size(); ++i) {
+		SoCamera * camera = m_viewers[i]->getCamera();
+		if (m_cameraSensors[i]->getAttachedNode() == camera)
+			continue;
+		m_cameraSensors[i]->detach();
+		if (camera)
+			m_cameraSensors[i]->attach(camera);
+	}
+}
+
+//____________________________________________________________________
+MultiView::~MultiView()
+{
+	for (size_t i = 0; i < m_cameraSensors.size(); ++i) {
+		m_cameraSensors[i]->detach();
+		delete m_cameraSensors[i];
+	}
+	for (size_t i = 0; i < m_viewers.size(); ++i)
+		delete m_viewers[i];
+}
+
+//____________________________________________________________________
+void MultiView::requestSharedContexts()
+{
+	// Every context Qt creates from then on shares with its global one
+	QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+}
+
+//____________________________________________________________________
+void MultiView::setupCacheSharing()
+{
+	m_sharingCaches = false;
+	if (m_viewers.empty())
+		return;
+
+	if (m_shareCaches) {
+		// All the GL contexts must be in the share group of the first one
+		m_sharingCaches = true;
+		QWidget * first = m_viewers[0]->getGLWidget();
+		for (size_t i = 1; i < m_viewers.size() && m_sharingCaches; ++i) {
+			QWidget * w = m_viewers[i]->getGLWidget();
+			QGLWidget * glFirst = qobject_cast<QGLWidget*>(first);
+			QGLWidget * gl = qobject_cast<QGLWidget*>(w);
+			QOpenGLWidget * oglFirst = qobject_cast<QOpenGLWidget*>(first);
+			QOpenGLWidget * ogl = qobject_cast<QOpenGLWidget*>(w);
+			if (glFirst && gl)
+				m_sharingCaches = QGLContext::areSharing(glFirst->context(), gl->context());
+			else if (oglFirst && ogl)
+				m_sharingCaches = QOpenGLContext::areSharing(oglFirst->context(), ogl->context());
+			else
+				m_sharingCaches = false;
+		}
+		if (!m_sharingCaches)
+			qWarning() << "MultiView: the GL contexts of the views are not shared, caches are kept per view.";
+	}
+
+	const uint32_t sharedContext = m_viewers[0]->getGLRenderAction()->getCacheContext();
+	for (size_t i = 0; i < m_viewers.size(); ++i) {
+		const uint32_t context = m_sharingCaches ? sharedContext : SoGLCacheContextElement::getUniqueCacheContext();
+		m_viewers[i]->getGLRenderAction()->setCacheContext(context);
+	}
+	qDebug() << "MultiView:" << m_viewers.size() << "views," << (m_sharingCaches ? "shared" : "independent") << "GL caches";
+}
+
+//____________________________________________________________________
+void MultiView::setCameraLinking(bool b)
+{
+	m_linkCameras = b;
+	updateCameraSensors();
+	if (b && !m_viewers.empty() && m_viewers[0]->getCamera())
+		cameraChangedCB(this, m_cameraSensors[0]); // align all the views on the first one
+}
+
+//____________________________________________________________________
+void MultiView::cameraChangedCB(void * userdata, SoSensor * sensor)
+{
+	MultiView * self = static_cast<MultiView*>(userdata);
+	if (!self->m_linkCameras || self->m_syncing)
+		return;
+
+	SoNodeSensor * nodeSensor = static_cast<SoNodeSensor*>(sensor);
+	SoCamera * source = static_cast<SoCamera*>(nodeSensor->getAttachedNode());
+	if (!source)
+		return;
+	// The viewers set their own clipping planes at each frame, those are not linked
+	SoField * trigger = nodeSensor->getTriggerField();
+	if (trigger && (trigger == &source->nearDistance || trigger == &source->farDistance))
+		return;
+
+	const CameraPath::Keyframe view = CameraPath::keyframeFromCamera(source);
+	self->m_syncing = true;
+	for (size_t i = 0; i < self->m_viewers.size(); ++i) {
+		SoCamera * camera = self->m_viewers[i]->getCamera();
+		if (camera && camera != source && !sameView(CameraPath::keyframeFromCamera(camera), view))
+			CameraPath::applyTo(view, camera);
+	}
+	self->m_syncing = false;
+}
+
+//____________________________________________________________________
+long MultiView::residentMemory()
+{
+	// Second field of /proc/self/statm: resident pages
+	std::ifstream statm("/proc/self/statm");
+	long size = 0, resident = 0;
+	if (!(statm >> size >> resident))
+		return 0;
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+//____________________________________________________________________
+void MultiView::benchmark(unsigned frames)
+{
+	updateCameraSensors();
+	const long memoryBefore = residentMemory();
+	printf("# MultiView benchmark: %u views, %s caches, %s cameras, %u frames per view\n",
+	       numViewers(), m_sharingCaches ? "shared" : "independent", m_linkCameras ? "linked" : "independent", frames);
+	printf("# resident memory before the first frame: %ld kB\n", memoryBefore);
+
+	// The first frame of each view builds the caches
+	std::vector<ViewerStats> stats(m_viewers.size(), ViewerStats(frames ? frames : 1));
+	for (size_t i = 0; i < m_viewers.size(); ++i)
+		printf("view %u: first frame %.3f ms\n", unsigned(i), m_viewers[i]->timedRender());
+	const long memoryAfterFirst = residentMemory();
+
+	for (unsigned f = 0; f < frames; ++f) {
+		for (size_t i = 0; i < m_viewers.size(); ++i) {
+			SoCamera * camera = m_viewers[i]->getCamera();
+			if (camera && (!m_linkCameras || i == 0))
+				orbit(camera, 0.01f);
+			stats[i].addFrameTime(m_viewers[i]->timedRender());
+		}
+	}
+
+	double total = 0.0;
+	for (size_t i = 0; i < m_viewers.size(); ++i) {
+		printf("view %u: p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n", unsigned(i),
+		       stats[i].percentile(50), stats[i].percentile(95), stats[i].percentile(99));
+		total += stats[i].percentile(50);
+	}
+	printf("# sum of the median frame times of all views: %.3f ms\n", total);
+	printf("# resident memory: %ld kB after the first frames (+%ld kB), %ld kB at the end\n",
+	       memoryAfterFirst, memoryAfterFirst - memoryBefore, residentMemory());
+	fflush(stdout);
+}
@@ -0,0 +1,72 @@
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include <QWidget>
+
+#include <vector>
+
+class CustomExaminerViewer;
+class SoNode;
+class SoSensor;
+class SoNodeSensor;
+
+// Several CustomExaminerViewers on one scene graph, in a grid layout
+// (2x2 by default: front, top, side and a 3/4 view).
+//
+// With shared caches, all the viewers render with the same GL cache
+// context id, so display lists, VBOs and render caches built by one
+// viewer are reused by the others instead of being built once per view.
+// That is only valid if the GL contexts of the viewers are in one share
+// group. SoQt gives each viewer a context of its own, without a share
+// widget, so requestSharedContexts() asks Qt to create all of them in the
+// share group of its global context (Qt::AA_ShareOpenGLContexts). This
+// is checked after the widgets are shown, and the viewers fall back to
+// their own cache contexts if the contexts are not shared (GL widgets
+// which ignore the attribute).
+//
+// With camera linking on, moving the camera in one view moves all the
+// others the same way. The cameras are followed through node sensors,
+// attached again by setSceneGraph(); after a setSceneGraph() or a
+// setCamera() on one of the viewers, call updateCameraSensors().
+class MultiView : public QWidget {
+public:
+	MultiView(SoNode * root, int rows = 2, int columns = 2, bool shareCaches = true, QWidget * parent = 0);
+	virtual ~MultiView();
+
+	unsigned numViewers() const { return m_viewers.size(); }
+	CustomExaminerViewer * viewer(unsigned i) const { return m_viewers[i]; }
+
+	// The same scene in all the views, each looking from its own side
+	void setSceneGraph(SoNode * root);
+
+	// Must be called before SoQt::init creates the application
+	static void requestSharedContexts();
+
+	// Call once the widget is shown (the GL contexts must exist)
+	void setupCacheSharing();
+	bool isSharingCaches() const { return m_sharingCaches; }
+
+	void setCameraLinking(bool);
+	bool isCameraLinking() const { return m_linkCameras; }
+	// Follows the current camera of each viewer
+	void updateCameraSensors();
+
+	// Renders 'frames' frames in each view, slightly orbiting the cameras,
+	// and prints the frame times and the process memory to stdout.
+	void benchmark(unsigned frames);
+
+	// Resident set size of the process, in kB (0 if unknown)
+	static long residentMemory();
+
+private:
+	std::vector<CustomExaminerViewer *> m_viewers;
+	std::vector<SoNodeSensor *> m_cameraSensors;
+	bool m_shareCaches;
+	bool m_sharingCaches;
+	bool m_linkCameras;
+	bool m_syncing;
+
+	static void cameraChangedCB(void * userdata, SoSensor * sensor);
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+
+struct ScreenVertex {
+	float x, y, z;
+};
+
+// Object coordinates to window coordinates; false if the point is not in
+// front of the near plane
+bool project(const float m[4][4], const float p[3], int width, int height, ScreenVertex & v)
+{
+	const float x = p[0] * m[0][0] + p[1] * m[1][0] + p[2] * m[2][0] + m[3][0];
+	const float y = p[0] * m[0][1] + p[1] * m[1][1] + p[2] * m[2][1] + m[3][1];
+	const float z = p[0] * m[0][2] + p[1] * m[1][2] + p[2] * m[2][2] + m[3][2];
+	const float w = p[0] * m[0][3] + p[1] * m[1][3] + p[2] * m[2][3] + m[3][3];
+	if (w <= 1e-6f || z < -w)
+		return false;
+	const float invW = 1.0f / w;
+	v.x = (x * invW * 0.5f + 0.5f) * width;
+	v.y = (y * invW * 0.5f + 0.5f) * height;
+	v.z = z * invW * 0.5f + 0.5f;
+	return true;
+}
+
+}
+
+
+//____________________________________________________________________
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+: m_width(0),
+  m_height(0)
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			m_matrix[i][j] = i == j ? 1.0f : 0.0f;
+	resize(width, height);
+}
+
+//____________________________________________________________________
+void OcclusionBuffer::resize(int width, int height)
+{
+	// Rows are a multiple of 4 pixels for the SIMD loops
+	m_width = std::max(4, (width + 3) & ~3);
+	m_height = std::max(1, height);
+	m_depth.assign(size_t(m_width) * m_height, 1.0f);
+}
+
+//____________________________________________________________________
+void OcclusionBuffer::setMatrix(const float matrix[4][4])
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			m_matrix[i][j] = matrix[i][j];
+}
+
+//____________________________________________________________________
+void OcclusionBuffer::clear(const float matrix[4][4])
+{
+	setMatrix(matrix);
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+}
+
+//____________________________________________________________________
+void OcclusionBuffer::rasterizeTriangles(const float * xyz, unsigned numTriangles)
+{
+	for (unsigned i = 0; i < numTriangles; ++i, xyz += 9)
+		rasterizeTriangle(xyz, xyz + 3, xyz + 6);
+}
+
+//____________________________________________________________________
+void OcclusionBuffer::rasterizeTriangle(const float p0[3], const float p1[3], const float p2[3])
+{
+	ScreenVertex v0, v1, v2;
+	if (!project(m_matrix, p0, m_width, m_height, v0)
+	    || !project(m_matrix, p1, m_width, m_height, v1)
+	    || !project(m_matrix, p2, m_width, m_height, v2))
+		return;
+
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (std::fabs(area) < 1e-8f)
+		return;
+	if (area < 0.0f) { // both faces occlude
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	const int minX = std::max(0, int(std::floor(std::min(v0.x, std::min(v1.x, v2.x)))));
+	const int maxX = std::min(m_width - 1, int(std::ceil(std::max(v0.x, std::max(v1.x, v2.x)))));
+	const int minY = std::max(0, int(std::floor(std::min(v0.y, std::min(v1.y, v2.y)))));
+	const int maxY = std::min(m_height - 1, int(std::ceil(std::max(v0.y, std::max(v1.y, v2.y)))));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Edge functions e(x, y) = a * x + b * y + c, positive inside, sampled
+	// at the pixel centers. Edges shared by two triangles are covered by
+	// both, so meshes have no cracks; isBoxVisible() makes up for the
+	// pixels only partly covered at the silhouettes.
+	const ScreenVertex * v[3] = { &v0, &v1, &v2 };
+	float a[3], b[3], c[3];
+	for (int e = 0; e < 3; ++e) {
+		const ScreenVertex & s = *v[(e + 1) % 3];
+		const ScreenVertex & t = *v[(e + 2) % 3];
+		a[e] = s.y - t.y;
+		b[e] = t.x - s.x;
+		c[e] = s.x * t.y - s.y * t.x;
+	}
+
+	// Depth is linear in window coordinates; each pixel gets the farthest
+	// depth of the triangle over its area, so that the buffer never claims
+	// an occluder nearer than it really is
+	const float invArea = 1.0f / area;
+	const float dzdx = (a[0] * v0.z + a[1] * v1.z + a[2] * v2.z) * invArea;
+	const float dzdy = (b[0] * v0.z + b[1] * v1.z + b[2] * v2.z) * invArea;
+	const float z0 = v0.z - dzdx * v0.x - dzdy * v0.y + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+	const int startX = minX & ~3;
+	for (int y = minY; y <= maxY; ++y) {
+		const float py = y + 0.5f;
+		float * row = &m_depth[size_t(y) * m_width];
+		int x = startX;
+#ifdef __SSE2__
+		const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		for (; x <= maxX; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+			const __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(b[0] * py + c[0]));
+			const __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(b[1] * py + c[1]));
+			const __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(b[2] * py + c[2]));
+			const __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+			const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + z0));
+			const __m128 old = _mm_loadu_ps(row + x);
+			const __m128 nearer = _mm_min_ps(old, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+#else
+		for (; x <= maxX; ++x) {
+			const float px = x + 0.5f;
+			if (a[0] * px + b[0] * py + c[0] < 0.0f || a[1] * px + b[1] * py + c[1] < 0.0f
+			    || a[2] * px + b[2] * py + c[2] < 0.0f)
+				continue;
+			const float z = dzdx * px + dzdy * py + z0;
+			if (z < row[x])
+				row[x] = z;
+		}
+#endif
+	}
+}
+
+//____________________________________________________________________
+bool OcclusionBuffer::isBoxVisible(const float min[3], const float max[3]) const
+{
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+	for (int i = 0; i < 8; ++i) {
+		const float corner[3] = { i & 1 ? max[0] : min[0], i & 2 ? max[1] : min[1], i & 4 ? max[2] : min[2] };
+		ScreenVertex v;
+		if (!project(m_matrix, corner, m_width, m_height, v))
+			return true; // the box reaches the near plane
+		minX = std::min(minX, v.x);
+		maxX = std::max(maxX, v.x);
+		minY = std::min(minY, v.y);
+		maxY = std::max(maxY, v.y);
+		minZ = std::min(minZ, v.z);
+	}
+
+	if (maxX <= 0.0f || maxY <= 0.0f || minX >= m_width || minY >= m_height)
+		return false; // outside of the view
+
+	// All the pixels touched by the screen rectangle of the box, plus one
+	// around: the occluders are sampled at the pixel centers, so a pixel at
+	// their silhouette may be marked covered while part of it is not
+	const int x0 = std::max(0, int(std::floor(minX)) - 1);
+	const int x1 = std::min(m_width - 1, int(std::ceil(maxX)));
+	const int y0 = std::max(0, int(std::floor(minY)) - 1);
+	const int y1 = std::min(m_height - 1, int(std::ceil(maxY)));
+
+	for (int y = y0; y <= y1; ++y) {
+		const float * row = &m_depth[size_t(y) * m_width];
+		int x = x0;
+#ifdef __SSE2__
+		const __m128 boxZ = _mm_set1_ps(minZ);
+		for (; x + 3 <= x1; x += 4) {
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxZ)))
+				return true;
+		}
+#endif
+		for (; x <= x1; ++x) {
+			if (row[x] >= minZ)
+				return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,47 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include <vector>
+
+// A low resolution software depth buffer, used by OcclusionCullingGroup.
+//
+// The triangles of a few large occluders are rasterized into it on the
+// CPU at each frame; then the bounding box of each candidate subgraph is
+// tested against it: if the whole screen footprint of the box lies
+// behind the occluders, the subgraph cannot be visible.
+//
+// Matrices follow the Coin (row vector) convention: clip = (x y z 1) * M.
+// Depth is the normalized device z mapped to [0,1], 0 being the near plane.
+// The inner loops work on 4 pixels at a time with SSE2 when available.
+class OcclusionBuffer {
+public:
+	OcclusionBuffer(int width = 256, int height = 128);
+
+	void resize(int width, int height);
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	// Resets the depth to the far plane and sets the object-to-clip matrix
+	void clear(const float matrix[4][4]);
+	void setMatrix(const float matrix[4][4]);
+
+	// Triangles as 9 floats each (three xyz vertices), in object coordinates.
+	// Triangles crossing the near plane are skipped: they would only make
+	// the buffer less conservative.
+	void rasterizeTriangles(const float * xyz, unsigned numTriangles);
+
+	// Conservative test of an object space box against the buffer
+	bool isBoxVisible(const float min[3], const float max[3]) const;
+
+	const float * depth() const { return &m_depth[0]; }
+
+private:
+	int m_width;
+	int m_height;
+	std::vector<float> m_depth; // row-major, row 0 at the bottom
+	float m_matrix[4][4];
+
+	void rasterizeTriangle(const float v0[3], const float v1[3], const float v2[3]);
+};
+
+#endif
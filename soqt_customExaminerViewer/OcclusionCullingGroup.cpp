@@ -0,0 +1,303 @@
+#include "OcclusionCullingGroup.h"
+#include "GroupTraversal.h"
+
+#include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCoordinateElement.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoProjectionMatrixElement.h>
+#include <Inventor/elements/SoViewingMatrixElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/misc/SoNotification.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/nodes/SoVertexShape.h>
+#include <Inventor/nodes/SoCamera.h>
+
+#include <QtDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+namespace {
+
+unsigned countNodes(SoNode * node)
+{
+	unsigned n = 1;
+	SoChildList * children = node->getChildren();
+	if (children)
+		for (int i = 0; i < children->getLength(); ++i)
+			n += countNodes((*children)[i]);
+	return n;
+}
+
+// A vertex shape with no coordinates of its own nor set above it, in a
+// subgraph traversed on its own: it takes those inherited in the scene
+SoCallbackAction::Response inheritedCoordinatesCB(void * userdata, SoCallbackAction * action, const SoNode * node)
+{
+	const SoVertexProperty * property =
+		static_cast<const SoVertexProperty*>(static_cast<const SoVertexShape*>(node)->vertexProperty.getValue());
+	if ((!property || !property->vertex.getNum())
+	    && SoCoordinateElement::getInstance(action->getState())->getNodeId() == 0) {
+		*static_cast<bool*>(userdata) = true;
+		return SoCallbackAction::ABORT;
+	}
+	return SoCallbackAction::CONTINUE;
+}
+
+bool largerBox(const std::pair<float, SoNode*> & a, const std::pair<float, SoNode*> & b)
+{
+	return a.first > b.first;
+}
+
+}
+
+
+SO_NODE_SOURCE(OcclusionCullingGroup);
+
+//____________________________________________________________________
+void OcclusionCullingGroup::initClass()
+{
+	if (getClassTypeId() == SoType::badType()) {
+		SO_NODE_INIT_CLASS(OcclusionCullingGroup, SoSeparator, "Separator");
+	}
+}
+
+//____________________________________________________________________
+OcclusionCullingGroup::OcclusionCullingGroup()
+: m_dirty(true),
+  m_bufferWidth(256),
+  m_bufferReady(false),
+  m_current(0)
+{
+	SO_NODE_CONSTRUCTOR(OcclusionCullingGroup);
+	SO_NODE_ADD_FIELD(occlusionCulling, (TRUE));
+	SO_NODE_ADD_FIELD(maxOccluders, (16));
+	SO_NODE_ADD_FIELD(maxOccluderTriangles, (5000));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+//____________________________________________________________________
+OcclusionCullingGroup::~OcclusionCullingGroup()
+{
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::notify(SoNotList * list)
+{
+	// Moving a camera which is in the graph changes nothing we collected
+	SoNotRec * rec = list->getFirstRec();
+	SoBase * origin = rec ? rec->getBase() : 0;
+	if (!origin || !origin->isOfType(SoCamera::getClassTypeId()))
+		m_dirty = true;
+	SoSeparator::notify(list);
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::GLRenderBelowPath(SoGLRenderAction * action)
+{
+	if (!occlusionCulling.getValue()) {
+		SoSeparator::GLRenderBelowPath(action);
+		return;
+	}
+
+	SoState * state = action->getState();
+	if (m_dirty) {
+		collectOccluders(SoViewportRegionElement::get(state));
+		m_nodeInfo.clear();
+		m_dirty = false;
+	}
+
+	const unsigned occluders = m_stats.occluders, occluderTriangles = m_stats.occluderTriangles;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.occluders = occluders;
+	m_stats.occluderTriangles = occluderTriangles;
+
+	// What is drawn depends on the camera: no render cache above us may record it
+	SoCacheElement::invalidate(state);
+
+	state->push();
+	m_groupMatrix = SoModelMatrixElement::get(state);
+	m_bufferReady = false; // built at the first test, once the camera (if it is in here) has been traversed
+	GroupTraversal::renderChildren(this, action, [=](SoNode * child, int) { renderChild(child, action); });
+	state->pop();
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::renderChild(SoNode * child, SoGLRenderAction * action)
+{
+	if (child->isOfType(SoSeparator::getClassTypeId())) {
+		SoState * state = action->getState();
+		++m_stats.tested;
+		if (!isVisible(child, state)) {
+			++m_stats.culled;
+			m_stats.culledNodes += nodeInfo(child, SoViewportRegionElement::get(state)).numNodes;
+			return;
+		}
+		if (isOpenable(child)) {
+			// What is inside is culled one separator at a time
+			GroupTraversal::open(static_cast<SoGroup*>(child), action,
+			                     [=](SoNode * grandChild, int) { renderChild(grandChild, action); });
+			return;
+		}
+	}
+	child->GLRenderBelowPath(action);
+}
+
+//____________________________________________________________________
+bool OcclusionCullingGroup::isOpenable(SoNode * node)
+{
+	// A plain separator (SoAnnotation, SoLocateHighlight, ... render in
+	// their own way) with separators to cull inside
+	if (!GroupTraversal::isPlain(node) || !node->isOfType(SoSeparator::getClassTypeId()))
+		return false;
+	SoGroup * group = static_cast<SoGroup*>(node);
+	for (int i = 0; i < group->getNumChildren(); ++i)
+		if (group->getChild(i)->isOfType(SoSeparator::getClassTypeId()))
+			return true;
+	return false;
+}
+
+//____________________________________________________________________
+const OcclusionCullingGroup::NodeInfo & OcclusionCullingGroup::nodeInfo(SoNode * node, const SbViewportRegion & region)
+{
+	std::map<SoNode *, NodeInfo>::iterator it = m_nodeInfo.find(node);
+	if (it != m_nodeInfo.end())
+		return it->second;
+	NodeInfo & info = m_nodeInfo[node];
+	SoGetBoundingBoxAction bboxAction(region);
+	bboxAction.apply(node);
+	info.box = bboxAction.getBoundingBox();
+	info.numNodes = countNodes(node);
+	info.inheritsCoordinates = false;
+	SoCallbackAction inherited(region);
+	inherited.addPreCallback(SoVertexShape::getClassTypeId(), inheritedCoordinatesCB, &info.inheritsCoordinates);
+	inherited.apply(node);
+	return info;
+}
+
+//____________________________________________________________________
+bool OcclusionCullingGroup::isVisible(SoNode * node, SoState * state)
+{
+	if (!m_bufferReady)
+		buildBuffer(state);
+	if (m_occluders.empty())
+		return true;
+
+	const NodeInfo & info = nodeInfo(node, SoViewportRegionElement::get(state));
+	if (info.box.isEmpty())
+		return true; // nothing to cull, e.g. only state nodes
+	if (info.inheritsCoordinates)
+		return true; // its box, computed without them, is not where its shapes are
+	const SbMatrix matrix = SoModelMatrixElement::get(state) * SoViewingMatrixElement::get(state)
+	                        * SoProjectionMatrixElement::get(state);
+	m_buffer.setMatrix(matrix.getValue());
+	const SbVec3f & min = info.box.getMin();
+	const SbVec3f & max = info.box.getMax();
+	const float boxMin[3] = { min[0], min[1], min[2] };
+	const float boxMax[3] = { max[0], max[1], max[2] };
+	return m_buffer.isBoxVisible(boxMin, boxMax);
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::buildBuffer(SoState * state)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	const SbVec2s size = SoViewportRegionElement::get(state).getViewportSizePixels();
+	const int height = std::max(16, std::min(4 * m_bufferWidth, m_bufferWidth * std::max<int>(size[1], 1) / std::max<int>(size[0], 1)));
+	if (m_buffer.width() != m_bufferWidth || m_buffer.height() != height)
+		m_buffer.resize(m_bufferWidth, height);
+
+	const SbMatrix matrix = m_groupMatrix * SoViewingMatrixElement::get(state) * SoProjectionMatrixElement::get(state);
+	m_buffer.clear(matrix.getValue());
+	for (size_t i = 0; i < m_occluders.size(); ++i)
+		m_buffer.rasterizeTriangles(&m_occluders[i].triangles[0], m_occluders[i].triangles.size() / 9);
+	m_bufferReady = true;
+
+	m_stats.bufferTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::collectOccluders(const SbViewportRegion & region)
+{
+	// Triangles of each separator holding shapes, in the coordinates of this group
+	m_candidates.clear();
+	SoCallbackAction action(region);
+	action.addPreCallback(SoShape::getClassTypeId(), preShapeCB, this);
+	action.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, this);
+	action.apply(this);
+	m_current = 0;
+
+	// The largest of the ones small enough to be rasterized at each frame
+	std::vector<std::pair<float, SoNode*> > sizes;
+	for (std::map<SoNode *, Occluder>::iterator it = m_candidates.begin(); it != m_candidates.end(); ++it) {
+		const Occluder & o = it->second;
+		if (it->first == this || o.triangles.empty() || o.triangles.size() / 9 > unsigned(maxOccluderTriangles.getValue()))
+			continue;
+		float dx, dy, dz;
+		o.box.getSize(dx, dy, dz);
+		sizes.push_back(std::make_pair(dx * dx + dy * dy + dz * dz, it->first));
+	}
+	std::sort(sizes.begin(), sizes.end(), largerBox);
+	sizes.resize(std::min<size_t>(sizes.size(), std::max(0, maxOccluders.getValue())));
+
+	m_occluders.clear();
+	unsigned numTriangles = 0;
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		m_occluders.push_back(Occluder());
+		m_occluders.back().triangles.swap(m_candidates[sizes[i].second].triangles);
+		m_occluders.back().node = sizes[i].second;
+		numTriangles += m_occluders.back().triangles.size() / 9;
+	}
+	m_candidates.clear();
+	m_stats.occluders = m_occluders.size();
+	m_stats.occluderTriangles = numTriangles;
+
+	qDebug() << "OcclusionCullingGroup:" << m_occluders.size() << "occluders," << numTriangles << "triangles";
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response OcclusionCullingGroup::preShapeCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+	// The shape belongs to the innermost separator above it
+	OcclusionCullingGroup * self = static_cast<OcclusionCullingGroup*>(userdata);
+	const SoPath * path = action->getCurPath();
+	SoNode * owner = self;
+	for (int i = path->getLength() - 2; i > 0; --i) {
+		if (path->getNode(i)->isOfType(SoSeparator::getClassTypeId())) {
+			owner = path->getNode(i);
+			break;
+		}
+	}
+	self->m_current = &self->m_candidates[owner];
+	self->m_current->node = owner;
+	return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void OcclusionCullingGroup::triangleCB(void * userdata, SoCallbackAction * action,
+                                       const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3)
+{
+	OcclusionCullingGroup * self = static_cast<OcclusionCullingGroup*>(userdata);
+	Occluder * occluder = self->m_current;
+	if (!occluder || occluder->triangles.size() / 9 > unsigned(self->maxOccluderTriangles.getValue()))
+		return; // too large to be an occluder anyway
+	const SbMatrix & matrix = action->getModelMatrix();
+	const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+	for (int i = 0; i < 3; ++i) {
+		SbVec3f p;
+		matrix.multVecMatrix(v[i]->getPoint(), p);
+		occluder->triangles.push_back(p[0]);
+		occluder->triangles.push_back(p[1]);
+		occluder->triangles.push_back(p[2]);
+		occluder->box.extendBy(p);
+	}
+}
@@ -0,0 +1,106 @@
+#ifndef OCCLUSIONCULLINGGROUP_H
+#define OCCLUSIONCULLINGGROUP_H
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/fields/SoSFBool.h>
+#include <Inventor/fields/SoSFInt32.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbMatrix.h>
+
+#include <map>
+#include <vector>
+
+#include "OcclusionBuffer.h"
+
+class SoState;
+
+// A separator which skips, at render time, the parts of its subgraph that
+// are hidden behind other geometry.
+//
+// At each frame the triangles of the largest "small" subgraphs (at most
+// maxOccluders of them, with at most maxOccluderTriangles triangles each)
+// are rasterized into a low resolution OcclusionBuffer. The render
+// traversal then walks down through the plain SoSeparators of the
+// subgraph: each separator whose bounding box is fully behind the
+// occluders is skipped, the visible ones are either opened (if they
+// contain other separators) or rendered as usual, with their own render
+// caches. The other node types are always traversed, and so are the
+// separators whose shapes use coordinates set above them (their boxes are
+// computed on their own, without those).
+//
+// Occluders are rasterized from their triangles, not from their bounding
+// boxes: a box is larger than the geometry in it, and would hide things
+// that are really visible. The occluders are tested like the others, they
+// can be hidden too.
+//
+// The node needs initClass() after SoDB::init(). It does not render
+// differently from a SoSeparator with occlusionCulling set to FALSE.
+class OcclusionCullingGroup : public SoSeparator {
+	SO_NODE_HEADER(OcclusionCullingGroup);
+
+public:
+	static void initClass();
+	OcclusionCullingGroup();
+
+	SoSFBool occlusionCulling;
+	SoSFInt32 maxOccluders;
+	SoSFInt32 maxOccluderTriangles;
+
+	struct FrameStats {
+		unsigned tested;            // separators tested against the buffer
+		unsigned culled;            // separators skipped
+		unsigned culledNodes;       // nodes in the skipped subgraphs
+		unsigned occluders;
+		unsigned occluderTriangles;
+		double bufferTime;          // ms spent rasterizing the occluders
+	};
+	const FrameStats & lastFrameStats() const { return m_stats; }
+
+	// Width of the depth buffer (a multiple of 4, 256 by default); the height follows the viewport aspect ratio
+	void setBufferWidth(int width) { m_bufferWidth = width; }
+
+	virtual void GLRenderBelowPath(SoGLRenderAction * action);
+	virtual void notify(SoNotList * list);
+
+protected:
+	virtual ~OcclusionCullingGroup();
+
+private:
+	struct Occluder {
+		SoNode * node;
+		std::vector<float> triangles; // in the coordinates of this group
+		SbBox3f box;
+	};
+	struct NodeInfo {
+		SbBox3f box; // in the coordinates the node is traversed in
+		unsigned numNodes;
+		bool inheritsCoordinates; // then never culled
+	};
+
+	bool m_dirty;
+	int m_bufferWidth;
+	std::vector<Occluder> m_occluders;
+	std::map<SoNode *, NodeInfo> m_nodeInfo;
+	OcclusionBuffer m_buffer;
+	bool m_bufferReady;
+	SbMatrix m_groupMatrix;
+	FrameStats m_stats;
+
+	// Occluder collection
+	std::map<SoNode *, Occluder> m_candidates;
+	Occluder * m_current;
+
+	void collectOccluders(const SbViewportRegion & region);
+	void buildBuffer(SoState * state);
+	const NodeInfo & nodeInfo(SoNode * node, const SbViewportRegion & region);
+	bool isVisible(SoNode * node, SoState * state);
+	void renderChild(SoNode * child, SoGLRenderAction * action);
+	static bool isOpenable(SoNode * node);
+
+	static SoCallbackAction::Response preShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+	static void triangleCB(void * userdata, SoCallbackAction * action,
+	                       const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "OffscreenReplay.h"
+
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+//____________________________________________________________________
+OffscreenReplay::OffscreenReplay(const SbViewportRegion & region)
+: m_region(region),
+  m_stats(1 << 16)
+{
+}
+
+//____________________________________________________________________
+bool OffscreenReplay::run(SoNode * scene, const CameraPath & path, unsigned numSteps)
+{
+	if (path.isEmpty()) {
+		fprintf(stderr, "OffscreenReplay: empty camera path\n");
+		return false;
+	}
+
+	SoSeparator * root = new SoSeparator;
+	root->ref();
+	SoCamera * camera = path.createCamera();
+	root->addChild(camera);
+	// Same headlight as the viewers, so that the frames look (and cost) the same
+	SoDirectionalLight * headlight = new SoDirectionalLight;
+	root->addChild(headlight);
+	root->addChild(scene);
+
+	// Clipping planes are set per frame from the scene bounding box,
+	// as the viewer does with auto clipping.
+	SoGetBoundingBoxAction bboxAction(m_region);
+	bboxAction.apply(scene);
+	const SbBox3f box = bboxAction.getBoundingBox();
+	const SbVec3f center = box.isEmpty() ? SbVec3f(0, 0, 0) : box.getCenter();
+	float radius = 1.0f;
+	if (!box.isEmpty()) {
+		float dx, dy, dz;
+		box.getSize(dx, dy, dz);
+		radius = std::max(0.5f * SbVec3f(dx, dy, dz).length(), 1e-3f);
+	}
+
+	SoOffscreenRenderer renderer(m_region);
+	m_stats.reset();
+
+	const unsigned frames = numSteps ? numSteps : path.numKeyframes();
+	printf("# frame  time[s]  render[ms]\n");
+	for (unsigned i = 0; i < frames; ++i) {
+		const CameraPath::Keyframe key = numSteps ? path.stateAt(path.stepTime(i, numSteps)) : path.keyframe(i);
+		CameraPath::applyTo(key, camera);
+
+		SbVec3f direction;
+		key.orientation.multVec(SbVec3f(0, 0, -1), direction);
+		const float distance = (center - key.position).dot(direction);
+		camera->nearDistance = std::max(distance - radius, radius * 1e-3f);
+		camera->farDistance = std::max(distance + radius, radius * 2e-3f);
+		headlight->direction = direction;
+
+		// NB: SoOffscreenRenderer::render() also reads the pixels back,
+		// which makes the GL pipeline finish before we stop the clock.
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const SbBool ok = renderer.render(root);
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (!ok) {
+			fprintf(stderr, "OffscreenReplay: could not render frame %u (no offscreen GL context?)\n", i);
+			root->unref();
+			return false;
+		}
+		m_stats.addFrameTime(ms);
+		printf("%7u  %7.3f  %10.3f\n", i, key.time, ms);
+	}
+
+	printf("# %u frames, %dx%d, p50: %.3f ms, p95: %.3f ms, p99: %.3f ms\n", frames,
+	       m_region.getViewportSizePixels()[0], m_region.getViewportSizePixels()[1],
+	       m_stats.percentile(50), m_stats.percentile(95), m_stats.percentile(99));
+
+	root->unref();
+	return true;
+}
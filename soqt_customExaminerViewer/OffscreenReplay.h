@@ -0,0 +1,36 @@
+#ifndef OFFSCREENREPLAY_H
+#define OFFSCREENREPLAY_H
+
+#include <Inventor/SbViewportRegion.h>
+
+#include "CameraPath.h"
+#include "ViewerStats.h"
+
+class SoNode;
+
+// Replays a CameraPath on a scene with SoOffscreenRenderer, without any
+// window, and reports the render time of each step.
+//
+// To run on machines without a GPU (or without a display), use a software
+// GL implementation, e.g. Mesa's llvmpipe under a virtual framebuffer:
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./soqt_customExaminerViewer --headless --replay path.txt
+// (FrameTiming::requestSoftwareGL() sets LIBGL_ALWAYS_SOFTWARE itself, if not
+// set already.)
+class OffscreenReplay {
+public:
+	OffscreenReplay(const SbViewportRegion & region = SbViewportRegion(800, 600));
+
+	// Renders 'numSteps' frames evenly spaced over the path duration
+	// (or one frame per recorded keyframe if numSteps is 0), printing one
+	// line per frame to stdout. The scene must not contain a camera.
+	// Returns false if the offscreen context could not be created.
+	bool run(SoNode * scene, const CameraPath & path, unsigned numSteps = 0);
+
+	const ViewerStats & stats() const { return m_stats; }
+
+private:
+	SbViewportRegion m_region;
+	ViewerStats m_stats;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "PickAccelerator.h"
+
+#include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+#include <QtDebug>
+
+#include <chrono>
+#include <cmath>
+
+
+namespace {
+
+// Moller-Trumbore ray/triangle intersection
+bool intersectTriangle(const float orig[3], const float dir[3], const float * tri, float & t)
+{
+	const float * v0 = tri;
+	const float e1[3] = { tri[3] - v0[0], tri[4] - v0[1], tri[5] - v0[2] };
+	const float e2[3] = { tri[6] - v0[0], tri[7] - v0[1], tri[8] - v0[2] };
+	const float p[3] = { dir[1] * e2[2] - dir[2] * e2[1],
+	                     dir[2] * e2[0] - dir[0] * e2[2],
+	                     dir[0] * e2[1] - dir[1] * e2[0] };
+	const float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	if (std::fabs(det) < 1e-12f)
+		return false; // ray parallel to the triangle
+	const float invDet = 1.0f / det;
+	const float s[3] = { orig[0] - v0[0], orig[1] - v0[1], orig[2] - v0[2] };
+	const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+	const float q[3] = { s[1] * e1[2] - s[2] * e1[1],
+	                     s[2] * e1[0] - s[0] * e1[2],
+	                     s[0] * e1[1] - s[1] * e1[0] };
+	const float v = (dir[0] * q[0] + dir[1] * q[1] + dir[2] * q[2]) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+	t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+	return t > 0.0f;
+}
+
+}
+
+
+//____________________________________________________________________
+PickAccelerator::PickAccelerator()
+: m_root(0),
+  m_sensor(0),
+  m_dirty(true),
+  m_topDirty(true),
+  m_lastBuildTime(0.0),
+  m_current(0),
+  m_rebuilding(0)
+{
+	m_sensor = new SoNodeSensor(sceneChangedCB, this);
+	m_sensor->setPriority(0); // immediate, so that the trigger node is known in the callback
+}
+
+//____________________________________________________________________
+PickAccelerator::~PickAccelerator()
+{
+	m_sensor->detach();
+	delete m_sensor;
+	clearShapes();
+}
+
+//____________________________________________________________________
+void PickAccelerator::setSceneGraph(SoNode * root)
+{
+	m_sensor->detach();
+	m_root = root;
+	if (root)
+		m_sensor->attach(root);
+	invalidate();
+}
+
+//____________________________________________________________________
+void PickAccelerator::invalidate()
+{
+	m_dirty = true;
+}
+
+//____________________________________________________________________
+void PickAccelerator::clearShapes()
+{
+	for (size_t i = 0; i < m_shapes.size(); ++i) {
+		m_shapes[i]->path->unref();
+		delete m_shapes[i];
+	}
+	m_shapes.clear();
+	m_top.clear();
+}
+
+//____________________________________________________________________
+unsigned PickAccelerator::numTriangles() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < m_shapes.size(); ++i)
+		n += m_shapes[i]->triangles.size() / 9;
+	return n;
+}
+
+//____________________________________________________________________
+size_t PickAccelerator::memoryUsage() const
+{
+	size_t bytes = m_top.memoryUsage();
+	for (size_t i = 0; i < m_shapes.size(); ++i)
+		bytes += sizeof(Shape) + m_shapes[i]->triangles.capacity() * sizeof(float) + m_shapes[i]->bvh.memoryUsage();
+	return bytes;
+}
+
+//____________________________________________________________________
+void PickAccelerator::ensureBuilt()
+{
+	if (!m_dirty && !m_topDirty)
+		return;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (m_dirty) {
+		clearShapes();
+		if (m_root)
+			collect(m_root);
+		for (size_t i = 0; i < m_shapes.size(); ++i)
+			buildShapeBvh(m_shapes[i]);
+	} else {
+		for (size_t i = 0; i < m_shapes.size(); ++i)
+			if (m_shapes[i]->dirty)
+				rebuildShape(m_shapes[i]);
+	}
+	buildTop();
+	m_dirty = m_topDirty = false;
+	m_lastBuildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	qDebug() << "PickAccelerator: indexed" << numTriangles() << "triangles in" << numShapes() << "shapes, in"
+	         << m_lastBuildTime << "ms," << memoryUsage() / 1024 << "kB";
+}
+
+//____________________________________________________________________
+void PickAccelerator::collect(SoNode * root)
+{
+	SoCallbackAction action;
+	action.addPreCallback(SoShape::getClassTypeId(), preShapeCB, this);
+	action.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, this);
+	action.apply(root);
+	m_current = 0;
+}
+
+//____________________________________________________________________
+void PickAccelerator::rebuildShape(Shape * shape)
+{
+	// Traverse the path to this shape only, which gives the same
+	// accumulated transformation as the full traversal
+	shape->triangles.clear();
+	m_rebuilding = shape;
+	SoCallbackAction action;
+	action.addPreCallback(SoShape::getClassTypeId(), preShapeCB, this);
+	action.addTriangleCallback(SoShape::getClassTypeId(), triangleCB, this);
+	action.apply(shape->path);
+	m_rebuilding = m_current = 0;
+	buildShapeBvh(shape);
+}
+
+//____________________________________________________________________
+void PickAccelerator::buildShapeBvh(Shape * shape)
+{
+	const size_t numTris = shape->triangles.size() / 9;
+	std::vector<Bvh::Box> boxes(numTris);
+	shape->box.makeEmpty();
+	for (size_t i = 0; i < numTris; ++i) {
+		const float * tri = &shape->triangles[9 * i];
+		boxes[i].extendBy(tri);
+		boxes[i].extendBy(tri + 3);
+		boxes[i].extendBy(tri + 6);
+		shape->box.extendBy(boxes[i]);
+	}
+	shape->bvh.build(boxes);
+	shape->dirty = false;
+}
+
+//____________________________________________________________________
+void PickAccelerator::buildTop()
+{
+	std::vector<Bvh::Box> boxes(m_shapes.size());
+	for (size_t i = 0; i < m_shapes.size(); ++i)
+		boxes[i] = m_shapes[i]->box;
+	m_top.build(boxes, 1);
+}
+
+//____________________________________________________________________
+bool PickAccelerator::pick(const SbLine & ray, Hit & hit)
+{
+	ensureBuilt();
+
+	const SbVec3f & o = ray.getPosition();
+	const SbVec3f & d = ray.getDirection();
+	const float orig[3] = { o[0], o[1], o[2] };
+	const float dir[3] = { d[0], d[1], d[2] };
+
+	// Nearest triangle, first over the shapes, then inside each shape
+	Shape * hitShape = 0;
+	struct TriangleTest {
+		const float * orig;
+		const float * dir;
+		const float * triangles;
+		bool operator()(unsigned i, float & tmax)
+		{
+			float t;
+			if (intersectTriangle(orig, dir, triangles + 9 * i, t) && t < tmax) {
+				tmax = t;
+				return true;
+			}
+			return false;
+		}
+	};
+	struct ShapeTest {
+		const float * orig;
+		const float * dir;
+		const std::vector<Shape*> * shapes;
+		Shape ** hitShape;
+		bool operator()(unsigned i, float & tmax)
+		{
+			Shape * shape = (*shapes)[i];
+			if (shape->triangles.empty())
+				return false;
+			TriangleTest test = { orig, dir, &shape->triangles[0] };
+			if (!shape->bvh.closestHit(orig, dir, tmax, test))
+				return false;
+			*hitShape = shape;
+			return true;
+		}
+	};
+
+	float tmax = FLT_MAX;
+	ShapeTest test = { orig, dir, &m_shapes, &hitShape };
+	if (!m_top.closestHit(orig, dir, tmax, test))
+		return false;
+
+	hit.path = hitShape->path;
+	hit.distance = tmax;
+	hit.point = o + d * tmax;
+	hit.box.setBounds(hitShape->box.min[0], hitShape->box.min[1], hitShape->box.min[2],
+	                  hitShape->box.max[0], hitShape->box.max[1], hitShape->box.max[2]);
+	return true;
+}
+
+//____________________________________________________________________
+SoCallbackAction::Response PickAccelerator::preShapeCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+	PickAccelerator * self = static_cast<PickAccelerator*>(userdata);
+	if (self->m_rebuilding) {
+		self->m_current = self->m_rebuilding;
+		return SoCallbackAction::CONTINUE;
+	}
+	Shape * shape = new Shape;
+	shape->path = action->getCurPath()->copy();
+	shape->path->ref();
+	shape->dirty = false;
+	self->m_shapes.push_back(shape);
+	self->m_current = shape;
+	return SoCallbackAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void PickAccelerator::triangleCB(void * userdata, SoCallbackAction * action,
+                                 const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3)
+{
+	PickAccelerator * self = static_cast<PickAccelerator*>(userdata);
+	if (!self->m_current)
+		return;
+	const SbMatrix & matrix = action->getModelMatrix();
+	const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+	std::vector<float> & tris = self->m_current->triangles;
+	for (int i = 0; i < 3; ++i) {
+		SbVec3f p;
+		matrix.multVecMatrix(v[i]->getPoint(), p);
+		tris.push_back(p[0]);
+		tris.push_back(p[1]);
+		tris.push_back(p[2]);
+	}
+}
+
+//____________________________________________________________________
+void PickAccelerator::sceneChangedCB(void * userdata, SoSensor * sensor)
+{
+	PickAccelerator * self = static_cast<PickAccelerator*>(userdata);
+	if (self->m_dirty)
+		return;
+	SoNode * trigger = static_cast<SoNodeSensor*>(sensor)->getTriggerNode();
+	if (trigger && trigger->isOfType(SoCamera::getClassTypeId()))
+		return;
+
+	// A shape changed: only its own triangles need to be collected again
+	if (trigger && trigger->isOfType(SoShape::getClassTypeId())) {
+		bool found = false;
+		for (size_t i = 0; i < self->m_shapes.size(); ++i) {
+			if (self->m_shapes[i]->path->getTail() == trigger) {
+				self->m_shapes[i]->dirty = true;
+				found = true;
+			}
+		}
+		if (found) {
+			self->m_topDirty = true;
+			return;
+		}
+	}
+	self->m_dirty = true;
+}
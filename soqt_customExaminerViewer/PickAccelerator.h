@@ -0,0 +1,88 @@
+#ifndef PICKACCELERATOR_H
+#define PICKACCELERATOR_H
+
+#include <Inventor/SbLinear.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/actions/SoCallbackAction.h>
+
+#include "Bvh.h"
+
+#include <vector>
+
+class SoNode;
+class SoPath;
+class SoSensor;
+class SoNodeSensor;
+class SoPrimitiveVertex;
+
+// Ray picking on a cached, triangle level spatial index of the scene.
+//
+// Each shape instance (i.e. each path to a shape) gets its own BVH over
+// its triangles, in world coordinates, and a top level BVH is built over
+// the shape bounding boxes. Everything is built on the first pick and
+// then reused: a node sensor on the scene graph invalidates only the
+// changed shape when a shape node is touched, and the whole index for
+// any other change (transformations, coordinates, structure). Camera
+// changes are ignored.
+//
+// Only triangles are indexed: lines, points and text are not pickable.
+class PickAccelerator {
+public:
+	struct Hit {
+		SoPath * path;  // path to the picked shape, owned by the accelerator
+		SbVec3f point;  // world coordinates
+		float distance; // along the ray
+		SbBox3f box;    // world space bounding box of the picked shape
+	};
+
+	PickAccelerator();
+	~PickAccelerator();
+
+	void setSceneGraph(SoNode * root);
+	void invalidate();
+	// Builds (or updates) the index if needed
+	void ensureBuilt();
+
+	// Closest hit along the ray (in world coordinates). The returned
+	// path stays valid until the index is rebuilt.
+	bool pick(const SbLine & ray, Hit & hit);
+
+	unsigned numShapes() const { return m_shapes.size(); }
+	unsigned numTriangles() const;
+	size_t memoryUsage() const;
+	double lastBuildTime() const { return m_lastBuildTime; } // ms
+
+private:
+	struct Shape {
+		SoPath * path;
+		std::vector<float> triangles; // 9 floats per triangle, world coordinates
+		Bvh bvh;
+		Bvh::Box box;
+		bool dirty;
+	};
+
+	SoNode * m_root;
+	SoNodeSensor * m_sensor;
+	std::vector<Shape*> m_shapes;
+	Bvh m_top;
+	bool m_dirty;      // the whole index
+	bool m_topDirty;   // only the top level, after a shape changed
+	double m_lastBuildTime;
+
+	// Filled during a SoCallbackAction traversal
+	Shape * m_current;
+	Shape * m_rebuilding; // set when only one shape is traversed again
+
+	void clearShapes();
+	void collect(SoNode * root);
+	void rebuildShape(Shape * shape);
+	static void buildShapeBvh(Shape * shape);
+	void buildTop();
+
+	static SoCallbackAction::Response preShapeCB(void * userdata, SoCallbackAction * action, const SoNode * node);
+	static void triangleCB(void * userdata, SoCallbackAction * action,
+	                       const SoPrimitiveVertex * v1, const SoPrimitiveVertex * v2, const SoPrimitiveVertex * v3);
+	static void sceneChangedCB(void * userdata, SoSensor * sensor);
+};
+
+#endif
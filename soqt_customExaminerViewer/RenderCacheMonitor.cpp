@@ -0,0 +1,87 @@
+#include "RenderCacheMonitor.h"
+
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+
+//____________________________________________________________________
+RenderCacheMonitor::RenderCacheMonitor()
+: m_builds(0),
+  m_invalidations(0),
+  m_estimatedMemory(0)
+{
+}
+
+//____________________________________________________________________
+void RenderCacheMonitor::reset()
+{
+	m_reached.clear();
+	m_entered.clear();
+	m_replayed.clear();
+	m_previousEntered.clear();
+	m_previousReplayed.clear();
+	m_memory.clear();
+	m_builds = m_invalidations = 0;
+	m_estimatedMemory = 0;
+}
+
+//____________________________________________________________________
+void RenderCacheMonitor::beginFrame()
+{
+	m_previousEntered.swap(m_entered);
+	m_previousReplayed.swap(m_replayed);
+	m_reached.clear();
+	m_entered.clear();
+	m_replayed.clear();
+}
+
+//____________________________________________________________________
+void RenderCacheMonitor::nodeTraversed(const SoPath * path)
+{
+	const int length = path->getLength();
+	if (length == 0)
+		return;
+	SoNode * node = path->getTail();
+	if (node->isOfType(SoSeparator::getClassTypeId()))
+		m_reached.insert(node);
+	if (length > 1) {
+		SoNode * parent = path->getNodeFromTail(1);
+		if (parent->isOfType(SoSeparator::getClassTypeId()))
+			m_entered.insert(parent);
+	}
+}
+
+//____________________________________________________________________
+void RenderCacheMonitor::endFrame(const SbViewportRegion & region)
+{
+	m_estimatedMemory = 0;
+	for (std::set<SoNode *>::const_iterator it = m_reached.begin(); it != m_reached.end(); ++it) {
+		SoNode * node = *it;
+		if (m_entered.count(node) || static_cast<SoSeparator*>(node)->getNumChildren() == 0)
+			continue;
+		m_replayed.insert(node);
+		if (m_previousEntered.count(node))
+			++m_builds;
+		m_estimatedMemory += memoryEstimate(node, region);
+	}
+	for (std::set<SoNode *>::const_iterator it = m_entered.begin(); it != m_entered.end(); ++it)
+		if (m_previousReplayed.count(*it))
+			++m_invalidations;
+}
+
+//____________________________________________________________________
+size_t RenderCacheMonitor::memoryEstimate(SoNode * separator, const SbViewportRegion & region)
+{
+	std::map<SoNode *, size_t>::const_iterator it = m_memory.find(separator);
+	if (it != m_memory.end())
+		return it->second;
+	SoGetPrimitiveCountAction count(region);
+	count.apply(separator);
+	// A position and a normal (6 floats) per vertex in the display list
+	const size_t vertices = 3 * size_t(count.getTriangleCount()) + 2 * size_t(count.getLineCount())
+	                        + size_t(count.getPointCount());
+	const size_t bytes = vertices * 6 * sizeof(float);
+	m_memory[separator] = bytes;
+	return bytes;
+}
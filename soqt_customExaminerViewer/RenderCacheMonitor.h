@@ -0,0 +1,57 @@
+#ifndef RENDERCACHEMONITOR_H
+#define RENDERCACHEMONITOR_H
+
+#include <map>
+#include <set>
+
+class SoNode;
+class SoPath;
+class SbViewportRegion;
+
+// Watches the render traversal to tell which separators are drawn from
+// their render caches (display lists), and how often those are built and
+// thrown away.
+//
+// Coin has no public API for its caches, so this is inferred from what
+// the render action visits: a separator that is reached but whose
+// children are not traversed was replayed from its cache (or culled). A
+// separator traversed in full in one frame and replayed in the next one
+// built its cache; the other way round, its cache was invalidated.
+//
+// The memory held by the caches is an estimate from the primitives below
+// the replayed separators (positions and normals of each vertex), not
+// something Coin reports.
+class RenderCacheMonitor {
+public:
+	RenderCacheMonitor();
+
+	void beginFrame();
+	// Call for each node the render action is about to traverse
+	void nodeTraversed(const SoPath * path);
+	void endFrame(const SbViewportRegion & region);
+
+	// The scene changed: the memory estimates must be redone
+	void invalidate() { m_memory.clear(); }
+	void reset();
+
+	unsigned replayedSeparators() const { return m_replayed.size(); }
+	unsigned traversedSeparators() const { return m_entered.size(); }
+	unsigned long cacheBuilds() const { return m_builds; }
+	unsigned long cacheInvalidations() const { return m_invalidations; }
+	size_t estimatedMemory() const { return m_estimatedMemory; } // bytes
+
+private:
+	std::set<SoNode *> m_reached;
+	std::set<SoNode *> m_entered;
+	std::set<SoNode *> m_replayed;
+	std::set<SoNode *> m_previousEntered;
+	std::set<SoNode *> m_previousReplayed;
+	std::map<SoNode *, size_t> m_memory;
+	unsigned long m_builds;
+	unsigned long m_invalidations;
+	size_t m_estimatedMemory;
+
+	size_t memoryEstimate(SoNode * separator, const SbViewportRegion & region);
+};
+
+#endif
@@ -0,0 +1,201 @@
+#include "RenderProfiler.h"
+#include "GroupTraversal.h"
+
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/system/gl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed(const Clock::time_point & start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string label(SoNode * node, int index)
+{
+	const SbName name = node->getName();
+	std::ostringstream s;
+	if (name.getLength() > 0)
+		s << name.getString();
+	else
+		s << node->getTypeId().getName().getString() << "#" << index;
+	std::string l = s.str();
+	std::replace(l.begin(), l.end(), ';', '_'); // the frame separator of the folded format
+	std::replace(l.begin(), l.end(), ' ', '_');
+	return l;
+}
+
+}
+
+
+SO_NODE_SOURCE(RenderProfiler);
+
+//____________________________________________________________________
+void RenderProfiler::initClass()
+{
+	if (getClassTypeId() == SoType::badType()) {
+		SO_NODE_INIT_CLASS(RenderProfiler, SoSeparator, "Separator");
+	}
+}
+
+//____________________________________________________________________
+RenderProfiler::RenderProfiler()
+: m_frames(0)
+{
+	SO_NODE_CONSTRUCTOR(RenderProfiler);
+	SO_NODE_ADD_FIELD(profiling, (FALSE));
+	SO_NODE_ADD_FIELD(finishEachNode, (FALSE));
+	reset();
+}
+
+//____________________________________________________________________
+RenderProfiler::~RenderProfiler()
+{
+}
+
+//____________________________________________________________________
+void RenderProfiler::reset()
+{
+	m_entries.clear();
+	m_index.clear();
+	m_frames = 0;
+	Entry root = { "frame", -1, 0.0, 0.0, 0 };
+	m_entries.push_back(root);
+}
+
+//____________________________________________________________________
+int RenderProfiler::entry(int parent, const std::string & label)
+{
+	const std::pair<int, std::string> key(parent, label);
+	std::map<std::pair<int, std::string>, int>::const_iterator it = m_index.find(key);
+	if (it != m_index.end())
+		return it->second;
+	Entry e = { label, parent, 0.0, 0.0, 0 };
+	m_entries.push_back(e);
+	m_index[key] = m_entries.size() - 1;
+	return m_entries.size() - 1;
+}
+
+//____________________________________________________________________
+void RenderProfiler::GLRenderBelowPath(SoGLRenderAction * action)
+{
+	if (!profiling.getValue()) {
+		SoSeparator::GLRenderBelowPath(action);
+		return;
+	}
+
+	SoState * state = action->getState();
+	SoCacheElement::invalidate(state); // this frame must not end up in a render cache above us
+	if (finishEachNode.getValue())
+		::glFinish();
+	const Clock::time_point start = Clock::now();
+	state->push();
+	GroupTraversal::renderChildren(this, action, [=](SoNode * child, int i) { renderChild(child, i, 0, action); });
+	state->pop();
+	if (finishEachNode.getValue())
+		::glFinish();
+	m_entries[0].time += elapsed(start);
+	m_entries[0].calls++;
+	m_frames++;
+}
+
+//____________________________________________________________________
+void RenderProfiler::renderChild(SoNode * child, int index, int parent, SoGLRenderAction * action)
+{
+	const int e = entry(parent, label(child, index));
+	const Clock::time_point start = Clock::now();
+	if (GroupTraversal::isPlain(child)) {
+		GroupTraversal::open(static_cast<SoGroup*>(child), action,
+		                     [=](SoNode * grandChild, int i) { renderChild(grandChild, i, e, action); });
+	} else {
+		child->GLRenderBelowPath(action);
+		if (finishEachNode.getValue())
+			::glFinish();
+	}
+	const double ms = elapsed(start);
+	m_entries[e].time += ms;
+	m_entries[e].calls++;
+	m_entries[parent].childTime += ms;
+}
+
+//____________________________________________________________________
+std::string RenderProfiler::stack(int e) const
+{
+	std::string s = m_entries[e].label;
+	for (int p = m_entries[e].parent; p >= 0; p = m_entries[p].parent)
+		s = m_entries[p].label + ";" + s;
+	return s;
+}
+
+//____________________________________________________________________
+bool RenderProfiler::writeFolded(const std::string & filename) const
+{
+	std::ofstream out(filename.c_str());
+	if (!out)
+		return false;
+	for (size_t i = 0; i < m_entries.size(); ++i) {
+		const long us = long(1000.0 * std::max(0.0, m_entries[i].time - m_entries[i].childTime) + 0.5);
+		if (us > 0)
+			out << stack(i) << " " << us << "\n";
+	}
+	return bool(out);
+}
+
+//____________________________________________________________________
+void RenderProfiler::writeTree(std::ostream & out, int e, int depth, const std::vector<std::vector<int> > & children) const
+{
+	const double frames = m_frames ? m_frames : 1;
+	const Entry & current = m_entries[e];
+	char line[64];
+	snprintf(line, sizeof(line), "%10.4f %10.4f  ", current.time / frames, (current.time - current.childTime) / frames);
+	out << line << std::string(2 * depth, ' ') << current.label << "\n";
+
+	// Children by decreasing time
+	std::vector<std::pair<double, int> > sorted;
+	for (size_t i = 0; i < children[e].size(); ++i)
+		sorted.push_back(std::make_pair(-m_entries[children[e][i]].time, children[e][i]));
+	std::sort(sorted.begin(), sorted.end());
+	for (size_t i = 0; i < sorted.size(); ++i)
+		writeTree(out, sorted[i].second, depth + 1, children);
+}
+
+//____________________________________________________________________
+bool RenderProfiler::writeReport(const std::string & filename) const
+{
+	std::ofstream out(filename.c_str());
+	if (!out)
+		return false;
+	out << "# " << m_frames << " frames" << (finishEachNode.getValue() ? ", glFinish after each node" : "") << "\n";
+	out << "# total[ms]  self[ms]  (per frame)\n";
+	std::vector<std::vector<int> > children(m_entries.size());
+	for (size_t i = 1; i < m_entries.size(); ++i)
+		children[m_entries[i].parent].push_back(i);
+	writeTree(out, 0, 0, children);
+	return bool(out);
+}
+
+//____________________________________________________________________
+void RenderProfiler::printSummary(unsigned count) const
+{
+	const double frames = m_frames ? m_frames : 1;
+	std::vector<std::pair<double, int> > self;
+	for (size_t i = 1; i < m_entries.size(); ++i)
+		self.push_back(std::make_pair(-(m_entries[i].time - m_entries[i].childTime), int(i)));
+	std::sort(self.begin(), self.end());
+	printf("# %u frames, %.3f ms per frame\n", m_frames, m_entries[0].time / frames);
+	printf("# self[ms]  node\n");
+	for (size_t i = 0; i < self.size() && i < count; ++i)
+		printf("%10.4f  %s\n", -self[i].first / frames, stack(self[i].second).c_str());
+	fflush(stdout);
+}
@@ -0,0 +1,73 @@
+#ifndef RENDERPROFILER_H
+#define RENDERPROFILER_H
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/fields/SoSFBool.h>
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A separator which, when profiling is on, times the rendering of each
+// node below it.
+//
+// The render traversal is done by the profiler itself: it walks down
+// through the plain SoGroups and SoSeparators and times each child in
+// turn, so the render caches of those separators are not used while
+// profiling. Any other node (shapes, property nodes, switches, kits,
+// ...) is timed as a whole. With finishEachNode on, glFinish() drains the
+// GL pipeline after each node, so the times include the GPU work of the
+// node and not only the submission of its GL calls; that makes the frame
+// itself much slower.
+//
+// Times are accumulated over the frames rendered until reset(). They are
+// written either as a tree (writeReport) or as "folded stacks", one line
+// per path with its self time in microseconds, as read by flamegraph.pl
+// and speedscope (writeFolded). Nodes are labelled with their name if
+// they have one, and with their type and index in their parent otherwise.
+//
+// The node needs initClass() after SoDB::init().
+class RenderProfiler : public SoSeparator {
+	SO_NODE_HEADER(RenderProfiler);
+
+public:
+	static void initClass();
+	RenderProfiler();
+
+	SoSFBool profiling;
+	SoSFBool finishEachNode;
+
+	void reset();
+	unsigned numFrames() const { return m_frames; }
+
+	bool writeFolded(const std::string & filename) const;
+	bool writeReport(const std::string & filename) const;
+	// The 'count' nodes with the largest self time, per frame, on stdout
+	void printSummary(unsigned count = 20) const;
+
+	virtual void GLRenderBelowPath(SoGLRenderAction * action);
+
+protected:
+	virtual ~RenderProfiler();
+
+private:
+	struct Entry {
+		std::string label;
+		int parent;
+		double time; // ms, including the children
+		double childTime;
+		unsigned long calls;
+	};
+	std::vector<Entry> m_entries; // entry 0 is this node
+	std::map<std::pair<int, std::string>, int> m_index;
+	unsigned m_frames;
+
+	int entry(int parent, const std::string & label);
+	void renderChild(SoNode * child, int index, int parent, SoGLRenderAction * action);
+	std::string stack(int entry) const;
+	void writeTree(std::ostream & out, int entry, int depth, const std::vector<std::vector<int> > & children) const;
+};
+
+#endif
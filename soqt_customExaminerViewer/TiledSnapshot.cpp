@@ -0,0 +1,209 @@
+#include "TiledSnapshot.h"
+
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoFrustumCamera.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+
+#include <QImage>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(const Clock::time_point & start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Encodes and writes one tile, on a worker thread
+class TileWriter : public QRunnable {
+public:
+	TileWriter(const QImage & image, const std::string & filename, QSemaphore * inFlight)
+	: m_image(image), m_filename(filename), m_inFlight(inFlight) {}
+
+	void run()
+	{
+		const Clock::time_point start = Clock::now();
+		if (!m_image.save(QString::fromStdString(m_filename), "PNG"))
+			fprintf(stderr, "TiledSnapshot: could not write %s\n", m_filename.c_str());
+		printf("  %s: encoded and written in %.1f ms\n", m_filename.c_str(), msSince(start));
+		m_inFlight->release();
+	}
+
+private:
+	QImage m_image;
+	std::string m_filename;
+	QSemaphore * m_inFlight;
+};
+
+}
+
+
+//____________________________________________________________________
+TiledSnapshot::TiledSnapshot(unsigned tileSize, int numThreads)
+: m_tileSize(tileSize),
+  m_numThreads(numThreads > 0 ? numThreads : QThread::idealThreadCount()),
+  m_background(0, 0, 0),
+  m_smoothing(false),
+  m_numPasses(1)
+{
+	const SbVec2s maxRes = SoOffscreenRenderer::getMaximumResolution();
+	const unsigned maxTile = std::min(maxRes[0], maxRes[1]);
+	if (maxTile > 0 && m_tileSize > maxTile)
+		m_tileSize = maxTile;
+	if (m_numThreads < 1)
+		m_numThreads = 1;
+}
+
+//____________________________________________________________________
+bool TiledSnapshot::render(SoNode * scene, const SoCamera * camera,
+                           unsigned width, unsigned height, const std::string & prefix)
+{
+	const bool perspective = camera->isOfType(SoPerspectiveCamera::getClassTypeId());
+	if (!perspective && !camera->isOfType(SoOrthographicCamera::getClassTypeId())) {
+		fprintf(stderr, "TiledSnapshot: unsupported camera type %s\n", camera->getTypeId().getName().getString());
+		return false;
+	}
+	if (!width || !height)
+		return false;
+
+	const unsigned tile = m_tileSize;
+	const unsigned columns = (width + tile - 1) / tile;
+	const unsigned rows = (height + tile - 1) / tile;
+	printf("TiledSnapshot: %ux%u image, %ux%u tiles of %ux%u pixels, %d encoder threads\n",
+	       width, height, columns, rows, tile, tile, m_numThreads);
+
+	// Extent of the whole image on the near plane (perspective) or in
+	// world units (orthographic), following the ADJUST_CAMERA mapping of
+	// the viewers: the height is kept, unless the image is taller than wide.
+	const float aspect = static_cast<float>(width) / static_cast<float>(height);
+	float halfHeight;
+	if (perspective)
+		halfHeight = camera->nearDistance.getValue()
+		           * std::tan(static_cast<const SoPerspectiveCamera*>(camera)->heightAngle.getValue() / 2.0f);
+	else
+		halfHeight = static_cast<const SoOrthographicCamera*>(camera)->height.getValue() / 2.0f;
+	if (aspect < 1.0f)
+		halfHeight /= aspect;
+	const float halfWidth = halfHeight * aspect;
+
+	SbVec3f rightDir, upDir, viewDir;
+	const SbRotation orientation = camera->orientation.getValue();
+	orientation.multVec(SbVec3f(1, 0, 0), rightDir);
+	orientation.multVec(SbVec3f(0, 1, 0), upDir);
+	orientation.multVec(SbVec3f(0, 0, -1), viewDir);
+
+	SoSeparator * root = new SoSeparator;
+	root->ref();
+	SoFrustumCamera * frustumCamera = 0;
+	SoOrthographicCamera * orthoCamera = 0;
+	if (perspective) {
+		frustumCamera = new SoFrustumCamera;
+		frustumCamera->position = camera->position.getValue();
+		frustumCamera->orientation = orientation;
+		frustumCamera->nearDistance = camera->nearDistance.getValue();
+		frustumCamera->farDistance = camera->farDistance.getValue();
+		frustumCamera->focalDistance = camera->focalDistance.getValue();
+		frustumCamera->viewportMapping = SoCamera::LEAVE_ALONE;
+		root->addChild(frustumCamera);
+	} else {
+		orthoCamera = new SoOrthographicCamera;
+		orthoCamera->orientation = orientation;
+		orthoCamera->nearDistance = camera->nearDistance.getValue();
+		orthoCamera->farDistance = camera->farDistance.getValue();
+		orthoCamera->focalDistance = camera->focalDistance.getValue();
+		orthoCamera->aspectRatio = 1.0f; // square tiles
+		orthoCamera->height = 2.0f * halfHeight * tile / height;
+		orthoCamera->viewportMapping = SoCamera::LEAVE_ALONE;
+		root->addChild(orthoCamera);
+	}
+	SoDirectionalLight * headlight = new SoDirectionalLight;
+	headlight->direction = viewDir;
+	root->addChild(headlight);
+	root->addChild(scene);
+
+	// One renderer, one viewport size: the GL context is made once for all tiles
+	SoOffscreenRenderer renderer(SbViewportRegion(tile, tile));
+	renderer.setComponents(SoOffscreenRenderer::RGB);
+	renderer.setBackgroundColor(m_background);
+	renderer.getGLRenderAction()->setSmoothing(m_smoothing);
+	renderer.getGLRenderAction()->setNumPasses(m_numPasses);
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(m_numThreads);
+	// Bound the number of tiles waiting for the encoders, to bound memory
+	QSemaphore inFlight(2 * m_numThreads);
+
+	std::ofstream index((prefix + "_tiles.txt").c_str());
+	index << "# " << width << "x" << height << " image, " << columns << " columns x " << rows << " rows\n";
+
+	bool ok = true;
+	double renderTotal = 0.0;
+	const Clock::time_point start = Clock::now();
+	for (unsigned r = 0; r < rows && ok; ++r) {
+		for (unsigned c = 0; c < columns && ok; ++c) {
+			const unsigned x0 = c * tile;
+			const unsigned y0 = r * tile; // from the top of the image
+			const unsigned cropW = std::min(tile, width - x0);
+			const unsigned cropH = std::min(tile, height - y0);
+
+			if (perspective) {
+				// Sub-frustum of this tile, on the near plane
+				frustumCamera->left = -halfWidth + 2.0f * halfWidth * x0 / width;
+				frustumCamera->right = -halfWidth + 2.0f * halfWidth * (x0 + tile) / width;
+				frustumCamera->top = halfHeight - 2.0f * halfHeight * y0 / height;
+				frustumCamera->bottom = halfHeight - 2.0f * halfHeight * (y0 + tile) / height;
+			} else {
+				const float cx = -halfWidth + 2.0f * halfWidth * (x0 + tile / 2.0f) / width;
+				const float cy = halfHeight - 2.0f * halfHeight * (y0 + tile / 2.0f) / height;
+				orthoCamera->position = camera->position.getValue() + rightDir * cx + upDir * cy;
+			}
+
+			const Clock::time_point tileStart = Clock::now();
+			if (!renderer.render(root)) {
+				fprintf(stderr, "TiledSnapshot: could not render tile r%u c%u\n", r, c);
+				ok = false;
+				break;
+			}
+			const double renderMs = msSince(tileStart);
+			renderTotal += renderMs;
+
+			// Copy the visible part out of the renderer buffer, flipping it
+			// (GL rows go bottom-up), so the renderer can go on with the next tile
+			inFlight.acquire();
+			QImage image(cropW, cropH, QImage::Format_RGB888);
+			const unsigned char * buffer = renderer.getBuffer();
+			for (unsigned y = 0; y < cropH; ++y)
+				memcpy(image.scanLine(y), buffer + (tile - 1 - y) * tile * 3, cropW * 3);
+
+			char filename[64];
+			snprintf(filename, sizeof(filename), "_r%03u_c%03u.png", r, c);
+			const std::string tileFile = prefix + filename;
+			index << tileFile << " " << x0 << " " << y0 << " " << cropW << " " << cropH << "\n";
+			printf("  tile r%u c%u: rendered in %.1f ms\n", r, c, renderMs);
+			pool.start(new TileWriter(image, tileFile, &inFlight));
+		}
+	}
+	pool.waitForDone();
+	printf("TiledSnapshot: %u tiles, %.1f ms rendering, %.1f ms total\n",
+	       rows * columns, renderTotal, msSince(start));
+	fflush(stdout);
+
+	root->unref();
+	return ok;
+}
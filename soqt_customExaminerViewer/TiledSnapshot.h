@@ -0,0 +1,50 @@
+#ifndef TILEDSNAPSHOT_H
+#define TILEDSNAPSHOT_H
+
+#include <Inventor/SbColor.h>
+
+#include <string>
+
+class SoNode;
+class SoCamera;
+
+// Renders snapshots of arbitrary size (e.g. 16384 x 16384 for posters)
+// by splitting the image in square tiles.
+//
+// All the tiles are rendered by the same SoOffscreenRenderer, with the
+// same viewport size, so the GL context (and the render caches in it)
+// is created once and reused. Each tile is rendered through its own
+// sub-frustum of the camera; the pixels are then handed to a thread
+// pool which encodes and writes the PNG files, so that encoding
+// overlaps with the rendering of the next tiles.
+//
+// The tiles are written as <prefix>_r<row>_c<column>.png, row 0 being
+// the top of the image, plus a <prefix>_tiles.txt index file. They can
+// be stitched with e.g. ImageMagick:
+//   montage <prefix>_r*_c*.png -tile <columns>x -geometry +0+0 poster.png
+class TiledSnapshot {
+public:
+	// tileSize is clamped to the maximum offscreen resolution;
+	// numThreads 0 means one encoder thread per core.
+	TiledSnapshot(unsigned tileSize = 2048, int numThreads = 0);
+
+	void setBackgroundColor(const SbColor & color) { m_background = color; }
+	// Same meaning as SoQtViewer::setAntialiasing(); the passes are
+	// accumulated offscreen, so they work without multisample buffers.
+	void setAntialiasing(bool smoothing, int numPasses) { m_smoothing = smoothing; m_numPasses = numPasses; }
+
+	// The scene must not contain a camera: the camera is used to set up
+	// the view (only perspective and orthographic cameras are supported).
+	// Prints the render and encoding time of each tile to stdout.
+	bool render(SoNode * scene, const SoCamera * camera,
+	            unsigned width, unsigned height, const std::string & prefix);
+
+private:
+	unsigned m_tileSize;
+	int m_numThreads;
+	SbColor m_background;
+	bool m_smoothing;
+	int m_numPasses;
+};
+
+#endif
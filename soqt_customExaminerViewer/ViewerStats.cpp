@@ -0,0 +1,155 @@
+#include "ViewerStats.h"
+#include "FrameTiming.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+//____________________________________________________________________
+ViewerStats::ViewerStats(unsigned windowSize)
+: m_frameTimes(windowSize ? windowSize : 1, 0.0),
+  m_next(0),
+  m_count(0),
+  m_totalFrames(0)
+{
+}
+
+//____________________________________________________________________
+void ViewerStats::beginFrame()
+{
+	m_frameStart = Clock::now();
+}
+
+//____________________________________________________________________
+void ViewerStats::endFrame()
+{
+	addFrameTime(std::chrono::duration<double, std::milli>(Clock::now() - m_frameStart).count());
+}
+
+//____________________________________________________________________
+void ViewerStats::addFrameTime(double ms)
+{
+	m_frameTimes[m_next] = ms;
+	m_next = (m_next + 1) % m_frameTimes.size();
+	if (m_count < m_frameTimes.size())
+		++m_count;
+	++m_totalFrames;
+}
+
+//____________________________________________________________________
+void ViewerStats::reset()
+{
+	m_next = m_count = m_totalFrames = 0;
+	m_counters.clear();
+}
+
+//____________________________________________________________________
+double ViewerStats::lastFrameTime() const
+{
+	if (!m_count)
+		return 0.0;
+	return m_frameTimes[(m_next + m_frameTimes.size() - 1) % m_frameTimes.size()];
+}
+
+//____________________________________________________________________
+double ViewerStats::fps() const
+{
+	// From the mean frame time over the window: the rate the renderer can
+	// sustain. The wall clock between frames would count the time the
+	// viewer is idle, waiting for events, as slow frames.
+	double sum = 0.0;
+	for (unsigned i = 0; i < m_count; ++i)
+		sum += m_frameTimes[i];
+	return sum > 0.0 ? 1000.0 * m_count / sum : 0.0;
+}
+
+//____________________________________________________________________
+std::vector<double> ViewerStats::window() const
+{
+	std::vector<double> v;
+	v.reserve(m_count);
+	const unsigned size = m_frameTimes.size();
+	const unsigned first = (m_next + size - m_count) % size;
+	for (unsigned i = 0; i < m_count; ++i)
+		v.push_back(m_frameTimes[(first + i) % size]);
+	return v;
+}
+
+//____________________________________________________________________
+double ViewerStats::percentile(double p) const
+{
+	return FrameTiming::percentile(window(), p);
+}
+
+//____________________________________________________________________
+double ViewerStats::counter(const std::string & name) const
+{
+	std::map<std::string, double>::const_iterator it = m_counters.find(name);
+	return it == m_counters.end() ? 0.0 : it->second;
+}
+
+//____________________________________________________________________
+std::string ViewerStats::summary() const
+{
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(1);
+	out << "FPS: " << fps() << "\n";
+	out << "frame [ms] p50: " << percentile(50) << "  p95: " << percentile(95) << "  p99: " << percentile(99)
+	    << "  (" << m_count << " frames)\n";
+	out << std::setprecision(0);
+	for (std::map<std::string, double>::const_iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+		out << it->first << ": " << it->second << "\n";
+	return out.str();
+}
+
+//____________________________________________________________________
+std::string ViewerStats::toCSV() const
+{
+	std::ostringstream out;
+	out << std::setprecision(6);
+	out << "# fps," << fps() << "\n";
+	out << "# p50_ms," << percentile(50) << "\n";
+	out << "# p95_ms," << percentile(95) << "\n";
+	out << "# p99_ms," << percentile(99) << "\n";
+	for (std::map<std::string, double>::const_iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+		out << "# " << it->first << "," << it->second << "\n";
+	out << "frame,time_ms\n";
+	const std::vector<double> v = window();
+	for (size_t i = 0; i < v.size(); ++i)
+		out << i << "," << v[i] << "\n";
+	return out.str();
+}
+
+//____________________________________________________________________
+std::string ViewerStats::toJSON() const
+{
+	std::ostringstream out;
+	out << std::setprecision(6);
+	out << "{\n";
+	out << "  \"fps\": " << fps() << ",\n";
+	out << "  \"frame_time_ms\": { \"p50\": " << percentile(50) << ", \"p95\": " << percentile(95)
+	    << ", \"p99\": " << percentile(99) << " },\n";
+	out << "  \"counters\": {";
+	for (std::map<std::string, double>::const_iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+		out << (it == m_counters.begin() ? "\n" : ",\n") << "    \"" << it->first << "\": " << it->second;
+	out << "\n  },\n";
+	out << "  \"frames_ms\": [";
+	const std::vector<double> v = window();
+	for (size_t i = 0; i < v.size(); ++i)
+		out << (i ? ", " : "") << v[i];
+	out << "]\n}\n";
+	return out.str();
+}
+
+//____________________________________________________________________
+bool ViewerStats::exportToFile(const std::string & filename) const
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+		return false;
+	const bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+	file << (json ? toJSON() : toCSV());
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,65 @@
+#ifndef VIEWERSTATS_H
+#define VIEWERSTATS_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+// Rendering statistics collected by the CustomExaminerViewer.
+//
+// Frame times are kept in a fixed-size sliding window (a ring buffer),
+// so percentiles always describe the most recent frames only.
+// Other features of the viewer can publish their own numbers through
+// the named counters, which are then shown in the overlay and exported
+// together with the frame times.
+class ViewerStats {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	ViewerStats(unsigned windowSize = 240);
+
+	// Call around each rendered frame
+	void beginFrame();
+	void endFrame();
+
+	// Record a frame time measured elsewhere (e.g. offscreen replay)
+	void addFrameTime(double ms);
+
+	void reset();
+
+	unsigned numFrames() const { return m_count; }
+	unsigned totalFrames() const { return m_totalFrames; }
+	double lastFrameTime() const; // ms
+	double fps() const;          // from the mean frame time over the window
+	double percentile(double p) const; // p in [0,100], over the frame-time window, in ms
+
+	// Named counters published by the different viewer features
+	void setCounter(const std::string & name, double value) { m_counters[name] = value; }
+	void addToCounter(const std::string & name, double value) { m_counters[name] += value; }
+	double counter(const std::string & name) const;
+	const std::map<std::string, double> & counters() const { return m_counters; }
+
+	// Multi-line human readable summary, used by the overlay
+	std::string summary() const;
+
+	// Export the window of frame times plus the counters.
+	// The format is chosen from the file extension (".json" or ".csv").
+	bool exportToFile(const std::string & filename) const;
+	std::string toCSV() const;
+	std::string toJSON() const;
+
+private:
+	std::vector<double> m_frameTimes; // ring buffer, ms
+	unsigned m_next;
+	unsigned m_count;
+	unsigned m_totalFrames;
+
+	Clock::time_point m_frameStart;
+
+	std::map<std::string, double> m_counters;
+
+	std::vector<double> window() const; // frame times in chronological order
+};
+
+#endif
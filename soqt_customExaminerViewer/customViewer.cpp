@@ -1,13 +1,75 @@
 
 #include "customViewer.h"
+#include "TiledSnapshot.h"
+#include "OcclusionCullingGroup.h"
+#include "RenderProfiler.h"
+#include "FrameTiming.h"
 
 #include <Inventor/SbBasic.h> 
 #include <Inventor/events/SoMouseButtonEvent.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoCamera.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoFont.h>
+#include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoDrawStyle.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedLineSet.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/sensors/SoAlarmSensor.h>
+#include <Inventor/system/gl.h>
+#include <Inventor/C/glue/gl.h>
 
 #include <QWidget>
 #include <QMenu>
+#include <QActionGroup>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QLineEdit>
 #include <QtDebug>
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#if !defined(GL_MULTISAMPLE) && defined(GL_MULTISAMPLE_ARB)
+#define GL_MULTISAMPLE GL_MULTISAMPLE_ARB
+#endif
+
+namespace {
+
+// Nodes per path, the children of a switch only if it traverses them
+// (an inherited whichChild counts as all)
+unsigned countNodes(SoNode * node)
+{
+	unsigned count = 1;
+	SoChildList * children = node->getChildren();
+	if (!children)
+		return count;
+	int which = SO_SWITCH_ALL;
+	if (node->isOfType(SoSwitch::getClassTypeId()) &&
+	    static_cast<SoSwitch*>(node)->whichChild.getValue() != SO_SWITCH_INHERIT)
+		which = static_cast<SoSwitch*>(node)->whichChild.getValue();
+	for (int i = 0; i < children->getLength(); ++i)
+		if (which == SO_SWITCH_ALL || which == i)
+			count += countNodes((*children)[i]);
+	return count;
+}
+
+}
 
 //____________________________________________________________________
 CustomExaminerViewer::CustomExaminerViewer(QWidget * parent,
@@ -18,9 +80,78 @@ CustomExaminerViewer::CustomExaminerViewer(QWidget * parent,
 		SoQtViewer::Type type)
 : SoQtExaminerViewer(parent,(name?name:"CustomExaminerViewer"),embed,flag,type),
   m_popup_menu(0),
-  m_popup_antiAliasAction(0)
+  m_popup_antiAliasAction(0),
+  m_popup_statsAction(0),
+  m_popup_exportStatsAction(0),
+  m_popup_fastInteractionAction(0),
+  m_popup_recordPathAction(0),
+  m_popup_replayPathAction(0),
+  m_popup_snapshotAction(0),
+  m_popup_profileAction(0),
+  m_popup_profileFinishAction(0),
+  m_popup_fastPickingAction(0),
+  m_popup_occlusionCullingAction(0),
+  m_popup_cachedBoundsAction(0),
+  m_popup_cachingMenu(0),
+  m_popup_renderCachingAction(0),
+  m_popup_separatorCachingGroup(0),
+  m_popup_vboAction(0),
+  m_isantialias(false),
+  m_showStats(false),
+  m_hudRoot(0),
+  m_hudTranslation(0),
+  m_hudText(0),
+  m_sceneSensor(0),
+  m_primitiveCountsDirty(true),
+  m_traversedNodes(0),
+  m_fastInteraction(false),
+  m_interacting(false),
+  m_interactiveBBox(false),
+  m_slowInteractiveFrames(0),
+  m_interactiveFrameBudget(1000.0/30.0),
+  m_restoreQualitySensor(0),
+  m_cameraPathFile("camera_path.txt"),
+  m_replaying(false),
+  m_coalesceEvents(true),
+  m_maxFrameRate(60.0),
+  m_hasPendingMotion(false),
+  m_motionSensor(0),
+  m_fastPicking(true),
+  m_selectedPath(0),
+  m_hoveredPath(0),
+  m_highlightRoot(0),
+  m_highlightColor(0),
+  m_highlightCoords(0),
+  m_cullingRoot(0),
+  m_profiler(0),
+  m_numRenderCaches(SoSeparator::getNumRenderCaches()),
+  m_glHasVBO(false),
+  m_vboMinVertices(SoGLVBOElement::getVertexCountMinLimit()),
+  m_cachedBounds(false)
 {
     qDebug() << "Running the 'CustomExaminerViewer' constructor";
+
+    m_sceneSensor = new SoNodeSensor(sceneChangedCB, this);
+    m_sceneSensor->setPriority(0); // immediate, so that the trigger node is known in the callback
+    getGLRenderAction()->setAbortCallback(countTraversedNodeCB, this);
+
+    m_restoreQualitySensor = new SoAlarmSensor(restoreQualityCB, this);
+    addStartCallback(interactionStartCB, this);
+    addFinishCallback(interactionFinishCB, this);
+    setFastInteraction(true);
+
+    m_motionSensor = new SoAlarmSensor(motionCB, this);
+
+    OcclusionCullingGroup::initClass();
+    m_cullingRoot = new OcclusionCullingGroup;
+    m_cullingRoot->ref();
+    m_cullingRoot->occlusionCulling = FALSE;
+
+    RenderProfiler::initClass();
+    m_profiler = new RenderProfiler;
+    m_profiler->ref();
+
+    setCachedBounds(true);
 }
 
 
@@ -32,7 +163,25 @@ CustomExaminerViewer::~CustomExaminerViewer()
 	delete prefmenu;
 #endif
 	//delete m_d;
+	m_sceneSensor->detach();
+	delete m_sceneSensor;
+	removeStartCallback(interactionStartCB, this);
+	removeFinishCallback(interactionFinishCB, this);
+	m_restoreQualitySensor->unschedule();
+	delete m_restoreQualitySensor;
+	m_motionSensor->unschedule();
+	delete m_motionSensor;
+	if (m_selectedPath)
+		m_selectedPath->unref();
+	if (m_hoveredPath)
+		m_hoveredPath->unref();
+	if (m_highlightRoot)
+		m_highlightRoot->unref();
+	if (m_hudRoot)
+		m_hudRoot->unref();
 	SoQtExaminerViewer::setSceneGraph(0);
+	m_cullingRoot->unref();
+	m_profiler->unref();
 }
 
 //____________________________________________________________________
@@ -49,6 +198,51 @@ bool CustomExaminerViewer::ensureMenuInit()
 
 	m_popup_antiAliasAction = m_popup_menu->addAction("&Anti aliasing [A]");
     m_popup_antiAliasAction->setCheckable(true);
+
+    m_popup_cachingMenu = m_popup_menu->addMenu("Render &caching");
+    m_popup_renderCachingAction = m_popup_cachingMenu->addAction("Render caches (all separators)");
+    m_popup_renderCachingAction->setCheckable(true);
+    m_popup_cachingMenu->addSeparator();
+    m_popup_separatorCachingGroup = new QActionGroup(m_popup_cachingMenu);
+    const char * policies[3] = { "Selected separator: no cache (vertex arrays)",
+                                 "Selected separator: always cache (display list)",
+                                 "Selected separator: auto" };
+    for (int i = 0; i < 3; ++i) {
+        m_popup_separatorCachingActions[i] = m_popup_cachingMenu->addAction(policies[i]);
+        m_popup_separatorCachingActions[i]->setCheckable(true);
+        m_popup_separatorCachingGroup->addAction(m_popup_separatorCachingActions[i]);
+    }
+    m_popup_cachingMenu->addSeparator();
+    m_popup_vboAction = m_popup_cachingMenu->addAction("");
+    m_popup_vboAction->setCheckable(true);
+    m_popup_fastInteractionAction = m_popup_menu->addAction("&Fast interaction [I]");
+    m_popup_fastInteractionAction->setCheckable(true);
+    m_popup_fastPickingAction = m_popup_menu->addAction("Fast &picking");
+    m_popup_fastPickingAction->setCheckable(true);
+    m_popup_occlusionCullingAction = m_popup_menu->addAction("&Occlusion culling");
+    m_popup_occlusionCullingAction->setCheckable(true);
+    m_popup_cachedBoundsAction = m_popup_menu->addAction("Cached &bounds (view all, clipping)");
+    m_popup_cachedBoundsAction->setCheckable(true);
+
+    m_popup_menu->addSeparator();
+    m_popup_statsAction = m_popup_menu->addAction("&Statistics overlay [H]");
+    m_popup_statsAction->setCheckable(true);
+    m_popup_exportStatsAction = m_popup_menu->addAction("&Export statistics...");
+
+    m_popup_menu->addSeparator();
+    m_popup_recordPathAction = m_popup_menu->addAction("&Record camera path [R]");
+    m_popup_recordPathAction->setCheckable(true);
+    m_popup_replayPathAction = m_popup_menu->addAction("Re&play camera path...");
+
+    m_popup_menu->addSeparator();
+    m_popup_snapshotAction = m_popup_menu->addAction("Save tiled &snapshot...");
+
+    m_popup_menu->addSeparator();
+    m_popup_profileAction = m_popup_menu->addAction("Pro&file rendering...");
+    m_popup_profileFinishAction = m_popup_menu->addAction("Profile with glFinish after each node");
+    m_popup_profileFinishAction->setCheckable(true);
+
+    return true;
 }
 
 
@@ -59,6 +253,14 @@ void CustomExaminerViewer::showPopupMenu()
 	if (!ensureMenuInit())
 		return;
 	//updatePopupMenuStates();
+	m_popup_antiAliasAction->setChecked(m_isantialias);
+	m_popup_statsAction->setChecked(m_showStats);
+	m_popup_fastInteractionAction->setChecked(m_fastInteraction);
+	m_popup_fastPickingAction->setChecked(m_fastPicking);
+	m_popup_occlusionCullingAction->setChecked(isOcclusionCulling());
+	m_popup_cachedBoundsAction->setChecked(m_cachedBounds);
+	updateCachingMenu();
+	m_popup_recordPathAction->setChecked(isRecordingCameraPath());
 
 	//Execute
 	QAction * selAct = m_popup_menu->exec(QCursor::pos());
@@ -71,6 +273,93 @@ void CustomExaminerViewer::showPopupMenu()
         qDebug("Anti-aliasing, done.");
         return;
 	}
+	if ( selAct == m_popup_fastInteractionAction ) {
+		setFastInteraction(m_popup_fastInteractionAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_fastPickingAction ) {
+		setFastPicking(m_popup_fastPickingAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_renderCachingAction ) {
+		setRenderCaching(m_popup_renderCachingAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_vboAction ) {
+		setVBO(m_popup_vboAction->isChecked());
+		return;
+	}
+	for (int i = 0; i < 3; ++i) {
+		SoSeparator * separator = selectedSeparator();
+		if ( selAct == m_popup_separatorCachingActions[i] && separator ) {
+			qDebug() << "CustomExaminerViewer: renderCaching of" << separator->getTypeId().getName().getString()
+			         << separator->getName().getString() << "set to" << i;
+			separator->renderCaching = i; // SoSeparator::OFF, ON, AUTO
+			return;
+		}
+	}
+	if ( selAct == m_popup_occlusionCullingAction ) {
+		setOcclusionCulling(m_popup_occlusionCullingAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_cachedBoundsAction ) {
+		setCachedBounds(m_popup_cachedBoundsAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_recordPathAction ) {
+		setRecordingCameraPath(m_popup_recordPathAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_replayPathAction ) {
+		QString filename = QFileDialog::getOpenFileName(getWidget(), "Replay camera path", m_cameraPathFile,
+		                                                "Camera paths (*.txt)");
+		CameraPath path;
+		if (!filename.isEmpty()) {
+			if (path.load(filename.toStdString()))
+				replayCameraPath(path);
+			else
+				qWarning() << "CustomExaminerViewer: could not read camera path from" << filename;
+		}
+		grabFocus();
+		return;
+	}
+	if ( selAct == m_popup_profileAction ) {
+		bool ok = false;
+		const int frames = QInputDialog::getInt(getWidget(), "Profile rendering", "Number of frames:", 100, 1, 100000, 1, &ok);
+		if (ok) {
+			QString filename = QFileDialog::getSaveFileName(getWidget(), "Profile rendering: flame graph file",
+			                                                "render_profile.folded", "Folded stacks (*.folded)");
+			if (!filename.isEmpty())
+				profileFrames(frames, filename, m_popup_profileFinishAction->isChecked());
+		}
+		grabFocus();
+		return;
+	}
+	if ( selAct == m_popup_snapshotAction ) {
+		bool ok = false;
+		QString size = QInputDialog::getText(getWidget(), "Tiled snapshot", "Size in pixels (WxH):",
+		                                     QLineEdit::Normal, "16384x16384", &ok);
+		unsigned width = 0, height = 0;
+		if (ok && sscanf(size.toLatin1().constData(), "%ux%u", &width, &height) == 2) {
+			QString prefix = QFileDialog::getSaveFileName(getWidget(), "Tiled snapshot: file prefix", "snapshot");
+			if (!prefix.isEmpty())
+				saveTiledSnapshot(width, height, prefix);
+		}
+		grabFocus();
+		return;
+	}
+	if ( selAct == m_popup_statsAction ) {
+		setStatsOverlayVisible(m_popup_statsAction->isChecked());
+		return;
+	}
+	if ( selAct == m_popup_exportStatsAction ) {
+		QString filename = QFileDialog::getSaveFileName(getWidget(), "Export statistics", "viewer_stats.json",
+		                                                "Statistics (*.json *.csv)");
+		if (!filename.isEmpty() && !exportStats(filename))
+			qWarning() << "CustomExaminerViewer: could not write statistics to" << filename;
+		grabFocus();
+		return;
+	}
 
 }
 
@@ -134,10 +423,15 @@ void CustomExaminerViewer::setAntialiasing(SbBool smoothing, int numPasses)
 //____________________________________________________________________
 void CustomExaminerViewer::grabFocus()
 {
-    qDebug("CustomExaminerViewer::grabFocus()");
 	QWidget * w = getGLWidget();
-	if (w)
-		w->setFocus(Qt::OtherFocusReason);
+	if (!w)
+		return;
+	if (w->hasFocus()) {
+		m_stats.addToCounter("focus requests skipped", 1);
+		return;
+	}
+	qDebug("CustomExaminerViewer::grabFocus()");
+	w->setFocus(Qt::OtherFocusReason);
 }
 
 
@@ -147,6 +441,14 @@ SbBool CustomExaminerViewer::processSoEvent(const SoEvent * const evt )
 //    VP1Msg::messageDebug("VP1ExaminerViewer::processSoEvent()");
 //    std::cout << "event type: " << evt->getClassTypeId().getName() << " - " << evt->getTypeId().getName() << std::endl;
 
+	if (evt->getTypeId().isDerivedFrom(SoLocation2Event::getClassTypeId())) {
+		if (m_coalesceEvents)
+			return queueMotionEvent(static_cast<const SoLocation2Event*>(evt));
+		hoverPick(evt);
+	} else if (m_coalesceEvents) {
+		flushMotionEvent(); // any other event is handled after the motion preceding it
+	}
+
 	if (evt->getTypeId().isDerivedFrom(SoKeyboardEvent::getClassTypeId())) {
 		//We want to add a few shortcuts:
 		// "A": View all
@@ -154,6 +456,9 @@ SbBool CustomExaminerViewer::processSoEvent(const SoEvent * const evt )
 		// "O": Orthogonal camera
 		// "C": Toggle camera mode
 		// "M": Toggle view/selection mode.
+		// "H": Toggle the statistics overlay.
+		// "I": Toggle the fast (low quality) interaction mode.
+		// "R": Start/stop recording the camera path.
 		//  If "Q" then we do NOT pass it on to the base class (because that closes the top window!!)
 
 		grabFocus(); //probably redundant since we got the event, but can't hurt.
@@ -182,6 +487,22 @@ SbBool CustomExaminerViewer::processSoEvent(const SoEvent * const evt )
         */
 		if (SO_KEY_PRESS_EVENT(evt,SoKeyboardEvent::M)) {
 			setViewing(!isViewing());
+			if (!isViewing() && m_fastPicking)
+				m_picker.ensureBuilt(); // build the pick index now, rather than on the first hover
+			else
+				setHighlight(0);
+			return true;//eat event
+		}
+		if (SO_KEY_PRESS_EVENT(evt,SoKeyboardEvent::H)) {
+			setStatsOverlayVisible(!isStatsOverlayVisible());
+			return true;//eat event
+		}
+		if (SO_KEY_PRESS_EVENT(evt,SoKeyboardEvent::I)) {
+			setFastInteraction(!isFastInteraction());
+			return true;//eat event
+		}
+		if (SO_KEY_PRESS_EVENT(evt,SoKeyboardEvent::R)) {
+			setRecordingCameraPath(!isRecordingCameraPath());
 			return true;//eat event
 		}
 		if (SO_KEY_PRESS_EVENT(evt,SoKeyboardEvent::A)) {
@@ -205,6 +526,22 @@ SbBool CustomExaminerViewer::processSoEvent(const SoEvent * const evt )
 				}
 				return true;//eat all right-clicks in viewing mode.
 			}
+		} else if (m_fastPicking) {//In selection mode, left clicks select the shape under the cursor
+			const SoMouseButtonEvent * ev_mouse = static_cast<const SoMouseButtonEvent*>(evt);
+			if (ev_mouse->getButton() == SoMouseButtonEvent::BUTTON1 && ev_mouse->getState() == SoButtonEvent::DOWN) {
+				PickAccelerator::Hit hit;
+				if (m_selectedPath)
+					m_selectedPath->unref();
+				m_selectedPath = 0;
+				if (pickAt(evt, hit)) {
+					m_selectedPath = hit.path;
+					m_selectedPath->ref();
+					m_selectedBox = hit.box;
+					qDebug() << "CustomExaminerViewer: picked" << hit.path->getTail()->getTypeId().getName().getString()
+					         << "at" << hit.point[0] << hit.point[1] << hit.point[2];
+				}
+				setHighlight(m_selectedPath, m_selectedBox);
+			}
 		}
 	}
 
@@ -212,3 +549,769 @@ SbBool CustomExaminerViewer::processSoEvent(const SoEvent * const evt )
 }
 
 
+
+
+//____________________________________________________________________
+void CustomExaminerViewer::setSceneGraph(SoNode * root)
+{
+	m_sceneSensor->detach();
+	setHighlight(0);
+	if (m_selectedPath)
+		m_selectedPath->unref();
+	m_selectedPath = 0;
+	// The culling group stays in place whether culling is on or not, so
+	// that toggling it does not reset the camera
+	m_cullingRoot->removeAllChildren();
+	if (root)
+		m_cullingRoot->addChild(root);
+	SoQtExaminerViewer::setSceneGraph(root ? m_cullingRoot : 0);
+	if (root)
+		m_sceneSensor->attach(root);
+	m_picker.setSceneGraph(m_fastPicking ? root : 0);
+	m_bounds.setSceneGraph(m_cachedBounds ? root : 0);
+	m_primitiveCountsDirty = true;
+}
+
+//____________________________________________________________________
+SoNode * CustomExaminerViewer::getSceneGraph()
+{
+	// SoQtViewer's is the culling group, which is always there
+	return m_cullingRoot->getNumChildren() ? m_cullingRoot->getChild(0) : 0;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setStatsOverlayVisible(bool b)
+{
+	if (m_showStats == b)
+		return;
+	m_showStats = b;
+	if (b) {
+		buildStatsOverlay();
+		m_stats.reset();
+		m_cacheMonitor.reset();
+		m_primitiveCountsDirty = true;
+	}
+	scheduleRedraw();
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::exportStats(const QString & filename) const
+{
+	qDebug() << "CustomExaminerViewer: exporting statistics to" << filename;
+	if (!m_showStats)
+		qDebug() << "CustomExaminerViewer: the overlay is off, the frame times only measure the submission of the GL calls";
+	return m_stats.exportToFile(filename.toStdString());
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::actualRedraw()
+{
+	// NB: this measures the time spent traversing the scene and issuing
+	// the GL calls, and while the statistics are shown (or a path is
+	// replayed) the time for GL to finish them. The buffer swap is done
+	// afterwards by SoQtGLWidget.
+	m_traversedNodes = 0;
+
+#ifdef GL_MULTISAMPLE
+	// Toggling the sample buffers would re-create the GL context, so while
+	// interacting we only switch multisampling off for the frame.
+	if (m_isantialias) {
+		if (m_fastInteraction && m_interacting)
+			glDisable(GL_MULTISAMPLE);
+		else
+			glEnable(GL_MULTISAMPLE);
+	}
+#endif
+
+	m_cameraPath.record(getCamera());
+	if (m_cachedBounds)
+		updateClippingPlanes();
+
+	if (m_showStats)
+		m_cacheMonitor.beginFrame();
+	m_stats.beginFrame();
+	SoQtExaminerViewer::actualRedraw();
+	if (m_replaying || m_showStats)
+		glFinish(); // time the whole frame, not only the submission of the GL calls
+	m_stats.endFrame();
+	m_lastFrameTime = SbTime::getTimeOfDay();
+
+	// Low complexity is not enough for this scene: draw bounding boxes for
+	// the rest of this interaction, after a few slow frames in a row (one
+	// alone may be a cache being built)
+	if (m_fastInteraction && m_interacting && !m_interactiveBBox) {
+		m_slowInteractiveFrames = m_stats.lastFrameTime() > m_interactiveFrameBudget ? m_slowInteractiveFrames + 1 : 0;
+		if (m_slowInteractiveFrames >= 3) {
+			qDebug() << "CustomExaminerViewer: interactive frames took" << m_stats.lastFrameTime()
+			         << "ms, switching to bounding boxes while interacting.";
+			m_interactiveBBox = true;
+			setDrawStyle(SoQtViewer::INTERACTIVE, SoQtViewer::VIEW_BBOX);
+		}
+	}
+
+	// Nodes the render action visited this frame. Subgraphs replayed from a
+	// render cache (or culled) are not visited, so the difference to the
+	// total number of nodes tells how much of the scene came from caches.
+	m_stats.setCounter("nodes traversed", m_traversedNodes);
+	const double total = m_stats.counter("nodes in scene");
+	m_stats.setCounter("nodes skipped (render cache/culling)", total > m_traversedNodes ? total - m_traversedNodes : 0);
+	if (m_showStats) {
+		m_cacheMonitor.endFrame(getViewportRegion());
+		// Reached but not entered: replayed from a cache, or culled
+		m_stats.setCounter("separators not traversed", m_cacheMonitor.replayedSeparators());
+		m_stats.setCounter("render cache builds", m_cacheMonitor.cacheBuilds());
+		m_stats.setCounter("render cache invalidations", m_cacheMonitor.cacheInvalidations());
+		m_stats.setCounter("render cache memory [kB] (est.)", m_cacheMonitor.estimatedMemory() / 1024.0);
+		// The GL context is current here, so its extensions are known
+		m_glHasVBO = cc_glglue_has_vertex_buffer_object(cc_glglue_instance(getGLRenderAction()->getCacheContext()));
+	}
+	if (isOcclusionCulling()) {
+		const OcclusionCullingGroup::FrameStats & culling = m_cullingRoot->lastFrameStats();
+		m_stats.setCounter("occlusion tests", culling.tested);
+		m_stats.setCounter("occlusion culled separators", culling.culled);
+		m_stats.setCounter("occlusion culled nodes", culling.culledNodes);
+		m_stats.setCounter("occluder triangles", culling.occluderTriangles);
+		m_stats.setCounter("occlusion buffer [ms]", culling.bufferTime);
+	}
+
+	if (m_highlightRoot && m_highlightCoords->point.getNum() > 0) {
+		// The highlight box is drawn with the viewer camera
+		SoCamera * camera = getCamera();
+		if (camera && m_highlightRoot->getChild(0) != camera)
+			m_highlightRoot->replaceChild(0, camera);
+		if (camera)
+			renderOverlayGraph(m_highlightRoot);
+	}
+
+	if (m_showStats)
+		renderStatsOverlay();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::buildStatsOverlay()
+{
+	if (m_hudRoot)
+		return;
+
+	m_hudRoot = new SoSeparator;
+	m_hudRoot->ref();
+
+	// A fixed orthographic camera, so that the text does not follow the scene
+	SoOrthographicCamera * camera = new SoOrthographicCamera;
+	camera->position.setValue(0, 0, 1);
+	camera->height = 2.0f; // the viewport spans [-1,1] vertically
+	camera->nearDistance = 0.5f;
+	camera->farDistance = 1.5f;
+	m_hudRoot->addChild(camera);
+
+	SoLightModel * lightModel = new SoLightModel;
+	lightModel->model = SoLightModel::BASE_COLOR;
+	m_hudRoot->addChild(lightModel);
+
+	SoBaseColor * color = new SoBaseColor;
+	color->rgb = SbColor(1, 1, 0); // Yellow
+	m_hudRoot->addChild(color);
+
+	SoFont * font = new SoFont;
+	font->size = 12.0f;
+	m_hudRoot->addChild(font);
+
+	m_hudTranslation = new SoTranslation;
+	m_hudRoot->addChild(m_hudTranslation);
+
+	m_hudText = new SoText2;
+	m_hudText->spacing = 1.2f;
+	m_hudRoot->addChild(m_hudText);
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::updatePrimitiveCounts()
+{
+	SoNode * root = getSceneGraph();
+	if (!root)
+		return;
+
+	SoGetPrimitiveCountAction countAction(getViewportRegion());
+	countAction.apply(root);
+	m_stats.setCounter("triangles", countAction.getTriangleCount());
+	m_stats.setCounter("lines", countAction.getLineCount());
+	m_stats.setCounter("points", countAction.getPointCount());
+	m_stats.setCounter("texts", countAction.getTextCount());
+	m_stats.setCounter("images", countAction.getImageCount());
+
+	// Count nodes per path, the same way the render action visits them
+	m_stats.setCounter("nodes in scene", countNodes(root));
+
+	m_primitiveCountsDirty = false;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::renderStatsOverlay()
+{
+	if (m_primitiveCountsDirty)
+		updatePrimitiveCounts();
+
+	std::ostringstream aa;
+	aa << "anti-aliasing: " << (m_isantialias ? "on" : "off");
+#if SOQT_MAJOR_VERSION > 1 || (SOQT_MAJOR_VERSION == 1 && SOQT_MINOR_VERSION >= 5)
+	aa << " (" << getSampleBuffers() << " sample buffers)";
+#endif
+
+	std::istringstream lines(m_stats.summary());
+	std::string line;
+	int n = 0;
+	m_hudText->string.setNum(0);
+	while (std::getline(lines, line))
+		m_hudText->string.set1Value(n++, line.c_str());
+	m_hudText->string.set1Value(n, aa.str().c_str());
+
+	// Keep the text in the top left corner, whatever the window aspect ratio
+	const float aspect = getViewportRegion().getViewportAspectRatio();
+	if (aspect > 1.0f)
+		m_hudTranslation->translation.setValue(-aspect + 0.05f, 0.9f, 0.0f);
+	else
+		m_hudTranslation->translation.setValue(-0.95f, 1.0f / aspect - 0.1f, 0.0f);
+
+	// Draw on top of the scene
+	glClear(GL_DEPTH_BUFFER_BIT);
+	renderOverlayGraph(m_hudRoot);
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::renderOverlayGraph(SoNode * overlay)
+{
+	const unsigned traversed = m_traversedNodes;
+	getGLRenderAction()->apply(overlay);
+	m_traversedNodes = traversed; // do not count the overlays in the statistics
+}
+
+//____________________________________________________________________
+SoGLRenderAction::AbortCode CustomExaminerViewer::countTraversedNodeCB(void * userdata)
+{
+	// Called by the render action for each child node it is about to traverse
+	CustomExaminerViewer * self = static_cast<CustomExaminerViewer*>(userdata);
+	self->m_traversedNodes++;
+	if (self->m_showStats)
+		self->m_cacheMonitor.nodeTraversed(self->getGLRenderAction()->getCurPath());
+	return SoGLRenderAction::CONTINUE;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::sceneChangedCB(void * userdata, SoSensor * sensor)
+{
+	// Camera motion does not change the primitive counts, no need to redo them
+	SoNode * trigger = static_cast<SoNodeSensor*>(sensor)->getTriggerNode();
+	if (trigger && trigger->isOfType(SoCamera::getClassTypeId()))
+		return;
+	CustomExaminerViewer * self = static_cast<CustomExaminerViewer*>(userdata);
+	self->m_primitiveCountsDirty = true;
+	self->m_cacheMonitor.invalidate();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setFastInteraction(bool b)
+{
+	qDebug() << "CustomExaminerViewer::setFastInteraction()" << b;
+	m_fastInteraction = b;
+	m_interactiveBBox = false;
+	m_slowInteractiveFrames = 0;
+	// The viewer inserts an overriding SoComplexity in its own scene graph for this draw style
+	setDrawStyle(SoQtViewer::INTERACTIVE, b ? SoQtViewer::VIEW_LOW_COMPLEXITY : SoQtViewer::VIEW_SAME_AS_STILL);
+	if (!b && m_interacting && m_isantialias)
+		getGLRenderAction()->setSmoothing(TRUE);
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::interactionStartCB(void * userdata, SoQtViewer *)
+{
+	CustomExaminerViewer * viewer = static_cast<CustomExaminerViewer*>(userdata);
+	viewer->m_interacting = true;
+	viewer->m_restoreQualitySensor->unschedule();
+	if (viewer->m_fastInteraction && viewer->m_isantialias)
+		viewer->getGLRenderAction()->setSmoothing(FALSE);
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::interactionFinishCB(void * userdata, SoQtViewer *)
+{
+	// Wait a little before going back to full quality, so that a sequence
+	// of short drags does not pay for an anti-aliased frame each time.
+	CustomExaminerViewer * viewer = static_cast<CustomExaminerViewer*>(userdata);
+	viewer->m_restoreQualitySensor->setTimeFromNow(SbTime(0.15));
+	viewer->m_restoreQualitySensor->schedule();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::restoreQualityCB(void * userdata, SoSensor *)
+{
+	CustomExaminerViewer * viewer = static_cast<CustomExaminerViewer*>(userdata);
+	viewer->m_interacting = false;
+	if (!viewer->m_fastInteraction)
+		return;
+	// The bounding box frames do not tell whether low complexity would be
+	// fast enough now (a smaller window, caches built): the next
+	// interaction tries it again
+	viewer->m_slowInteractiveFrames = 0;
+	if (viewer->m_interactiveBBox) {
+		viewer->m_interactiveBBox = false;
+		viewer->setDrawStyle(SoQtViewer::INTERACTIVE, SoQtViewer::VIEW_LOW_COMPLEXITY);
+	}
+	if (viewer->m_isantialias)
+		viewer->getGLRenderAction()->setSmoothing(TRUE);
+	viewer->scheduleRedraw();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setRecordingCameraPath(bool b)
+{
+	if (b == isRecordingCameraPath())
+		return;
+	if (b) {
+		qDebug() << "CustomExaminerViewer: recording camera path...";
+		m_cameraPath.startRecording();
+		m_cameraPath.record(getCamera()); // starting point
+		return;
+	}
+	m_cameraPath.stopRecording();
+	if (m_cameraPath.save(m_cameraPathFile.toStdString()))
+		qDebug() << "CustomExaminerViewer: camera path with" << m_cameraPath.numKeyframes()
+		         << "keyframes saved to" << m_cameraPathFile;
+	else
+		qWarning() << "CustomExaminerViewer: could not write camera path to" << m_cameraPathFile;
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::replayCameraPath(const CameraPath & path, unsigned numSteps)
+{
+	SoCamera * camera = getCamera();
+	if (!camera || path.isEmpty())
+		return false;
+	if (isRecordingCameraPath())
+		setRecordingCameraPath(false);
+
+	ViewerStats replayStats(1 << 16);
+	const unsigned frames = numSteps ? numSteps : path.numKeyframes();
+	printf("# frame  time[s]  render[ms]\n");
+	for (unsigned i = 0; i < frames; ++i) {
+		const CameraPath::Keyframe key = numSteps ? path.stateAt(path.stepTime(i, numSteps)) : path.keyframe(i);
+		CameraPath::applyTo(key, camera);
+		const double ms = timedRender();
+		replayStats.addFrameTime(ms);
+		printf("%7u  %7.3f  %10.3f\n", i, key.time, ms);
+	}
+	printf("# %u frames, p50: %.3f ms, p95: %.3f ms, p99: %.3f ms\n", frames,
+	       replayStats.percentile(50), replayStats.percentile(95), replayStats.percentile(99));
+	fflush(stdout);
+	return true;
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::profileFrames(unsigned frames, const QString & filename, bool finishEachNode)
+{
+	if (m_cullingRoot->getNumChildren() == 0 || frames == 0)
+		return false;
+	qDebug() << "CustomExaminerViewer: profiling" << frames << "frames";
+
+	// The profiler goes between the culling group and the scene for the
+	// duration of the measurement only: it replaces the normal render
+	// traversal, and would hide the subgraphs from the culling group
+	SoNode * scene = m_cullingRoot->getChild(0);
+	m_profiler->removeAllChildren();
+	m_profiler->addChild(scene);
+	m_cullingRoot->replaceChild(0, m_profiler);
+	m_profiler->reset();
+	m_profiler->finishEachNode = finishEachNode;
+	m_profiler->profiling = TRUE;
+
+	for (unsigned i = 0; i < frames; ++i)
+		timedRender();
+
+	m_profiler->profiling = FALSE;
+	m_cullingRoot->replaceChild(0, scene);
+	m_profiler->removeAllChildren();
+
+	m_profiler->printSummary();
+	const bool ok = m_profiler->writeFolded(filename.toStdString())
+	                && m_profiler->writeReport((filename + ".txt").toStdString());
+	if (!ok)
+		qWarning() << "CustomExaminerViewer: could not write the profile to" << filename;
+	return ok;
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::saveTiledSnapshot(unsigned width, unsigned height, const QString & prefix, unsigned tileSize)
+{
+	qDebug() << "CustomExaminerViewer::saveTiledSnapshot()" << width << "x" << height << prefix;
+	SoNode * scene = getSceneGraph();
+	SoCamera * camera = getCamera();
+	if (!scene || !camera)
+		return false;
+
+	TiledSnapshot snapshot(tileSize);
+	snapshot.setBackgroundColor(getBackgroundColor());
+	// Same anti-aliasing settings as the ones passed to SoQtViewer::setAntialiasing()
+	SbBool smoothing;
+	int numPasses;
+	getAntialiasing(smoothing, numPasses);
+	snapshot.setAntialiasing(smoothing, numPasses);
+	return snapshot.render(scene, camera, width, height, prefix.toStdString());
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setEventCoalescing(bool b)
+{
+	if (!b)
+		flushMotionEvent();
+	m_coalesceEvents = b;
+}
+
+//____________________________________________________________________
+SbBool CustomExaminerViewer::queueMotionEvent(const SoLocation2Event * event)
+{
+	m_stats.addToCounter("motion events", 1);
+	if (m_hasPendingMotion)
+		m_stats.addToCounter("motion events coalesced", 1); // the pending one is dropped
+
+	m_pendingMotion.setTime(event->getTime());
+	m_pendingMotion.setPosition(event->getPosition());
+	m_pendingMotion.setShiftDown(event->wasShiftDown());
+	m_pendingMotion.setCtrlDown(event->wasCtrlDown());
+	m_pendingMotion.setAltDown(event->wasAltDown());
+	m_hasPendingMotion = true;
+
+	if (!m_motionSensor->isScheduled()) {
+		// The alarm is only processed once the queued GUI events are done,
+		// and not before the minimum interval since the last frame.
+		SbTime when = SbTime::getTimeOfDay();
+		if (m_maxFrameRate > 0.0) {
+			const SbTime earliest = m_lastFrameTime + SbTime(1.0 / m_maxFrameRate);
+			if (earliest > when)
+				when = earliest;
+		}
+		m_motionSensor->setTime(when);
+		m_motionSensor->schedule();
+	}
+	return TRUE; // eaten for now, handled in flushMotionEvent()
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::flushMotionEvent()
+{
+	if (!m_hasPendingMotion)
+		return;
+	m_motionSensor->unschedule();
+	m_hasPendingMotion = false;
+	hoverPick(&m_pendingMotion);
+	SoQtExaminerViewer::processSoEvent(&m_pendingMotion);
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::motionCB(void * userdata, SoSensor *)
+{
+	static_cast<CustomExaminerViewer*>(userdata)->flushMotionEvent();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setFastPicking(bool b)
+{
+	m_fastPicking = b;
+	if (!b) {
+		setHighlight(0);
+		m_picker.setSceneGraph(0); // release the index
+	} else {
+		m_picker.setSceneGraph(getSceneGraph());
+	}
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::isOcclusionCulling() const
+{
+	return m_cullingRoot->occlusionCulling.getValue();
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setOcclusionCulling(bool b)
+{
+	if (b == isOcclusionCulling())
+		return;
+	qDebug() << "CustomExaminerViewer: occlusion culling" << (b ? "on" : "off");
+	m_cullingRoot->occlusionCulling = b; // triggers a redraw
+	if (!b) {
+		m_stats.setCounter("occlusion tests", 0);
+		m_stats.setCounter("occlusion culled separators", 0);
+		m_stats.setCounter("occlusion culled nodes", 0);
+	}
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::updateCachingMenu()
+{
+	m_popup_renderCachingAction->setChecked(isRenderCaching());
+	SoSeparator * separator = selectedSeparator();
+	for (int i = 0; i < 3; ++i) {
+		m_popup_separatorCachingActions[i]->setEnabled(separator != 0);
+		m_popup_separatorCachingActions[i]->setChecked(separator && separator->renderCaching.getValue() == i);
+	}
+	const char * vbo = getenv("COIN_VBO");
+	const bool vboAvailable = m_glHasVBO && !(vbo && !atoi(vbo));
+	if (!m_glHasVBO)
+		m_popup_vboAction->setText("VBOs (not supported by this GL context)");
+	else if (!vboAvailable)
+		m_popup_vboAction->setText("VBOs (off: COIN_VBO=0)");
+	else
+		m_popup_vboAction->setText("VBOs (vertex arrays in GL buffers)");
+	m_popup_vboAction->setEnabled(vboAvailable);
+	m_popup_vboAction->setChecked(vboAvailable && isVBO());
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::isVBO() const
+{
+	return SoGLVBOElement::getVertexCountMinLimit() != INT_MAX;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setVBO(bool b)
+{
+	qDebug() << "CustomExaminerViewer: VBOs" << (b ? "on" : "off");
+	// Coin puts in a VBO the arrays with a number of vertices within its
+	// limits: a minimum no shape reaches turns them off. Touching the scene
+	// rebuilds the caches, which hold the arrays as they were sent.
+	SoGLVBOElement::setVertexCountLimits(b ? m_vboMinVertices : INT_MAX,
+	                                     SoGLVBOElement::getVertexCountMaxLimit());
+	if (getSceneGraph())
+		getSceneGraph()->touch();
+	m_cacheMonitor.reset();
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::isRenderCaching() const
+{
+	return SoSeparator::getNumRenderCaches() > 0;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setRenderCaching(bool b)
+{
+	qDebug() << "CustomExaminerViewer: render caching" << (b ? "on" : "off");
+	// Touching the scene flushes the caches already built, so that the
+	// new policy shows from the next frame on
+	SoSeparator::setNumRenderCaches(b ? (m_numRenderCaches > 0 ? m_numRenderCaches : 2) : 0);
+	if (getSceneGraph())
+		getSceneGraph()->touch();
+	m_cacheMonitor.reset();
+}
+
+//____________________________________________________________________
+SoSeparator * CustomExaminerViewer::selectedSeparator() const
+{
+	if (!m_selectedPath)
+		return 0;
+	for (int i = 0; i < m_selectedPath->getLength(); ++i) {
+		SoNode * node = m_selectedPath->getNodeFromTail(i);
+		if (node != m_cullingRoot && node->isOfType(SoSeparator::getClassTypeId()))
+			return static_cast<SoSeparator*>(node);
+	}
+	return 0;
+}
+
+//____________________________________________________________________
+bool CustomExaminerViewer::pickAt(const SoEvent * event, PickAccelerator::Hit & hit)
+{
+	SoCamera * camera = getCamera();
+	if (!camera)
+		return false;
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	const SbViewportRegion & vp = getViewportRegion();
+	SbLine ray;
+	camera->getViewVolume(vp.getViewportAspectRatio()).projectPointToLine(event->getNormalizedPosition(vp), ray);
+	const bool found = m_picker.pick(ray, hit);
+	const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	m_stats.addToCounter("picks", 1);
+	m_stats.setCounter("pick latency [us]", us);
+	m_stats.setCounter("pick index triangles", m_picker.numTriangles());
+	m_stats.setCounter("pick index build [ms]", m_picker.lastBuildTime());
+	return found;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::hoverPick(const SoEvent * event)
+{
+	if (isViewing() || !m_fastPicking)
+		return;
+	PickAccelerator::Hit hit;
+	SoPath * path = pickAt(event, hit) ? hit.path : 0;
+	if (path == m_hoveredPath)
+		return;
+	if (m_hoveredPath)
+		m_hoveredPath->unref();
+	m_hoveredPath = path;
+	if (m_hoveredPath) {
+		m_hoveredPath->ref();
+		setHighlight(m_hoveredPath, hit.box);
+	} else {
+		setHighlight(m_selectedPath, m_selectedBox);
+	}
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setHighlight(SoPath * path, const SbBox3f & box)
+{
+	if (!path) {
+		if (m_hoveredPath)
+			m_hoveredPath->unref();
+		m_hoveredPath = 0;
+		if (m_highlightRoot)
+			m_highlightCoords->point.setNum(0);
+		scheduleRedraw();
+		return;
+	}
+
+	if (!m_highlightRoot) {
+		m_highlightRoot = new SoSeparator;
+		m_highlightRoot->ref();
+		m_highlightRoot->addChild(new SoSeparator); // placeholder for the viewer camera
+		SoLightModel * lightModel = new SoLightModel;
+		lightModel->model = SoLightModel::BASE_COLOR;
+		m_highlightRoot->addChild(lightModel);
+		SoDrawStyle * drawStyle = new SoDrawStyle;
+		drawStyle->lineWidth = 2.0f;
+		m_highlightRoot->addChild(drawStyle);
+		m_highlightColor = new SoBaseColor;
+		m_highlightRoot->addChild(m_highlightColor);
+		m_highlightCoords = new SoCoordinate3;
+		m_highlightRoot->addChild(m_highlightCoords);
+		// The 12 edges of a box
+		static const int32_t edges[] = { 0,1,3,2,0,-1, 4,5,7,6,4,-1, 0,4,-1, 1,5,-1, 2,6,-1, 3,7,-1 };
+		SoIndexedLineSet * lines = new SoIndexedLineSet;
+		lines->coordIndex.setValues(0, sizeof(edges) / sizeof(edges[0]), edges);
+		m_highlightRoot->addChild(lines);
+	}
+
+	// World space box of the shape, as given by the pick index (no scene traversal)
+	const SbVec3f & lo = box.getMin();
+	const SbVec3f & hi = box.getMax();
+	for (int i = 0; i < 8; ++i)
+		m_highlightCoords->point.set1Value(i, (i & 1) ? hi[0] : lo[0], (i & 2) ? hi[1] : lo[1], (i & 4) ? hi[2] : lo[2]);
+	m_highlightColor->rgb = (path == m_selectedPath) ? SbColor(1, 0.5f, 0) : SbColor(0, 1, 1);
+	scheduleRedraw();
+}
+
+//____________________________________________________________________
+double CustomExaminerViewer::timedRender()
+{
+	m_replaying = true; // GL finishes the frame before the clock stops
+	const double ms = FrameTiming::timedRender(this);
+	m_replaying = false;
+	return ms;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::setCachedBounds(bool b)
+{
+	m_cachedBounds = b;
+	// With auto clipping, SoQtViewer bounds the whole scene before each frame
+	setAutoClipping(!b);
+	m_bounds.setSceneGraph(b ? getSceneGraph() : 0);
+	if (!b) {
+		m_stats.setCounter("bounds separators walked", 0);
+		m_stats.setCounter("bounds separators reused", 0);
+		m_stats.setCounter("bounds query [ms]", 0);
+	}
+	scheduleRedraw();
+}
+
+//____________________________________________________________________
+SbBox3f CustomExaminerViewer::cachedBoundingBox()
+{
+	// The counters are those of the last query which walked the scene,
+	// the others cost nothing
+	const SbBox3f box = m_bounds.boundingBox();
+	m_stats.setCounter("bounds separators walked", m_bounds.lastWalked());
+	m_stats.setCounter("bounds separators reused", m_bounds.lastReused());
+	m_stats.setCounter("bounds query [ms]", m_bounds.lastTime());
+	return box;
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::viewAll()
+{
+	SoCamera * camera = getCamera();
+	const SbBox3f box = m_cachedBounds && camera ? cachedBoundingBox() : SbBox3f();
+	if (box.isEmpty()) {
+		SoQtExaminerViewer::viewAll();
+		return;
+	}
+
+	// As SoCamera::viewAll: the sphere around the box fits in the view
+	const SbVec3f center = box.getCenter();
+	const float radius = std::max((box.getMax() - center).length(), 1e-6f);
+	const float aspect = getViewportRegion().getViewportAspectRatio();
+	SbVec3f direction;
+	camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+
+	if (camera->isOfType(SoPerspectiveCamera::getClassTypeId())) {
+		float angle = static_cast<SoPerspectiveCamera*>(camera)->heightAngle.getValue() / 2;
+		if (aspect < 1.0f)
+			angle = atanf(tanf(angle) * aspect); // narrower than high
+		const float distance = radius / sinf(angle);
+		camera->position = center - direction * distance;
+		camera->focalDistance = distance;
+		camera->nearDistance = distance - radius;
+		camera->farDistance = distance + radius;
+	} else if (camera->isOfType(SoOrthographicCamera::getClassTypeId())) {
+		SoOrthographicCamera * ortho = static_cast<SoOrthographicCamera*>(camera);
+		ortho->height = aspect < 1.0f ? 2 * radius / aspect : 2 * radius;
+		camera->position = center - direction * radius;
+		camera->focalDistance = radius;
+		camera->nearDistance = 0.0f;
+		camera->farDistance = 2 * radius;
+	} else {
+		SoQtExaminerViewer::viewAll();
+	}
+}
+
+//____________________________________________________________________
+void CustomExaminerViewer::updateClippingPlanes()
+{
+	// As the auto clipping of SoQtViewer, with the cached box
+	SoCamera * camera = getCamera();
+	if (!camera)
+		return;
+	const SbBox3f box = cachedBoundingBox();
+	if (box.isEmpty())
+		return;
+
+	SbVec3f direction;
+	camera->orientation.getValue().multVec(SbVec3f(0, 0, -1), direction);
+	const SbVec3f position = camera->position.getValue();
+	const SbVec3f & lo = box.getMin();
+	const SbVec3f & hi = box.getMax();
+	float nearval = 1e30f, farval = -1e30f;
+	for (int i = 0; i < 8; ++i) {
+		const SbVec3f corner((i & 1) ? hi[0] : lo[0], (i & 2) ? hi[1] : lo[1], (i & 4) ? hi[2] : lo[2]);
+		const float depth = (corner - position).dot(direction);
+		nearval = std::min(nearval, depth);
+		farval = std::max(farval, depth);
+	}
+
+	if (camera->isOfType(SoPerspectiveCamera::getClassTypeId())) {
+		if (farval <= 0.0f)
+			return; // all behind the camera, nothing to see
+		// Keeps some depth buffer precision when the camera is in the scene
+		nearval = std::max(nearval, farval / 512.0f);
+	}
+	// A little slack, so that the nearest and farthest faces are not clipped
+	nearval = nearval > 0.0f ? nearval * 0.999f : nearval * 1.001f;
+	farval *= farval > 0.0f ? 1.001f : 0.999f;
+
+	if (camera->nearDistance.getValue() == nearval && camera->farDistance.getValue() == farval)
+		return;
+	// Not a change of the scene: no redraw, and no invalidation of the caches
+	const SbBool notify = camera->enableNotify(FALSE);
+	camera->nearDistance = nearval;
+	camera->farDistance = farval;
+	camera->enableNotify(notify);
+}
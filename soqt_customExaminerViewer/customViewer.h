@@ -4,11 +4,33 @@
 //#include "VP1Base/VP1String.h"
 #include <Inventor/C/errors/debugerror.h>
 #include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/events/SoLocation2Event.h>
+#include <Inventor/SbTime.h>
 #include <QObject>
+#include <QString>
+
+#include "ViewerStats.h"
+#include "CameraPath.h"
+#include "PickAccelerator.h"
+#include "RenderCacheMonitor.h"
+#include "BoundsCache.h"
 
 class QPixmap;
 class QMenu;
 class QAction;
+class QActionGroup;
+class SoSeparator;
+class SoTranslation;
+class SoText2;
+class SoNodeSensor;
+class SoSensor;
+class SoAlarmSensor;
+class SoCoordinate3;
+class SoBaseColor;
+class SoPath;
+class OcclusionCullingGroup;
+class RenderProfiler;
 
 class CustomExaminerViewer : public SoQtExaminerViewer { 
 public:   
@@ -28,15 +50,198 @@ public:
 	      bool isAntiAlias() const {return m_isantialias;};
 	      void setAntiAlias(bool);
 
+          virtual void setSceneGraph(SoNode * root);
+          // The root given to setSceneGraph(), not the culling group above it
+          virtual SoNode * getSceneGraph();
+
+          // Frame-time statistics overlay [H]. While it is shown, each
+          // frame waits for GL to finish (glFinish), so that the frame times
+          // are those of whole frames; otherwise they only measure the
+          // submission of the GL calls. Export them with the overlay on.
+          bool isStatsOverlayVisible() const { return m_showStats; }
+          void setStatsOverlayVisible(bool);
+          ViewerStats & stats() { return m_stats; }
+          bool exportStats(const QString & filename) const;
+
+          // Interaction-aware quality [I]: while the camera is dragged (or
+          // spinning) anti-aliasing is dropped and the scene is drawn with
+          // low complexity. If that is still above the frame budget for a
+          // few frames in a row, the interactive draw style falls back to
+          // bounding boxes until the interaction ends. Full quality is
+          // restored once the camera has been idle for a short delay.
+          bool isFastInteraction() const { return m_fastInteraction; }
+          void setFastInteraction(bool);
+          void setInteractiveFrameBudget(double ms) { m_interactiveFrameBudget = ms; }
+          double interactiveFrameBudget() const { return m_interactiveFrameBudget; }
+
+          // Camera path recording [R] and replay. When recording stops
+          // the path is saved to cameraPathFile() ("camera_path.txt").
+          bool isRecordingCameraPath() const { return m_cameraPath.isRecording(); }
+          void setRecordingCameraPath(bool);
+          const CameraPath & cameraPath() const { return m_cameraPath; }
+          void setCameraPathFile(const QString & filename) { m_cameraPathFile = filename; }
+          QString cameraPathFile() const { return m_cameraPathFile; }
+          // Renders the path at fixed steps (one per keyframe if numSteps is 0)
+          // and prints the per-frame render times to stdout.
+          bool replayCameraPath(const CameraPath & path, unsigned numSteps = 0);
+          // Renders one frame right away, waiting for GL to finish it, and
+          // returns its render time in ms
+          double timedRender();
+
+          // Renders the current view to width x height pixels, in PNG tiles
+          // named after 'prefix' (see TiledSnapshot.h)
+          bool saveTiledSnapshot(unsigned width, unsigned height, const QString & prefix, unsigned tileSize = 2048);
+
+          // Renders 'frames' frames with each node timed (see RenderProfiler.h),
+          // writes the times as folded stacks for flame graphs to 'filename'
+          // and as a tree to 'filename'.txt, and prints the slowest nodes.
+          // Occlusion culling is not applied while profiling.
+          bool profileFrames(unsigned frames, const QString & filename, bool finishEachNode = false);
+
+          // Mouse motion coalescing: motion events are not handled as they
+          // arrive but queued, and only the latest one is processed, once the
+          // pending GUI events are done and at most maxFrameRate() times per
+          // second (0 means no limit). Coalesced events are counted in stats().
+          bool isEventCoalescing() const { return m_coalesceEvents; }
+          void setEventCoalescing(bool);
+          double maxFrameRate() const { return m_maxFrameRate; }
+          void setMaxFrameRate(double fps) { m_maxFrameRate = fps > 0.0 ? fps : 0.0; }
+
+          // Fast picking: in selection mode [M], clicks and hovering pick
+          // through a cached BVH of the scene triangles (see PickAccelerator.h)
+          // instead of a SoRayPickAction over the whole graph. The shape under
+          // the cursor is highlighted with its bounding box.
+          bool isFastPicking() const { return m_fastPicking; }
+          void setFastPicking(bool);
+          // Path to the last shape clicked in selection mode (or 0)
+          SoPath * selectedPath() const { return m_selectedPath; }
+
+          // Occlusion culling: the scene graph is rendered below an
+          // OcclusionCullingGroup, which skips the separators hidden behind
+          // the largest occluders. The number of culled nodes is in stats().
+          bool isOcclusionCulling() const;
+          void setOcclusionCulling(bool);
+
+          // Render caching policy. Globally, separators may keep render
+          // caches (display lists) or not; per separator, the renderCaching
+          // field of the one holding the selected shape can be forced. With
+          // no cache, shapes are sent each frame as vertex arrays, in VBOs
+          // unless these are turned off (globally, at runtime, or with
+          // COIN_VBO=0 in the environment).
+          // While the statistics are on, cache replays, builds,
+          // invalidations and an estimate of their memory are in stats().
+          bool isRenderCaching() const;
+          void setRenderCaching(bool);
+          bool isVBO() const;
+          void setVBO(bool);
+          // Innermost separator above the selected shape (or 0)
+          SoSeparator * selectedSeparator() const;
+
+          // Cached bounds: viewAll [V] and the near and far clipping planes
+          // use the separator boxes cached by a BoundsCache (see
+          // BoundsCache.h), instead of a SoGetBoundingBoxAction over the
+          // whole scene each time (and each frame, for the clipping planes).
+          // The query times are in stats().
+          bool isCachedBounds() const { return m_cachedBounds; }
+          void setCachedBounds(bool);
+          virtual void viewAll();
+
+protected:
+          virtual void actualRedraw();
 
 private:
 
 	QMenu * m_popup_menu;
     QAction* m_popup_antiAliasAction;
+    QAction* m_popup_statsAction;
+    QAction* m_popup_exportStatsAction;
+    QAction* m_popup_fastInteractionAction;
+    QAction* m_popup_recordPathAction;
+    QAction* m_popup_replayPathAction;
+    QAction* m_popup_snapshotAction;
+    QAction* m_popup_profileAction;
+    QAction* m_popup_profileFinishAction;
+    QAction* m_popup_fastPickingAction;
+    QAction* m_popup_occlusionCullingAction;
+    QAction* m_popup_cachedBoundsAction;
+    QMenu* m_popup_cachingMenu;
+    QAction* m_popup_renderCachingAction;
+    QActionGroup* m_popup_separatorCachingGroup;
+    QAction* m_popup_separatorCachingActions[3]; // SoSeparator::OFF, ON, AUTO
+    QAction* m_popup_vboAction;
     bool m_isantialias;
 
+    ViewerStats m_stats;
+    bool m_showStats;
+    SoSeparator * m_hudRoot;
+    SoTranslation * m_hudTranslation;
+    SoText2 * m_hudText;
+    SoNodeSensor * m_sceneSensor;
+    bool m_primitiveCountsDirty;
+    unsigned m_traversedNodes;
+
+    bool m_fastInteraction;
+    bool m_interacting;
+    bool m_interactiveBBox;
+    unsigned m_slowInteractiveFrames; // over budget in a row
+    double m_interactiveFrameBudget;
+    SoAlarmSensor * m_restoreQualitySensor;
+
+    CameraPath m_cameraPath;
+    QString m_cameraPathFile;
+    bool m_replaying;
+
+    bool m_coalesceEvents;
+    double m_maxFrameRate;
+    bool m_hasPendingMotion;
+    SoLocation2Event m_pendingMotion;
+    SoAlarmSensor * m_motionSensor;
+    SbTime m_lastFrameTime;
+
+    bool m_fastPicking;
+    PickAccelerator m_picker;
+    SoPath * m_selectedPath;
+    SoPath * m_hoveredPath;
+    SbBox3f m_selectedBox;
+    SoSeparator * m_highlightRoot;
+    SoBaseColor * m_highlightColor;
+    SoCoordinate3 * m_highlightCoords;
+
+    OcclusionCullingGroup * m_cullingRoot;
+    RenderProfiler * m_profiler;
+
+    RenderCacheMonitor m_cacheMonitor;
+    int m_numRenderCaches;
+    bool m_glHasVBO;
+    int m_vboMinVertices; // Coin's limit, when VBOs are on
+
+    bool m_cachedBounds;
+    BoundsCache m_bounds;
+
     void setAntialiasing(SbBool smoothing, int numPasses);
     void grabFocus();
+
+    void buildStatsOverlay();
+    void updatePrimitiveCounts();
+    void renderStatsOverlay();
+    static SoGLRenderAction::AbortCode countTraversedNodeCB(void * userdata);
+    static void sceneChangedCB(void * userdata, SoSensor * sensor);
+
+    static void interactionStartCB(void * userdata, SoQtViewer * viewer);
+    static void interactionFinishCB(void * userdata, SoQtViewer * viewer);
+    static void restoreQualityCB(void * userdata, SoSensor * sensor);
+
+    SbBool queueMotionEvent(const SoLocation2Event * event);
+    void flushMotionEvent();
+    static void motionCB(void * userdata, SoSensor * sensor);
+
+    bool pickAt(const SoEvent * event, PickAccelerator::Hit & hit);
+    void hoverPick(const SoEvent * event);
+    void setHighlight(SoPath * path, const SbBox3f & box = SbBox3f());
+    void renderOverlayGraph(SoNode * overlay);
+    void updateCachingMenu();
+    SbBox3f cachedBoundingBox();
+    void updateClippingPlanes();
 };
 
 
@@ -1,25 +1,66 @@
 // HelloWorldSoQt.cpp
+//
+// Usage:
+//   soqt_customExaminerViewer [--replay path.txt] [--steps N] [--headless] [--size WxH]
+//   soqt_customExaminerViewer --headless --snapshot WxH [--output prefix]
+//   soqt_customExaminerViewer --quad [--independent] [--link-cameras] [--frames N] [--software-gl]
+//   soqt_customExaminerViewer [--headless] --occlusion-culling [--occlusion-scene]
+//   soqt_customExaminerViewer --headless --profile N [--gl-finish] [--profile-output file.folded]
+//   (all of them take --scene file.iv to use a scene file instead of "Hello World")
+//
+// --replay renders a camera path recorded with the [R] shortcut and prints the
+// per-frame render times; with --headless this is done offscreen, without any
+// window, using a software GL implementation (see OffscreenReplay.h).
+// --snapshot renders a (possibly very large) image of the scene in PNG tiles
+// (see TiledSnapshot.h).
+// --quad shows four synchronized views of the scene sharing their GL caches
+// (--independent: one set of caches per view); with --frames it renders N
+// frames in each view and prints the frame times and memory (see MultiView.h).
+// --occlusion-culling renders the scene below an OcclusionCullingGroup; with
+// --headless it renders one frame offscreen and prints what was culled.
+// --occlusion-scene replaces "Hello World" by a wall hiding a grid of spheres.
+// --profile times each node over N frames and writes a flame graph input
+// (see RenderProfiler.h); --scene reads the scene from an Inventor file, as
+// the import_scene_from_file example does.
 
 #include "customViewer.h"
+#include "OffscreenReplay.h"
+#include "TiledSnapshot.h"
+#include "MultiView.h"
+#include "OcclusionCullingGroup.h"
+#include "RenderProfiler.h"
+#include "FrameTiming.h"
 
 // SoQt includes
 #include <Inventor/Qt/SoQt.h>
 //#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
 
 // Coin includes
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SoInput.h>
 #include <Inventor/nodes/SoBaseColor.h>
 #include <Inventor/nodes/SoText3.h>
 #include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
 
-int main(int argc, char ** argv)
-{
-  // Init the Qt windowing system
-  // and get a pointer to the window
-  QWidget *window = SoQt::init("test");
+// Qt includes
+#include <QTimer>
+
+// C++ includes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
+SoSeparator * makeScene()
+{
   // Set the main node for the "scene graph"
   SoSeparator *root = new SoSeparator;
-  root->ref();
 
   // Set the color for the text (in RGB mode)
   SoBaseColor *color = new SoBaseColor;
@@ -33,15 +74,263 @@ int main(int argc, char ** argv)
   text3D->parts.setValue("ALL");
   root->addChild(text3D);
 
+  return root;
+}
+
+SoSeparator * readScene(const char *filename)
+{
+  SoInput input;
+  if (!input.openFile(filename)) {
+    fprintf(stderr, "Cannot open file %s\n", filename);
+    return 0;
+  }
+  SoSeparator *scene = SoDB::readAll(&input);
+  if (!scene)
+    fprintf(stderr, "Problem reading file %s\n", filename);
+  input.closeFile();
+  return scene;
+}
+
+// A wall in front of a grid of spheres: seen from the front, only the wall is visible
+SoSeparator * makeOcclusionScene()
+{
+  SoSeparator *root = new SoSeparator;
+  SoSeparator *wall = new SoSeparator;
+  SoTranslation *front = new SoTranslation;
+  front->translation.setValue(0, 0, 5);
+  wall->addChild(front);
+  SoCube *cube = new SoCube;
+  cube->width = 24;
+  cube->height = 24;
+  cube->depth = 0.5f;
+  wall->addChild(cube);
+  root->addChild(wall);
+
+  SoSphere *sphere = new SoSphere; // one instance, drawn 100 times
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 10; ++j) {
+      SoSeparator *sep = new SoSeparator;
+      SoTranslation *t = new SoTranslation;
+      t->translation.setValue(2.2f * (i - 4.5f), 2.2f * (j - 4.5f), -2);
+      sep->addChild(t);
+      sep->addChild(sphere);
+      root->addChild(sep);
+    }
+  }
+  return root;
+}
+
+// One offscreen frame of the scene below an OcclusionCullingGroup, from the front
+bool runOcclusionTest(OcclusionCullingGroup *culling, int width, int height)
+{
+  SoSeparator *root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera *camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  root->addChild(culling);
+  const SbViewportRegion region(width, height);
+  camera->viewAll(culling, region);
+
+  SoOffscreenRenderer renderer(region);
+  const bool ok = renderer.render(root);
+  if (ok) {
+    const OcclusionCullingGroup::FrameStats & stats = culling->lastFrameStats();
+    printf("occlusion culling: %u occluders (%u triangles), %u separators tested, %u culled (%u nodes), buffer %.3f ms\n",
+           stats.occluders, stats.occluderTriangles, stats.tested, stats.culled, stats.culledNodes, stats.bufferTime);
+  } else {
+    fprintf(stderr, "Could not render offscreen (no offscreen GL context?)\n");
+  }
+  root->unref();
+  return ok;
+}
+
+// Renders 'frames' offscreen frames of the scene with each node timed
+bool runProfile(SoSeparator *scene, int width, int height, unsigned frames, const char *output, bool finishEachNode)
+{
+  RenderProfiler *profiler = new RenderProfiler;
+  profiler->addChild(scene);
+  SoSeparator *root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera *camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  root->addChild(profiler);
+  const SbViewportRegion region(width, height);
+  camera->viewAll(scene, region);
+
+  SoOffscreenRenderer renderer(region);
+  bool ok = true;
+  profiler->finishEachNode = finishEachNode;
+  profiler->profiling = TRUE;
+  for (unsigned i = 0; i < frames && ok; ++i)
+    ok = renderer.render(root);
+  if (!ok) {
+    fprintf(stderr, "Could not render offscreen (no offscreen GL context?)\n");
+  } else {
+    profiler->printSummary();
+    const std::string report = std::string(output) + ".txt";
+    ok = profiler->writeFolded(output) && profiler->writeReport(report);
+    if (ok)
+      printf("# profile written to %s and %s\n", output, report.c_str());
+    else
+      fprintf(stderr, "Could not write %s\n", output);
+  }
+  root->unref();
+  return ok;
+}
+
+int main(int argc, char ** argv)
+{
+  // Parse the command line options
+  const char * replayFile = 0;
+  unsigned steps = 0;
+  bool headless = false;
+  int width = 800, height = 600;
+  unsigned snapshotWidth = 0, snapshotHeight = 0;
+  const char * output = "snapshot";
+  bool quad = false, independent = false, linkCameras = false, softwareGL = false;
+  bool occlusionCulling = false, occlusionScene = false;
+  const char * sceneFile = 0;
+  unsigned profileFrames = 0;
+  const char * profileOutput = "render_profile.folded";
+  bool glFinishEachNode = false;
+  unsigned frames = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+      replayFile = argv[++i];
+    else if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+      steps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--headless"))
+      headless = true;
+    else if (!strcmp(argv[i], "--size") && i + 1 < argc)
+      sscanf(argv[++i], "%dx%d", &width, &height);
+    else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc)
+      sscanf(argv[++i], "%ux%u", &snapshotWidth, &snapshotHeight);
+    else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+      output = argv[++i];
+    else if (!strcmp(argv[i], "--quad"))
+      quad = true;
+    else if (!strcmp(argv[i], "--independent"))
+      independent = true;
+    else if (!strcmp(argv[i], "--link-cameras"))
+      linkCameras = true;
+    else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+      frames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--software-gl"))
+      softwareGL = true;
+    else if (!strcmp(argv[i], "--occlusion-culling"))
+      occlusionCulling = true;
+    else if (!strcmp(argv[i], "--occlusion-scene"))
+      occlusionScene = true;
+    else if (!strcmp(argv[i], "--scene") && i + 1 < argc)
+      sceneFile = argv[++i];
+    else if (!strcmp(argv[i], "--profile") && i + 1 < argc)
+      profileFrames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--profile-output") && i + 1 < argc)
+      profileOutput = argv[++i];
+    else if (!strcmp(argv[i], "--gl-finish"))
+      glFinishEachNode = true;
+  }
+
+  CameraPath path;
+  if (replayFile && !path.load(replayFile)) {
+    fprintf(stderr, "Cannot read camera path %s\n", replayFile);
+    return 1;
+  }
+
+  // Headless replay: no Qt window at all, only Coin and an offscreen context
+  if (headless) {
+    if (!replayFile && !snapshotWidth && !occlusionCulling && !profileFrames) {
+      fprintf(stderr, "--headless needs a camera path to replay (--replay), a snapshot size (--snapshot), --occlusion-culling or --profile\n");
+      return 1;
+    }
+    FrameTiming::requestSoftwareGL();
+    SoDB::init();
+    OcclusionCullingGroup::initClass();
+    RenderProfiler::initClass();
+    SoSeparator *root = sceneFile ? readScene(sceneFile) : occlusionScene ? makeOcclusionScene() : makeScene();
+    if (!root)
+      return 1;
+    if (occlusionCulling) {
+      SoSeparator *culling = new OcclusionCullingGroup;
+      culling->addChild(root);
+      root = culling;
+    }
+    root->ref();
+    bool ok = true;
+    if (occlusionCulling && !replayFile && !snapshotWidth && !profileFrames)
+      ok = runOcclusionTest(static_cast<OcclusionCullingGroup*>(root), width, height);
+    // Each mode only if the ones before it went well
+    if (ok && profileFrames)
+      ok = runProfile(root, width, height, profileFrames, profileOutput, glFinishEachNode);
+    if (ok && replayFile) {
+      OffscreenReplay replay(SbViewportRegion(width, height));
+      ok = replay.run(root, path, steps);
+    }
+    if (ok && snapshotWidth && snapshotHeight) {
+      // Frame the whole scene, as the viewer does at startup
+      SoPerspectiveCamera *camera = new SoPerspectiveCamera;
+      camera->ref();
+      camera->viewAll(root, SbViewportRegion(snapshotWidth, snapshotHeight));
+      TiledSnapshot snapshot;
+      ok = snapshot.render(root, camera, snapshotWidth, snapshotHeight, output);
+      camera->unref();
+    }
+    root->unref();
+    return ok ? 0 : 1;
+  }
+
+  if (softwareGL)
+    FrameTiming::requestSoftwareGL();
+  if (quad && !independent)
+    MultiView::requestSharedContexts();
+
+  // Init the Qt windowing system
+  // and get a pointer to the window
+  QWidget *window = SoQt::init("test");
+
+  SoSeparator *root = sceneFile ? readScene(sceneFile) : occlusionScene ? makeOcclusionScene() : makeScene();
+  if (!root)
+    return 1;
+  root->ref();
+
+  // Four views of the same scene graph
+  if (quad) {
+    MultiView *views = new MultiView(root, 2, 2, !independent, window);
+    window->resize(1000, 800);
+    views->resize(1000, 800);
+    SoQt::show(window);
+    views->show();
+    views->setupCacheSharing();
+    views->setCameraLinking(linkCameras);
+    if (frames)
+      QTimer::singleShot(0, [views, frames]() { views->benchmark(frames); SoQt::exitMainLoop(); });
+    SoQt::mainLoop();
+    delete views;
+    root->unref();
+    return 0;
+  }
+
   // Init the viewer and get a pointer to it
   CustomExaminerViewer *b = new CustomExaminerViewer(window);
 
   // Set the main node as content of the window and show it
   b->setSceneGraph(root);
+  b->setOcclusionCulling(occlusionCulling);
   b->show();
 
   // Start the windowing system and show our window
   SoQt::show(window);
+
+  // Replay the camera path once the window is up
+  if (replayFile)
+    QTimer::singleShot(0, [b, &path, steps]() { b->replayCameraPath(path, steps); });
+  if (profileFrames)
+    QTimer::singleShot(0, [b, profileFrames, profileOutput, glFinishEachNode]() {
+      b->profileFrames(profileFrames, profileOutput, glFinishEachNode);
+    });
+
   // Loop until exit.
   SoQt::mainLoop();
 
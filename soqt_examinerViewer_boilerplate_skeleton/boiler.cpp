@@ -1,5 +1,3 @@
-#include <Inventor/Qt/SoQt.h>
-#include <Inventor/Qt/viewers/SoQtExaminerViewer.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoMaterial.h>
 #include <Inventor/nodes/SoTranslation.h>
@@ -11,26 +9,21 @@
 #include <Inventor/nodes/SoCylinder.h>
 #include <Inventor/nodes/SoSphere.h>
 #include <Inventor/nodes/SoCone.h>
-#include <QApplication>
-#include <QWidget>
+#include "ExampleHarness.h"
 #include <random>
 #include <stdexcept>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <cmath>
+
+// Usage: soqt_examinerViewer_boilerplate_skeleton [--headless] [--frames N] [--orbit]
+// (see ExampleHarness.h)
 int main(int argc, char **argv)
 {
 
-  // Initialize the Qt system:
-  QApplication app(argc, argv);
-
-  // Make a main window:
-  QWidget mainwin;
-  mainwin.resize(400,400);
-
-  // Initialize SoQt
-  SoQt::init(&mainwin);
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
 
   // The root of a scene graph
   SoSeparator *root = new SoSeparator;
@@ -41,20 +34,12 @@ int main(int argc, char **argv)
   */
 
 
-  // Initialize an examiner viewer:
-  SoQtExaminerViewer * eviewer = new SoQtExaminerViewer(&mainwin);
-  eviewer->setSceneGraph(root);
-  eviewer->show();
-
-  // Pop up the main window.
-  SoQt::show(&mainwin);
-
-  // Loop until exit.
-  SoQt::mainLoop();
+  // Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
 
   // Clean up resources.
-  delete eviewer;
   root->unref();
 
-  return app.exec();
+  return result;
 }
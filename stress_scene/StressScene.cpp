@@ -0,0 +1,391 @@
+#include "StressScene.h"
+
+#include "MyTorus.h"
+
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSwitch.h>
+#include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <Inventor/nodes/SoTriangleStripSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+const char * const kindNames[] = { "torus", "strip", "face", "cube", "text" };
+
+// Distance between two shapes on the grid
+const float spacing = 6.0f;
+
+// MyTorus' destructor is protected: it is meant to be allocated and
+// forgotten, which a million tori would make a leak worth seeing
+class Torus : public MyTorus {
+public:
+  Torus(double rMajor, double rMinor, int divsMajor, int divsMinor)
+  : MyTorus(rMajor, rMinor, -1, 0, 360, divsMajor, divsMinor)
+  {
+    fRInner = -1; // the outer surface only: no inner torus, no endcaps
+  }
+  ~Torus() {}
+};
+
+unsigned stripTriangles(const SoTriangleStripSet * strips)
+{
+  unsigned triangles = 0;
+  for (int i = 0; i < strips->numVertices.getNum(); ++i)
+    triangles += std::max(0, strips->numVertices[i] - 2);
+  return triangles;
+}
+
+}
+
+
+//____________________________________________________________________
+StressScene::Parameters::Parameters()
+: shapes(1000),
+  kinds(ALL_KINDS),
+  instancing(0.5),
+  depth(2),
+  materials(16),
+  textures(4),
+  collapsed(0.0),
+  seed(1)
+{
+}
+
+//____________________________________________________________________
+StressScene::StressScene(const Parameters & parameters)
+: m_parameters(parameters),
+  m_stats()
+{
+  if (!(m_parameters.kinds & ALL_KINDS))
+    m_parameters.kinds = ALL_KINDS;
+  m_parameters.instancing = std::min(1.0, std::max(0.0, m_parameters.instancing));
+  m_parameters.collapsed = std::min(1.0, std::max(0.0, m_parameters.collapsed));
+}
+
+//____________________________________________________________________
+SoSeparator * StressScene::build()
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_stats = Stats();
+  m_random.seed(m_parameters.seed);
+
+  for (unsigned i = 0; i < m_parameters.materials; ++i) {
+    SoMaterial * material = new SoMaterial;
+    material->ref();
+    const float red = uniform(0.2f, 1.0f), green = uniform(0.2f, 1.0f), blue = uniform(0.2f, 1.0f);
+    material->diffuseColor.setValue(red, green, blue);
+    material->specularColor.setValue(0.3f, 0.3f, 0.3f);
+    material->shininess = uniform(0.0f, 1.0f);
+    m_materials.push_back(material);
+  }
+
+  // Checkerboards of two random colours, inlined: no file to go with the scene
+  const int size = 64;
+  for (unsigned i = 0; i < m_parameters.textures; ++i) {
+    unsigned char colours[2][3];
+    for (int c = 0; c < 3; ++c) {
+      colours[0][c] = (unsigned char)random(256);
+      colours[1][c] = (unsigned char)random(256);
+    }
+    std::vector<unsigned char> pixels(size * size * 3);
+    for (int y = 0; y < size; ++y)
+      for (int x = 0; x < size; ++x)
+        memcpy(&pixels[(y * size + x) * 3], colours[((x / 8) + (y / 8)) % 2], 3);
+    SoTexture2 * texture = new SoTexture2;
+    texture->ref();
+    texture->image.setValue(SbVec2s(size, size), 3, pixels.data());
+    m_textures.push_back(texture);
+  }
+
+  std::vector<int> kinds;
+  for (int kind = 0; kind < 5; ++kind)
+    if (m_parameters.kinds & (1 << kind))
+      kinds.push_back(kind);
+
+  std::vector<SoSeparator *> leaves;
+  leaves.reserve(m_parameters.shapes);
+  for (unsigned i = 0; i < m_parameters.shapes; ++i)
+    leaves.push_back(makeLeaf(i, kinds[i % kinds.size()]));
+
+  // Fan-out such that 'depth' levels of groups hold all the leaves
+  const unsigned fanout = std::max(2u, unsigned(std::ceil(std::pow(double(std::max(1u, m_parameters.shapes)),
+                                                                     1.0 / (m_parameters.depth + 1)))));
+  SoSeparator * root = group(leaves, 0, leaves.size(), 0, fanout);
+  --m_stats.groups; // the root is not one
+
+  // The first groups collapsed: a block of the grid
+  if (m_parameters.collapsed > 0.0) {
+    const int numGroups = root->getNumChildren();
+    const int numCollapsed = int(std::ceil(m_parameters.collapsed * numGroups - 1e-9));
+    for (int i = 0; i < numGroups; ++i) {
+      SoSwitch * subsystem = new SoSwitch;
+      subsystem->addChild(root->getChild(i));
+      subsystem->whichChild = i < numCollapsed ? SO_SWITCH_NONE : 0;
+      root->replaceChild(i, subsystem);
+    }
+    m_stats.switches = numGroups;
+    m_stats.collapsed = numCollapsed;
+  }
+
+  clear();
+  m_stats.shapes = m_parameters.shapes;
+  m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return root;
+}
+
+//____________________________________________________________________
+SoSeparator * StressScene::group(const std::vector<SoSeparator *> & leaves, size_t first, size_t count,
+                                 unsigned level, unsigned fanout)
+{
+  SoSeparator * separator = new SoSeparator;
+  ++m_stats.groups;
+  if (level == m_parameters.depth) {
+    for (size_t i = first; i < first + count; ++i)
+      separator->addChild(leaves[i]);
+    return separator;
+  }
+  // Consecutive leaves, i.e. neighbours on the grid, in each group
+  const size_t chunk = (count + fanout - 1) / fanout;
+  for (size_t i = first; i < first + count; i += chunk)
+    separator->addChild(group(leaves, i, std::min(chunk, first + count - i), level + 1, fanout));
+  return separator;
+}
+
+//____________________________________________________________________
+SoSeparator * StressScene::makeLeaf(unsigned index, int kind)
+{
+  SoSeparator * leaf = new SoSeparator;
+
+  // On a cubic grid, turned at random
+  const unsigned side = std::max(1u, unsigned(std::ceil(std::cbrt(double(m_parameters.shapes)) - 1e-9)));
+  SoTransform * transform = new SoTransform;
+  transform->translation.setValue(spacing * (index % side), spacing * ((index / side) % side),
+                                  spacing * (index / (side * side)));
+  const float x = uniform(-1, 1), y = uniform(-1, 1), z = uniform(0.1f, 1);
+  transform->rotation.setValue(SbVec3f(x, y, z), uniform(0, float(2 * M_PI)));
+  leaf->addChild(transform);
+
+  if (!m_materials.empty())
+    leaf->addChild(m_materials[random(unsigned(m_materials.size()))]);
+  if (kind == 3 && !m_textures.empty())
+    leaf->addChild(m_textures[random(unsigned(m_textures.size()))]);
+
+  // A shape of this kind already made, or a new one
+  std::vector<Prototype> & prototypes = m_prototypes[kind];
+  const bool reuse = !prototypes.empty() && uniform(0, 1) < m_parameters.instancing;
+  const Prototype shape = reuse ? prototypes[random(unsigned(prototypes.size()))] : makeShape(kind, index);
+  if (!reuse) {
+    shape.node->ref();
+    prototypes.push_back(shape);
+    ++m_stats.unique[kind];
+  }
+  leaf->addChild(shape.node);
+  m_stats.triangles += shape.triangles;
+  m_stats.vertices += shape.vertices;
+  return leaf;
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeShape(int kind, unsigned index)
+{
+  switch (kind) {
+  case 0: return makeTorus();
+  case 1: return makeStrips();
+  case 2: return makeFaces();
+  case 3: return makeCube();
+  default: return makeText(index);
+  }
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeTorus()
+{
+  // One draw after the other: the order of evaluation of arguments is
+  // unspecified, and the same seed must give the same scene
+  const float rMajor = uniform(1.2f, 2.0f), rMinor = uniform(0.2f, 0.6f);
+  const int divsMajor = 16 + random(17), divsMinor = 8 + random(9);
+  Torus torus(rMajor, rMinor, divsMajor, divsMinor);
+  SoSeparator * separator = torus.getSeparator(); // comes referenced
+  Prototype prototype = { separator, 0, 0 };
+  const SoTriangleStripSet * strips = static_cast<SoTriangleStripSet *>(separator->getChild(0));
+  prototype.triangles = stripTriangles(strips);
+  prototype.vertices = static_cast<SoVertexProperty *>(strips->vertexProperty.getValue())->vertex.getNum();
+  separator->unrefNoDelete();
+  return prototype;
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeStrips()
+{
+  // A ribbon waving along x, in 'rows' strips
+  const int rows = 4, columns = 16 + random(17);
+  const float amplitude = uniform(0.1f, 0.6f);
+  const float frequency = uniform(1.0f, 4.0f);
+  const float phase = uniform(0, float(2 * M_PI));
+  SoVertexProperty * vertexProperty = new SoVertexProperty;
+  vertexProperty->vertex.setNum(rows * 2 * (columns + 1));
+  SbVec3f * vertices = vertexProperty->vertex.startEditing();
+  int v = 0;
+  for (int row = 0; row < rows; ++row) {
+    for (int column = 0; column <= columns; ++column) {
+      const float x = 4.0f * column / columns - 2.0f;
+      for (int side = 0; side < 2; ++side) {
+        const float y = 2.0f * (row + 1 - side) / rows - 1.0f;
+        vertices[v++].setValue(x, y, amplitude * std::sin(frequency * x + phase) * std::cos(y));
+      }
+    }
+  }
+  vertexProperty->vertex.finishEditing();
+
+  SoTriangleStripSet * strips = new SoTriangleStripSet;
+  strips->vertexProperty = vertexProperty;
+  strips->numVertices.setNum(rows);
+  for (int row = 0; row < rows; ++row)
+    strips->numVertices.set1Value(row, 2 * (columns + 1));
+  Prototype prototype = { strips, stripTriangles(strips), unsigned(v) };
+  return prototype;
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeFaces()
+{
+  // A ring of regular polygons, of 3 to 8 sides, each tilted its own way
+  const int polygons = 6 + random(7);
+  SoVertexProperty * vertexProperty = new SoVertexProperty;
+  SoFaceSet * faces = new SoFaceSet;
+  faces->vertexProperty = vertexProperty;
+  unsigned triangles = 0;
+  int v = 0;
+  for (int p = 0; p < polygons; ++p) {
+    const int sides = 3 + random(6);
+    const float angle = float(2 * M_PI) * p / polygons;
+    const SbVec3f centre(1.5f * std::cos(angle), 1.5f * std::sin(angle), 0.0f);
+    const SbRotation tilt(SbVec3f(std::cos(angle), std::sin(angle), 0.0f), uniform(-1.0f, 1.0f));
+    for (int s = 0; s < sides; ++s) {
+      const float a = float(2 * M_PI) * s / sides;
+      SbVec3f corner;
+      tilt.multVec(SbVec3f(0.5f * std::cos(a), 0.5f * std::sin(a), 0.0f), corner);
+      vertexProperty->vertex.set1Value(v++, centre + corner);
+    }
+    faces->numVertices.set1Value(p, sides);
+    triangles += sides - 2;
+  }
+  Prototype prototype = { faces, triangles, unsigned(v) };
+  return prototype;
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeCube()
+{
+  SoCube * cube = new SoCube;
+  cube->width = uniform(0.5f, 3.0f);
+  cube->height = uniform(0.5f, 3.0f);
+  cube->depth = uniform(0.5f, 3.0f);
+  Prototype prototype = { cube, 12, 24 };
+  return prototype;
+}
+
+//____________________________________________________________________
+StressScene::Prototype StressScene::makeText(unsigned index)
+{
+  SoText2 * text = new SoText2;
+  text->string.setValue(("shape " + std::to_string(index)).c_str());
+  Prototype prototype = { text, 0, 0 };
+  return prototype;
+}
+
+//____________________________________________________________________
+void StressScene::clear()
+{
+  // The scene holds what it uses
+  for (int kind = 0; kind < 5; ++kind) {
+    for (size_t i = 0; i < m_prototypes[kind].size(); ++i)
+      m_prototypes[kind][i].node->unref();
+    m_prototypes[kind].clear();
+  }
+  for (size_t i = 0; i < m_materials.size(); ++i)
+    m_materials[i]->unref();
+  m_materials.clear();
+  for (size_t i = 0; i < m_textures.size(); ++i)
+    m_textures[i]->unref();
+  m_textures.clear();
+}
+
+//____________________________________________________________________
+unsigned StressScene::random(unsigned n)
+{
+  return std::uniform_int_distribution<unsigned>(0, n - 1)(m_random);
+}
+
+//____________________________________________________________________
+float StressScene::uniform(float low, float high)
+{
+  return std::uniform_real_distribution<float>(low, high)(m_random);
+}
+
+//____________________________________________________________________
+void StressScene::printStats() const
+{
+  printf("stress scene: %u shapes (", m_stats.shapes);
+  bool first = true;
+  for (int kind = 0; kind < 5; ++kind) {
+    if (!(m_parameters.kinds & (1 << kind)))
+      continue;
+    printf("%s%u new %s", first ? "" : ", ", m_stats.unique[kind], kindNames[kind]);
+    first = false;
+  }
+  printf(") under %u groups, depth %u, %u materials, %u textures, %u switches (%u off), "
+         "%lu triangles and %lu vertices with all switches on, built in %.2f ms\n",
+         m_stats.groups, m_parameters.depth, m_parameters.materials, m_parameters.textures,
+         m_stats.switches, m_stats.collapsed, m_stats.triangles, m_stats.vertices, m_stats.time);
+  fflush(stdout);
+}
+
+//____________________________________________________________________
+bool StressScene::parseKinds(const char * list, unsigned & kinds)
+{
+  kinds = 0;
+  const std::string names(list);
+  size_t start = 0;
+  while (start <= names.size()) {
+    const size_t end = std::min(names.find(',', start), names.size());
+    const std::string name = names.substr(start, end - start);
+    const char * const * found = std::find_if(kindNames, kindNames + 5,
+                                              [&name](const char * kind) { return name == kind; });
+    if (found == kindNames + 5)
+      return false;
+    kinds |= 1 << (found - kindNames);
+    start = end + 1;
+  }
+  return kinds != 0;
+}
+
+//____________________________________________________________________
+bool StressScene::write(SoNode * root, const char * filename, bool binary)
+{
+  SoOutput out;
+  if (!out.openFile(filename)) {
+    fprintf(stderr, "Cannot write file %s\n", filename);
+    return false;
+  }
+  out.setBinary(binary);
+  SoWriteAction write(&out);
+  write.apply(root);
+  out.closeFile();
+  return true;
+}
@@ -0,0 +1,98 @@
+#ifndef STRESSSCENE_H
+#define STRESSSCENE_H
+
+#include <random>
+#include <vector>
+
+class SoMaterial;
+class SoNode;
+class SoSeparator;
+class SoTexture2;
+
+// Builds large parametric scenes, to see how the viewer and the other
+// examples scale: N shapes, each in its own separator with a transform
+// (on a grid, so that the groups are compact in space) and optionally a
+// material, under 'depth' levels of separators.
+//
+// The shapes are drawn from the kinds asked for, in turn: tori (MyTorus),
+// triangle strip sets (wavy ribbons), face sets (rings of polygons),
+// textured cubes and text labels. A fraction 'instancing' of them reuse
+// a shape already made, of the same kind (the same node, shared), the
+// others are new geometry. Materials and textures are taken from pools
+// of the given sizes, so their variety is controlled as well.
+//
+// With 'collapsed' above 0, each group below the root is put under a
+// SoSwitch, and that fraction of the switches is off (whichChild -1):
+// subsystems collapsed in a detector display.
+//
+// With instancing 0, a million tori is ~200 million vertices: the large
+// counts are for high instancing ratios.
+class StressScene {
+public:
+  enum Kind { TORUS = 1, STRIP = 2, FACE = 4, CUBE = 8, TEXT = 16, ALL_KINDS = 31 };
+
+  struct Parameters {
+    unsigned shapes;
+    unsigned kinds;      // of Kind
+    double instancing;   // fraction of the shapes reusing a previous one, 0 to 1
+    unsigned depth;      // levels of groups above the shapes, 0 for a flat scene
+    unsigned materials;  // size of the material pool, 0 for none
+    unsigned textures;   // size of the texture pool for the cubes, 0 for none
+    double collapsed;    // fraction of the top groups under a switch that is off, 0 for no switches
+    unsigned seed;
+    Parameters();
+  };
+
+  struct Stats {
+    unsigned shapes;
+    unsigned unique[5];  // new shapes per kind, in the order of Kind
+    unsigned groups;     // separators above the shapes
+    unsigned switches, collapsed; // and switches, off
+    unsigned long triangles, vertices; // as rendered, instances counted
+    double time;         // ms
+  };
+
+  StressScene(const Parameters & parameters);
+
+  // A new scene, not referenced
+  SoSeparator * build();
+
+  const Stats & stats() const { return m_stats; }
+  void printStats() const;
+
+  // Parses a comma separated list of kinds ("torus,strip,face,cube,text")
+  static bool parseKinds(const char * list, unsigned & kinds);
+
+  // Writes the scene as a .iv file, binary or ASCII
+  static bool write(SoNode * root, const char * filename, bool binary);
+
+private:
+  // A shape which can be put under several separators
+  struct Prototype {
+    SoNode * node;
+    unsigned triangles, vertices;
+  };
+
+  Parameters m_parameters;
+  Stats m_stats;
+  std::vector<Prototype> m_prototypes[5];
+  std::vector<SoMaterial *> m_materials;
+  std::vector<SoTexture2 *> m_textures;
+
+  Prototype makeShape(int kind, unsigned index);
+  Prototype makeTorus();
+  Prototype makeStrips();
+  Prototype makeFaces();
+  Prototype makeCube();
+  Prototype makeText(unsigned index);
+  SoSeparator * makeLeaf(unsigned index, int kind);
+  SoSeparator * group(const std::vector<SoSeparator *> & leaves, size_t first, size_t count, unsigned level,
+                      unsigned fanout);
+  void clear();
+
+  std::mt19937 m_random;
+  unsigned random(unsigned n);  // in [0, n)
+  float uniform(float low, float high);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <Inventor/SoDB.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include "ExampleHarness.h"
+#include "StressScene.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// Usage: stress_scene [--shapes N] [--kinds torus,strip,face,cube,text]
+//                     [--instancing R] [--depth D] [--materials M]
+//                     [--textures T] [--collapsed C] [--seed S] [--write out.iv [--binary]]
+//                     [--headless] [--frames N] [--orbit] [--export-glb out.glb]
+//
+// Builds a scene of N shapes (1000 by default) of the kinds listed (all
+// by default, in turn), a fraction R of which (0.5) reuse a shape made
+// before, under D levels of groups (2), with M materials (16) and T
+// textures (4), see StressScene.h. A fraction C of the top groups (0) is
+// put under switches that are off. With --write the scene is written as
+// a .iv file, ASCII or binary, and not shown; otherwise it is shown, or
+// rendered offscreen with the ExampleHarness options.
+//
+// e.g. a million shapes, 1% of them new, in an offscreen benchmark:
+//   stress_scene --shapes 1000000 --instancing 0.99 --headless --frames 20
+// or the throughput of the glTF export of 100000 shapes:
+//   stress_scene --shapes 100000 --export-glb stress.glb --headless --frames 0
+// or 90% of the geometry collapsed, and kept compressed:
+//   stress_scene --shapes 10000 --instancing 0 --collapsed 0.9 --compress-hidden --headless --frames 0
+int main(int argc, char **argv)
+{
+  StressScene::Parameters parameters;
+  const char *output = NULL;
+  bool binary = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--shapes") && i + 1 < argc) {
+      parameters.shapes = strtoul(argv[++i], 0, 10);
+    } else if (!strcmp(argv[i], "--kinds") && i + 1 < argc) {
+      if (!StressScene::parseKinds(argv[++i], parameters.kinds)) {
+        fprintf(stderr, "--kinds takes a list of torus, strip, face, cube, text\n");
+        return 1;
+      }
+    } else if (!strcmp(argv[i], "--instancing") && i + 1 < argc) {
+      parameters.instancing = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+      parameters.depth = strtoul(argv[++i], 0, 10);
+    } else if (!strcmp(argv[i], "--materials") && i + 1 < argc) {
+      parameters.materials = strtoul(argv[++i], 0, 10);
+    } else if (!strcmp(argv[i], "--textures") && i + 1 < argc) {
+      parameters.textures = strtoul(argv[++i], 0, 10);
+    } else if (!strcmp(argv[i], "--collapsed") && i + 1 < argc) {
+      parameters.collapsed = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      parameters.seed = strtoul(argv[++i], 0, 10);
+    } else if (!strcmp(argv[i], "--write") && i + 1 < argc) {
+      output = argv[++i];
+    } else if (!strcmp(argv[i], "--binary")) {
+      binary = true;
+    }
+  }
+
+  if (output) {
+    SoDB::init();
+    StressScene generator(parameters);
+    SoSeparator *scene = generator.build();
+    scene->ref();
+    generator.printStats();
+    const bool written = StressScene::write(scene, output, binary);
+    scene->unref();
+    return written ? 0 : 1;
+  }
+
+  // Initialize Qt, SoQt and the main window, or Coin alone with --headless:
+  ExampleHarness harness(argc, argv);
+
+  // The root of a scene graph
+  SoSeparator *root = new SoSeparator;
+  root->ref();
+
+  StressScene generator(parameters);
+  root->addChild(generator.build());
+  generator.printStats();
+
+  // Show the scene in an examiner viewer until the window is closed,
+  // or render the frames asked for
+  const int result = harness.run(root);
+
+  // Clean up resources.
+  root->unref();
+
+  return result;
+}